@@ -3,6 +3,8 @@
 
 #include "push/message_receiver/message_processor.h"
 
+#include <chrono>
+
 #include "base/hash.h"
 #include "third_party/mysql_client_cpp/include/mysql_connection.h"
 #include "third_party/mysql_client_cpp/include/mysql_driver.h"
@@ -323,6 +325,10 @@ void MsgProcessor::UploadDataToKafka(
   time_t now = time(NULL);
   Json::Value data;
   data["timestamp"] = static_cast<uint32_t>(now);
+  // lets push controller measure the latency from order to push event
+  data["timestamp_ms"] = static_cast<Json::Int64>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::system_clock::now().time_since_epoch()).count());
   data["event"] = FLAGS_burypoint_upload_log_event_type;
   data["user_id"] = user_order_info.user_id();
   data["business_type"] = user_order_info.business_type();
@@ -26,6 +26,9 @@ class BusinessFactory {
   void RegisterPushProcessor(BusinessType business_type,
       PushProcessor* push_processor);
   PushProcessor* GetPushProcessor(BusinessType business_type);
+  const PushProcessorMapType& push_processor_map() const {
+    return push_processor_map_;
+  }
 
  private:
   BusinessFactory() {}
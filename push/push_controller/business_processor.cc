@@ -3,8 +3,11 @@
 
 #include "push/push_controller/business_processor.h"
 
+#include <algorithm>
+
 #include "base/compat.h"
 #include "base/file/proto_util.h"
+#include "base/hash.h"
 #include "base/log.h"
 #include "base/string_util.h"
 #include "third_party/gflags/gflags.h"
@@ -16,10 +19,12 @@
 #include "third_party/mysql_client_cpp/include/cppconn/resultset.h"
 #include "third_party/mysql_client_cpp/include/cppconn/statement.h"
 
+#include "push/util/common_util.h"
 #include "push/util/time_util.h"
 #include "push/proto/push_meta.pb.h"
 
 DECLARE_bool(use_cluster_mode);
+DECLARE_int32(db_batch_query_size);
 DECLARE_string(mysql_config);
 
 namespace {
@@ -30,31 +35,37 @@ static const char kTable[] = "push_event_info";
 
 static const char kInsertFormat[] =
     "INSERT INTO %s (id, order_id, user_id, business_type, event_type, "
-    "push_time, business_key, is_realtime, push_status) "
-    "VALUES('%s', '%s', '%s', '%d', '%d', "
-    "FROM_UNIXTIME('%d'), '%s', '%d', '%d');";
+    "push_time, business_key, is_realtime, push_status, push_detail) "
+    "VALUES %s "
+    "ON DUPLICATE KEY UPDATE push_time = VALUES(push_time), "
+    "business_key = VALUES(business_key), "
+    "push_detail = VALUES(push_detail);";
 
 static const char kInsertFormatV2[] =
     "INSERT INTO %s (id, order_id, user_id, business_type, event_type, "
-    "push_time, business_key, is_realtime, push_status, fingerprint_id) "
-    "VALUES('%s', '%s', '%s', '%d', '%d', "
-    "FROM_UNIXTIME('%d'), '%s', '%d', '%d', '%lu');";
+    "push_time, business_key, is_realtime, push_status, push_detail, "
+    "fingerprint_id) VALUES %s "
+    "ON DUPLICATE KEY UPDATE push_time = VALUES(push_time), "
+    "business_key = VALUES(business_key), "
+    "push_detail = VALUES(push_detail);";
+
+static const char kValueFormat[] =
+    "('%s', '%s', '%s', '%d', '%d', FROM_UNIXTIME('%d'), '%s', '%d', '%d', "
+    "'%s')";
+
+static const char kValueFormatV2[] =
+    "('%s', '%s', '%s', '%d', '%d', FROM_UNIXTIME('%d'), '%s', '%d', '%d', "
+    "'%s', '%ld')";
 
 static const char kQueryFormat[] =
-    "SELECT id, order_id, user_id, business_type, event_type, push_detail, "
-    "push_time, business_key, is_realtime, push_status, updated, "
-    "finished_time "
-    "FROM %s WHERE id = '%s';";
+    "SELECT id, order_id, user_id, business_type, event_type, "
+    "UNIX_TIMESTAMP(push_time) AS push_time, business_key, push_detail "
+    "FROM %s WHERE id IN (%s);";
 
 static const char kQueryFormatV2[] =
-    "SELECT id, order_id, user_id, business_type, event_type, push_detail, "
-    "push_time, business_key, is_realtime, push_status, updated, "
-    "finished_time, fingerprint_id "
-    "FROM %s WHERE id = '%s';";
-
-static const char kUpdateFormat[] =
-    "UPDATE %s SET push_time = FROM_UNIXTIME('%d'), business_key = '%s' "
-    "WHERE id = '%s';";
+    "SELECT id, order_id, user_id, business_type, event_type, "
+    "UNIX_TIMESTAMP(push_time) AS push_time, business_key, push_detail, "
+    "fingerprint_id FROM %s WHERE id IN (%s);";
 
 enum TimeRelationType {
   kIsRelativeTime = 1,
@@ -108,8 +119,14 @@ BaseBusinessProcessor::BaseBusinessProcessor() {
 BaseBusinessProcessor::~BaseBusinessProcessor() {}
 
 bool BaseBusinessProcessor::UpdateEventsToDb(
-    const vector<PushEventInfo>& push_events) {
+    const vector<PushEventInfo>& push_events,
+    vector<PushEventInfo>* changed_events) {
   VLOG(2) << "BaseBusinessProcessor::UpdateEventsToDb()";
+  if (push_events.empty()) {
+    return true;
+  }
+  size_t batch_size = static_cast<size_t>(
+      std::max(FLAGS_db_batch_query_size, 1));
   try {
     sql::Driver* driver = sql::mysql::get_driver_instance();
     std::unique_ptr<sql::Connection>
@@ -119,77 +136,14 @@ bool BaseBusinessProcessor::UpdateEventsToDb(
             mysql_server_->password()));
     connection->setSchema(mysql_server_->database());
     std::unique_ptr<sql::Statement> statement(connection->createStatement());
-    string insert_sql, select_sql, update_sql;
-    int number_of_insert = 0, number_of_update = 0;
-    for (auto& push_event : push_events) {
-      const string& id = push_event.id();
-      if (FLAGS_use_cluster_mode) {
-        select_sql = StringPrintf(kQueryFormatV2, kTable, id.c_str());
-      } else {
-        select_sql = StringPrintf(kQueryFormat, kTable, id.c_str());
-      }
-      std::unique_ptr<sql::ResultSet> result_set(
-          statement->executeQuery(select_sql));
-      if (result_set->rowsCount() > 0) {
-        CHECK(result_set->rowsCount() == 1);
-        PushEventInfo existed_push_event;
-        while (result_set->next()) {
-          existed_push_event.set_id(result_set->getString("id"));
-          existed_push_event.set_order_id(result_set->getString("order_id"));
-          existed_push_event.set_user_id(result_set->getString("user_id"));
-          existed_push_event.set_business_type(
-              static_cast<BusinessType>(result_set->getInt("business_type")));
-          existed_push_event.set_event_type(
-              static_cast<EventType>(result_set->getInt("event_type")));
-          if (FLAGS_use_cluster_mode) {
-            existed_push_event.set_fingerprint_id(
-                result_set->getInt("fingerprint_id"));
-          }
-          break;
-        }
-        if (!CheckAttribute(existed_push_event, push_event)) {
-          continue;
-        }
-        update_sql = StringPrintf(kUpdateFormat,
-                                  kTable,
-                                  push_event.push_time(),
-                                  push_event.business_key().c_str(),
-                                  push_event.id().c_str());
-        statement->executeUpdate(update_sql);
-        ++number_of_update;
-      } else {
-        if (FLAGS_use_cluster_mode) {
-          insert_sql = StringPrintf(kInsertFormatV2,
-              kTable,
-              push_event.id().c_str(),
-              push_event.order_id().c_str(),
-              push_event.user_id().c_str(),
-              push_event.business_type(),
-              push_event.event_type(),
-              push_event.push_time(),
-              push_event.business_key().c_str(),
-              push_event.is_realtime(),
-              push_event.push_status(),
-              push_event.fingerprint_id());
-        } else {
-          insert_sql = StringPrintf(kInsertFormat,
-              kTable,
-              push_event.id().c_str(),
-              push_event.order_id().c_str(),
-              push_event.user_id().c_str(),
-              push_event.business_type(),
-              push_event.event_type(),
-              push_event.push_time(),
-              push_event.business_key().c_str(),
-              push_event.is_realtime(),
-              push_event.push_status());
-        }
-        statement->executeUpdate(insert_sql);
-        ++number_of_insert;
+    for (size_t begin = 0; begin < push_events.size(); begin += batch_size) {
+      size_t end = std::min(begin + batch_size, push_events.size());
+      vector<PushEventInfo> batch(push_events.begin() + begin,
+                                  push_events.begin() + end);
+      if (!UpdateBatchToDb(statement.get(), batch, changed_events)) {
+        return false;
       }
     }
-    LOG(INFO) << "update event to db success, insert num:"
-              << number_of_insert << ", update num:" << number_of_update;
     return true;
   } catch (const sql::SQLException &e) {
     LOG(ERROR) << "SQLException: " << e.what();
@@ -197,6 +151,123 @@ bool BaseBusinessProcessor::UpdateEventsToDb(
   }
 }
 
+bool BaseBusinessProcessor::UpdateBatchToDb(
+    sql::Statement* statement,
+    const vector<PushEventInfo>& push_events,
+    vector<PushEventInfo>* changed_events) {
+  vector<string> quoted_ids;
+  for (auto& push_event : push_events) {
+    quoted_ids.push_back(
+        "'" + EscapeSqlString(push_event.id()) + "'");
+  }
+  string select_sql;
+  if (FLAGS_use_cluster_mode) {
+    select_sql = StringPrintf(kQueryFormatV2, kTable,
+                              JoinString(quoted_ids, ',').c_str());
+  } else {
+    select_sql = StringPrintf(kQueryFormat, kTable,
+                              JoinString(quoted_ids, ',').c_str());
+  }
+  VLOG(2) << "SELECT command: " << select_sql;
+  map<string, PushEventInfo> existed_map;
+  std::unique_ptr<sql::ResultSet> result_set(
+      statement->executeQuery(select_sql));
+  while (result_set->next()) {
+    PushEventInfo existed_push_event;
+    existed_push_event.set_id(result_set->getString("id"));
+    existed_push_event.set_order_id(result_set->getString("order_id"));
+    existed_push_event.set_user_id(result_set->getString("user_id"));
+    existed_push_event.set_business_type(
+        static_cast<BusinessType>(result_set->getInt("business_type")));
+    existed_push_event.set_event_type(
+        static_cast<EventType>(result_set->getInt("event_type")));
+    existed_push_event.set_push_time(result_set->getInt("push_time"));
+    existed_push_event.set_business_key(result_set->getString("business_key"));
+    existed_push_event.set_push_detail(result_set->getString("push_detail"));
+    if (FLAGS_use_cluster_mode) {
+      existed_push_event.set_fingerprint_id(
+          result_set->getInt64("fingerprint_id"));
+    }
+    existed_map[existed_push_event.id()] = existed_push_event;
+  }
+
+  vector<string> values;
+  vector<const PushEventInfo*> written_events;
+  int number_of_insert = 0, number_of_update = 0, number_of_unchanged = 0;
+  for (auto& push_event : push_events) {
+    auto it = existed_map.find(push_event.id());
+    if (it != existed_map.end()) {
+      if (!CheckAttribute(it->second, push_event)) {
+        continue;
+      }
+      if (ContentFingerprint(it->second) == ContentFingerprint(push_event)) {
+        ++number_of_unchanged;
+        continue;
+      }
+      ++number_of_update;
+    } else {
+      ++number_of_insert;
+    }
+    if (FLAGS_use_cluster_mode) {
+      values.push_back(StringPrintf(kValueFormatV2,
+          EscapeSqlString(push_event.id()).c_str(),
+          EscapeSqlString(push_event.order_id()).c_str(),
+          EscapeSqlString(push_event.user_id()).c_str(),
+          push_event.business_type(),
+          push_event.event_type(),
+          push_event.push_time(),
+          EscapeSqlString(push_event.business_key()).c_str(),
+          push_event.is_realtime(),
+          push_event.push_status(),
+          EscapeSqlString(push_event.push_detail()).c_str(),
+          push_event.fingerprint_id()));
+    } else {
+      values.push_back(StringPrintf(kValueFormat,
+          EscapeSqlString(push_event.id()).c_str(),
+          EscapeSqlString(push_event.order_id()).c_str(),
+          EscapeSqlString(push_event.user_id()).c_str(),
+          push_event.business_type(),
+          push_event.event_type(),
+          push_event.push_time(),
+          EscapeSqlString(push_event.business_key()).c_str(),
+          push_event.is_realtime(),
+          push_event.push_status(),
+          EscapeSqlString(push_event.push_detail()).c_str()));
+    }
+    written_events.push_back(&push_event);
+  }
+  if (!values.empty()) {
+    string insert_sql;
+    if (FLAGS_use_cluster_mode) {
+      insert_sql = StringPrintf(kInsertFormatV2, kTable,
+                                JoinString(values, ',').c_str());
+    } else {
+      insert_sql = StringPrintf(kInsertFormat, kTable,
+                                JoinString(values, ',').c_str());
+    }
+    VLOG(2) << "INSERT command: " << insert_sql;
+    statement->executeUpdate(insert_sql);
+  }
+  // only events that reached db are handed on, a failed upsert throws above
+  if (changed_events) {
+    for (auto push_event : written_events) {
+      changed_events->push_back(*push_event);
+    }
+  }
+  VLOG(1) << "update event to db success, insert num:" << number_of_insert
+          << ", update num:" << number_of_update
+          << ", unchanged num:" << number_of_unchanged;
+  return true;
+}
+
+uint64 BaseBusinessProcessor::ContentFingerprint(
+    const PushEventInfo& push_event) {
+  string content = StringPrintf("%d\t%s\t%s", push_event.push_time(),
+                                push_event.business_key().c_str(),
+                                push_event.push_detail().c_str());
+  return static_cast<uint64>(mobvoi::Fingerprint(content));
+}
+
 void BaseBusinessProcessor::CreateId(PushEventInfo* push_event_info) {
   string event_id = StringPrintf("%s-%d",
       push_event_info->order_id().c_str(),
@@ -12,6 +12,10 @@
 
 #include "push/proto/push_meta.pb.h"
 
+namespace sql {
+class Statement;
+}
+
 namespace push_controller {
 
 class BaseBusinessProcessor {
@@ -20,10 +24,19 @@ class BaseBusinessProcessor {
   virtual ~BaseBusinessProcessor();
   virtual bool CreatePushEvent(UserOrderInfo* user_order_info,
                                vector<PushEventInfo>* push_event_vector) = 0;
-  bool UpdateEventsToDb(const vector<PushEventInfo>& push_events);
+  // Writes the new events and the ones whose content changed, in batches
+  // of one IN (...) query and one upsert. The written events are appended
+  // to changed_events if it is not NULL.
+  bool UpdateEventsToDb(const vector<PushEventInfo>& push_events,
+                        vector<PushEventInfo>* changed_events);
   void CreateId(PushEventInfo* push_event_info);
+  // Fingerprint of the columns an update may change.
+  static uint64 ContentFingerprint(const PushEventInfo& push_event);
 
  private:
+  bool UpdateBatchToDb(sql::Statement* statement,
+                       const vector<PushEventInfo>& push_events,
+                       vector<PushEventInfo>* changed_events);
   bool CheckAttribute(const PushEventInfo& push_event_left,
                       const PushEventInfo& push_event_right);
 
@@ -0,0 +1,164 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/push_controller/flight/flight_change_consumer.h"
+
+#include "base/file/proto_util.h"
+#include "base/log.h"
+#include "base/string_util.h"
+#include "third_party/gflags/gflags.h"
+#include "third_party/mysql_client_cpp/include/mysql_connection.h"
+#include "third_party/mysql_client_cpp/include/mysql_driver.h"
+#include "third_party/mysql_client_cpp/include/cppconn/driver.h"
+#include "third_party/mysql_client_cpp/include/cppconn/exception.h"
+#include "third_party/mysql_client_cpp/include/cppconn/resultset.h"
+#include "third_party/mysql_client_cpp/include/cppconn/statement.h"
+
+#include "push/push_controller/business_factory.h"
+#include "push/util/time_util.h"
+
+DECLARE_string(flight_change_topic);
+DECLARE_string(mysql_config);
+
+namespace {
+
+static const char kTable[] = "push_event_info";
+
+// orders of the flight whose reminders are not all sent yet
+static const char kQueryFormat[] =
+    "SELECT DISTINCT order_id FROM %s WHERE business_type = %d "
+    "AND business_key = '%s' AND push_status = %d "
+    "AND push_time > FROM_UNIXTIME(%ld);";
+
+}
+
+namespace push_controller {
+
+FlightChangeConsumer::FlightChangeConsumer(
+    const PushEventCallback& push_event_callback)
+  : push_event_callback_(push_event_callback) {
+  mysql_server_.reset(new MysqlServer());
+  CHECK(file::ReadProtoFromTextFile(FLAGS_mysql_config, mysql_server_.get()));
+  message_queue_ = std::make_shared<mobvoi::ConcurrentQueue<string>>();
+  sub_thread_.reset(new recommendation::RedisSubThread(
+      message_queue_, FLAGS_flight_change_topic));
+}
+
+FlightChangeConsumer::~FlightChangeConsumer() {}
+
+void FlightChangeConsumer::Run() {
+  LOG(INFO) << "FlightChangeConsumer::Run() ...";
+  sub_thread_->Start();
+  UserOrderProcessor user_order_processor;
+  while (true) {
+    string message;
+    message_queue_->Pop(message);
+    flight::FlightChange change;
+    if (!flight::ParseFlightChange(message, &change)) {
+      LOG(WARNING) << "invalid flight change:" << message;
+      continue;
+    }
+    vector<string> order_ids;
+    if (!QueryOrderIds(change, &order_ids) || order_ids.empty()) {
+      continue;
+    }
+    vector<UserOrderInfo> user_orders;
+    if (!user_order_processor.QueryUserOrderById(order_ids, &user_orders)) {
+      LOG(ERROR) << "query user order by id failed, flight_no:"
+                 << change.flight_no;
+      continue;
+    }
+    vector<PushEventInfo> push_events;
+    CreatePushEvents(change, message, user_orders, &push_events);
+    if (push_events.empty()) {
+      continue;
+    }
+    // written before they are scheduled so the push status is tracked,
+    // events already in db are not pushed again
+    BaseBusinessProcessor* business_processor =
+        Singleton<BusinessFactory>::get()->GetBusinessProcessor(
+            kBusinessFlight);
+    vector<PushEventInfo> changed_events;
+    if (!business_processor ||
+        !business_processor->UpdateEventsToDb(push_events, &changed_events)) {
+      LOG(ERROR) << "update flight change events to db failed, flight_no:"
+                 << change.flight_no;
+      continue;
+    }
+    LOG(INFO) << "Flight change, flight_no:" << change.flight_no
+              << ", depart_date:" << change.depart_date
+              << ", changes:" << JoinString(change.changes, ',')
+              << ", push events:" << push_events.size()
+              << ", new events:" << changed_events.size();
+    if (!changed_events.empty()) {
+      push_event_callback_(changed_events);
+    }
+  }
+}
+
+bool FlightChangeConsumer::QueryOrderIds(const flight::FlightChange& change,
+                                         vector<string>* order_ids) {
+  if (change.flight_no.find_first_of("'\\") != string::npos) {
+    LOG(WARNING) << "invalid flight no:" << change.flight_no;
+    return false;
+  }
+  try {
+    sql::Driver* driver = sql::mysql::get_driver_instance();
+    std::unique_ptr<sql::Connection>
+        connection(driver->connect(
+            mysql_server_->host(),
+            mysql_server_->user(),
+            mysql_server_->password()));
+    connection->setSchema(mysql_server_->database());
+    std::unique_ptr<sql::Statement> statement(connection->createStatement());
+    string query = StringPrintf(kQueryFormat, kTable,
+                                static_cast<int>(kBusinessFlight),
+                                change.flight_no.c_str(),
+                                static_cast<int>(kPushPending),
+                                static_cast<long>(time(NULL)));
+    VLOG(2) << "query flight orders, sql:" << query;
+    std::unique_ptr<sql::ResultSet> result_set(statement->executeQuery(query));
+    while (result_set->next()) {
+      order_ids->push_back(result_set->getString("order_id"));
+    }
+    return true;
+  } catch (const sql::SQLException &e) {
+    LOG(ERROR) << "SQLException: " << e.what();
+    return false;
+  }
+}
+
+void FlightChangeConsumer::CreatePushEvents(
+    const flight::FlightChange& change,
+    const string& message,
+    const vector<UserOrderInfo>& user_orders,
+    vector<PushEventInfo>* push_events) {
+  for (auto& user_order : user_orders) {
+    // business_key is the flight_no only, the order must take off that day
+    string depart_date;
+    recommendation::TimestampToDatetime(user_order.business_time(),
+                                        &depart_date, "%Y-%m-%d");
+    if (depart_date != change.depart_date) {
+      continue;
+    }
+    PushEventInfo push_event;
+    push_event.set_order_id(user_order.id());
+    push_event.set_user_id(user_order.user_id());
+    push_event.set_business_type(kBusinessFlight);
+    push_event.set_event_type(kEventRemindTimelineFlightChange);
+    // one event per change, a redelivered change keeps its id and content,
+    // so the db upsert finds it unchanged and it is not pushed again
+    push_event.set_id(StringPrintf("%s-%d-%ld", user_order.id().c_str(),
+        static_cast<int>(kEventRemindTimelineFlightChange),
+        static_cast<long>(change.timestamp)));
+    push_event.set_push_time(change.timestamp);
+    push_event.set_push_detail(message);
+    push_event.set_business_key(change.flight_no);
+    push_event.set_is_realtime(true);
+    push_event.set_push_status(kPushPending);
+    push_event.set_fingerprint_id(user_order.fingerprint_id());
+    push_events->push_back(push_event);
+  }
+}
+
+}  // namespace push_controller
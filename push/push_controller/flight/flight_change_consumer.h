@@ -0,0 +1,47 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#ifndef PUSH_PUSH_CONTROLLER_FLIGHT_FLIGHT_CHANGE_CONSUMER_H_
+#define PUSH_PUSH_CONTROLLER_FLIGHT_FLIGHT_CHANGE_CONSUMER_H_
+
+#include <memory>
+
+#include "base/basictypes.h"
+#include "base/compat.h"
+#include "base/concurrent_queue.h"
+#include "base/thread.h"
+#include "proto/mysql_config.pb.h"
+
+#include "push/push_controller/push_pool_updater.h"
+#include "push/serving/flight/flight_change.h"
+#include "push/util/redis_util.h"
+
+namespace push_controller {
+
+// Subscribes to the flight changes published by the flight info server
+// and creates an immediate kEventRemindTimelineFlightChange event for
+// every order of the flight which still has reminders pending.
+class FlightChangeConsumer : public mobvoi::Thread {
+ public:
+  explicit FlightChangeConsumer(const PushEventCallback& push_event_callback);
+  virtual ~FlightChangeConsumer();
+  virtual void Run();
+
+ private:
+  bool QueryOrderIds(const flight::FlightChange& change,
+                     vector<string>* order_ids);
+  void CreatePushEvents(const flight::FlightChange& change,
+                        const string& message,
+                        const vector<UserOrderInfo>& user_orders,
+                        vector<PushEventInfo>* push_events);
+
+  PushEventCallback push_event_callback_;
+  std::unique_ptr<MysqlServer> mysql_server_;
+  std::shared_ptr<mobvoi::ConcurrentQueue<string>> message_queue_;
+  std::unique_ptr<recommendation::RedisSubThread> sub_thread_;
+  DISALLOW_COPY_AND_ASSIGN(FlightChangeConsumer);
+};
+
+}  // namespace push_controller
+
+#endif  // PUSH_PUSH_CONTROLLER_FLIGHT_FLIGHT_CHANGE_CONSUMER_H_
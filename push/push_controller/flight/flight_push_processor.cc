@@ -3,13 +3,29 @@
 
 #include "push/push_controller/flight/flight_push_processor.h"
 
+#include <set>
+
+#include "push/serving/flight/flight_change.h"
+
+DECLARE_int32(flight_status_cache_seconds);
+DECLARE_int32(flight_status_near_cache_seconds);
+DECLARE_int32(flight_status_near_departure_seconds);
+
 DECLARE_string(flight_info_service);
 
+namespace {
+
+static const int kFlightCacheSize = 100000;
+
+}
+
 namespace push_controller {
 
 FlightPushProcessor::FlightPushProcessor() {
   VLOG(2) << "FlightPushProcessor::FlightPushProcessor()";
   weather_helper_.reset(new WeatherHelper());
+  flight_cache_.reset(new recommendation::ExpiringCache<flight::FlightResponse>(
+      kFlightCacheSize));
 }
 
 FlightPushProcessor::~FlightPushProcessor() {}
@@ -33,6 +49,11 @@ bool FlightPushProcessor::Process(PushEventInfo* push_event) {
     return false;
   }
   VLOG(2) << "GetFlightResponse success, id:" << push_event->id();
+  if (push_event->event_type() == kEventRemindTimelineFlightChange &&
+      !ApplyFlightChange(user_order, *push_event, &flight_response)) {
+    LOG(ERROR) << "ApplyFlightChange failed, id:" << push_event->id();
+    return false;
+  }
   WeatherInfo weather_info;
   if (!FetchWeather(flight_response, &weather_info)) {
     LOG(ERROR) << "FetchWeather failed, id:" << push_event->id();
@@ -46,6 +67,11 @@ bool FlightPushProcessor::Process(PushEventInfo* push_event) {
     return false;
   }
   VLOG(2) << "BuildPushMessage success, id:" << push_event->id();
+  // a flight change may leave nothing worth pushing, which is no failure
+  if (message.isNull()) {
+    VLOG(2) << "nothing to push, id:" << push_event->id();
+    return true;
+  }
   string message_desc = business_key_map_[push_event->business_type()];
   if (!push_sender_->SendPush(kMessageFlight, message_desc,
                               push_event->user_id(), message)) {
@@ -98,9 +124,58 @@ bool FlightPushProcessor::GetFlightResponse(
   recommendation::TimestampToDatetime(takeoff_time,
                                       &depart_date,
                                       "%Y-%m-%d");
+  const string& flight_no = user_flight_info.flight_no();
+  string key = flight_no + "&" + depart_date;
+  if (flight_cache_->Get(key, flight_response)) {
+    VLOG(1) << "Hit flight cache, key:" << key;
+    return true;
+  }
+  auto loader = [this, &flight_no, &depart_date](
+      flight::FlightResponse* loaded_response) {
+    return FetchFlightResponse(flight_no, depart_date, loaded_response);
+  };
+  if (!flight_single_flight_.Do(key, loader, flight_response)) {
+    return false;
+  }
+  flight_cache_->Put(key, *flight_response,
+                     FlightCacheSeconds(takeoff_time, time(NULL)));
+  return true;
+}
+
+bool FlightPushProcessor::ApplyFlightChange(
+    const UserOrderInfo& user_order,
+    const PushEventInfo& push_event,
+    flight::FlightResponse* flight_response) {
+  flight::FlightChange change;
+  if (!flight::ParseFlightChange(push_event.push_detail(), &change)) {
+    LOG(ERROR) << "invalid flight change:" << push_event.push_detail();
+    return false;
+  }
+  // the cached status may predate the change, the change is newer
+  flight::ApplyFlightChange(change, flight_response);
+  time_t takeoff_time =
+      user_order.business_info().user_flight_info().takeoff_time();
+  flight_cache_->Put(change.flight_no + "&" + change.depart_date,
+                     *flight_response,
+                     FlightCacheSeconds(takeoff_time, time(NULL)));
+  return true;
+}
+
+int FlightPushProcessor::FlightCacheSeconds(time_t takeoff_time,
+                                            time_t now) {
+  if (now + FLAGS_flight_status_near_departure_seconds >= takeoff_time) {
+    return FLAGS_flight_status_near_cache_seconds;
+  }
+  return FLAGS_flight_status_cache_seconds;
+}
+
+bool FlightPushProcessor::FetchFlightResponse(
+    const string& flight_no,
+    const string& depart_date,
+    flight::FlightResponse* flight_response) {
   Json::Value request;
   request["depart_date"] = depart_date;
-  request["flight_no"] = user_flight_info.flight_no();
+  request["flight_no"] = flight_no;
   string post_data = JsonToString(request);
   LOG(INFO) << "Flight info request: " << post_data;
   util::HttpClient http_client;
@@ -169,7 +244,8 @@ bool FlightPushProcessor::BuildPushMessage(
       push_event.event_type() != kEventRemindTimeline3Hour &&
       push_event.event_type() != kEventRemindTimeline1Hour &&
       push_event.event_type() != kEventRemindTimelineTakeoff &&
-      push_event.event_type() != kEventRemindTimelineArrive) {
+      push_event.event_type() != kEventRemindTimelineArrive &&
+      push_event.event_type() != kEventRemindTimelineFlightChange) {
     LOG(ERROR) << "ERR push event type:" << push_event.event_type();
     return false;
   }
@@ -272,6 +348,9 @@ bool FlightPushProcessor::AppendEventField(
   } else if (push_event.event_type() == kEventRemindTimelineArrive) {
     return HandleArrival(
         user_order, push_event, flight_response, weather_info, message);
+  } else if (push_event.event_type() == kEventRemindTimelineFlightChange) {
+    return HandleFlightChange(
+        user_order, push_event, flight_response, weather_info, message);
   } else {
     LOG(ERROR) << "Should not go to this branch";
     return false;
@@ -508,6 +587,62 @@ bool FlightPushProcessor::HandleArrival(
   return true;
 }
 
+bool FlightPushProcessor::HandleFlightChange(
+    const UserOrderInfo& user_order, const PushEventInfo& push_event,
+    const flight::FlightResponse& flight_response,
+    const WeatherInfo& weather_info, Json::Value* msg) {
+  flight::FlightChange change;
+  if (!flight::ParseFlightChange(push_event.push_detail(), &change)) {
+    return false;
+  }
+  std::set<string> changes(change.changes.begin(), change.changes.end());
+  // the gate matters most to a passenger at the airport, then the delay
+  if (changes.count(flight::kChangeGate) > 0 &&
+      flight_response.gate_is_change() == "true") {
+    return Handle1Hour(
+        user_order, push_event, flight_response, weather_info, msg);
+  }
+  if ((changes.count(flight::kChangeDelay) > 0 ||
+       changes.count(flight::kChangeTakeoff) > 0) &&
+      flight_response.is_delay() == "true") {
+    return HandleTakeoff(
+        user_order, push_event, flight_response, weather_info, msg);
+  }
+  string title, position2, position3;
+  if (changes.count(flight::kChangeTakeoff) > 0) {
+    if (!GetTakeoff(flight_response, &position3)) {
+      return false;
+    }
+    title = StringPrintf(u8"%s 起飞时间变更",
+                         flight_response.flight_no().c_str());
+    position2 = u8"起飞时间变更为";
+  } else if (changes.count(flight::kChangeArrive) > 0) {
+    if (!recommendation::GetArrive(flight_response.estimated_arrive(),
+                                   flight_response.actual_arrive(),
+                                   &position3)) {
+      return false;
+    }
+    title = StringPrintf(u8"%s 到达时间变更",
+                         flight_response.flight_no().c_str());
+    position2 = u8"预计到达时间";
+  } else {
+    // leaves msg null, see Process
+    VLOG(2) << "nothing to push for flight change, id:" << push_event.id();
+    return true;
+  }
+  Json::Value& message = *msg;
+  vector<string> ticker_vec;
+  ticker_vec.push_back(position2 + position3);
+  SetTimeline(title, ticker_vec, message);
+  string des = u8"出门问问智能推送";
+  string position1 = flight_response.flight_no();
+  string position4 = "";
+  string ui_type = "2";
+  SetPushDetail(
+      des, position1, position2, position3, position4, ui_type, message);
+  return true;
+}
+
 bool FlightPushProcessor::GetTakeoff(
     const flight::FlightResponse& flight_response, string* takeoff) {
   vector<string> takeoff_vec;
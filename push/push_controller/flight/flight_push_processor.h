@@ -5,6 +5,7 @@
 #define PUSH_PUSH_CONTROLLER_FLIGHT_PUSH_PROCESSOR_H_
 
 #include "push/push_controller/push_processor.h"
+#include "push/util/cache_util.h"
 
 namespace push_controller {
 
@@ -65,10 +66,33 @@ class FlightPushProcessor : public PushProcessor {
                      const flight::FlightResponse& flight_response,
                      const WeatherInfo& weather_info,
                      Json::Value* message);
+  // The gate, delay or time change of kEventRemindTimelineFlightChange.
+  bool HandleFlightChange(const UserOrderInfo& user_order,
+                          const PushEventInfo& push_event,
+                          const flight::FlightResponse& flight_response,
+                          const WeatherInfo& weather_info,
+                          Json::Value* message);
   bool GetTakeoff(const flight::FlightResponse& flight_response,
                   string* takeoff);
+  // Overwrites flight_response and the cached status with the change
+  // carried in push_detail.
+  bool ApplyFlightChange(const UserOrderInfo& user_order,
+                         const PushEventInfo& push_event,
+                         flight::FlightResponse* flight_response);
+  bool FetchFlightResponse(const string& flight_no,
+                           const string& depart_date,
+                           flight::FlightResponse* flight_response);
+  // Gates and delays change more often close to the departure, so the
+  // status is kept for a shorter time then.
+  static int FlightCacheSeconds(time_t takeoff_time, time_t now);
 
   std::unique_ptr<WeatherHelper> weather_helper_;
+  // flight_no&depart_date -> status, shared by the events and passengers
+  // of the same flight
+  std::unique_ptr<recommendation::ExpiringCache<flight::FlightResponse>>
+      flight_cache_;
+  // concurrent misses of the same flight share one fetch
+  recommendation::SingleFlight<flight::FlightResponse> flight_single_flight_;
   DISALLOW_COPY_AND_ASSIGN(FlightPushProcessor);
 };
 
@@ -0,0 +1,187 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/push_controller/hotel/geocode_cache.h"
+
+#include <stdio.h>
+
+#include <fstream>
+
+#include "base/log.h"
+#include "base/string_util.h"
+
+namespace {
+
+static const char kFullWidthSpace[] = "\xE3\x80\x80";
+
+}
+
+namespace push_controller {
+
+GeocodeCache::GeocodeCache(const string& snapshot_path, size_t max_size,
+                           int negative_ttl_seconds,
+                           int snapshot_interval_seconds)
+  : snapshot_path_(snapshot_path),
+    max_size_(max_size),
+    negative_ttl_seconds_(negative_ttl_seconds),
+    snapshot_interval_seconds_(snapshot_interval_seconds),
+    is_dirty_(false),
+    last_save_time_(time(NULL)),
+    negative_cache_(max_size),
+    hit_cnt_(0),
+    negative_hit_cnt_(0),
+    load_cnt_(0) {}
+
+GeocodeCache::~GeocodeCache() {
+  if (is_dirty_) {
+    SaveSnapshot();
+  }
+}
+
+bool GeocodeCache::Get(const string& address, const Loader& loader,
+                       string* geo) {
+  string key = NormalizeAddress(address);
+  if (key.empty()) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = geos_.find(key);
+    if (it != geos_.end()) {
+      ++hit_cnt_;
+      *geo = it->second;
+      return true;
+    }
+  }
+  bool is_not_found = false;
+  if (negative_cache_.Get(key, &is_not_found)) {
+    ++negative_hit_cnt_;
+    VLOG(2) << "unresolvable address:" << address;
+    return false;
+  }
+  auto counted_loader = [this, &loader](GeocodeResult* result) {
+    ++load_cnt_;
+    return loader(result);
+  };
+  GeocodeResult result;
+  if (!single_flight_.Do(key, counted_loader, &result)) {
+    return false;
+  }
+  Put(key, result);
+  if (!result.is_found) {
+    return false;
+  }
+  *geo = result.geo;
+  return true;
+}
+
+void GeocodeCache::Put(const string& key, const GeocodeResult& result) {
+  if (!result.is_found) {
+    negative_cache_.Put(key, true, negative_ttl_seconds_);
+    return;
+  }
+  time_t now = time(NULL);
+  bool need_save = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (geos_.size() >= max_size_ && geos_.find(key) == geos_.end()) {
+      return;
+    }
+    geos_[key] = result.geo;
+    is_dirty_ = true;
+    if (!snapshot_path_.empty() &&
+        now - last_save_time_ >= snapshot_interval_seconds_) {
+      last_save_time_ = now;
+      need_save = true;
+    }
+  }
+  if (need_save) {
+    SaveSnapshot();
+  }
+}
+
+bool GeocodeCache::LoadSnapshot() {
+  if (snapshot_path_.empty()) {
+    return false;
+  }
+  std::ifstream snapshot(snapshot_path_.c_str());
+  if (!snapshot.is_open()) {
+    LOG(WARNING) << "no geocode snapshot:" << snapshot_path_;
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  string line;
+  while (std::getline(snapshot, line) && geos_.size() < max_size_) {
+    size_t pos = line.find('\t');
+    if (pos == string::npos || pos == 0 || pos + 1 == line.size()) {
+      continue;
+    }
+    geos_[line.substr(0, pos)] = line.substr(pos + 1);
+  }
+  LOG(INFO) << "loaded geocode snapshot:" << snapshot_path_
+            << ", size:" << geos_.size();
+  return true;
+}
+
+bool GeocodeCache::SaveSnapshot() {
+  if (snapshot_path_.empty()) {
+    return false;
+  }
+  // one writer of the tmp file at a time, saves land in the order they
+  // read the cache
+  std::lock_guard<std::mutex> save_lock(save_mutex_);
+  string content;
+  size_t size = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size = geos_.size();
+    for (auto& entry : geos_) {
+      content.append(entry.first).append("\t").append(entry.second);
+      content.append("\n");
+    }
+    is_dirty_ = false;
+  }
+  // written aside and renamed, a crash never leaves a partial snapshot
+  string tmp_path = snapshot_path_ + ".tmp";
+  {
+    std::ofstream snapshot(tmp_path.c_str(), std::ios::trunc);
+    snapshot << content;
+    if (!snapshot.good()) {
+      LOG(ERROR) << "write geocode snapshot failed:" << tmp_path;
+      return false;
+    }
+  }
+  if (rename(tmp_path.c_str(), snapshot_path_.c_str()) != 0) {
+    LOG(ERROR) << "rename geocode snapshot failed:" << snapshot_path_;
+    return false;
+  }
+  LOG(INFO) << "saved geocode snapshot:" << snapshot_path_
+            << ", size:" << size << ", hit:" << hit_cnt_
+            << ", negative hit:" << negative_hit_cnt_
+            << ", load:" << load_cnt_
+            << ", shared:" << single_flight_.shared_count();
+  return true;
+}
+
+string GeocodeCache::NormalizeAddress(const string& address) {
+  string normalized;
+  normalized.reserve(address.size());
+  for (size_t i = 0; i < address.size(); ++i) {
+    if (address.compare(i, sizeof(kFullWidthSpace) - 1,
+                        kFullWidthSpace) == 0) {
+      i += sizeof(kFullWidthSpace) - 2;
+      continue;
+    }
+    char c = address[i];
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+      continue;
+    }
+    if (c >= 'A' && c <= 'Z') {
+      c = c - 'A' + 'a';
+    }
+    normalized.push_back(c);
+  }
+  return normalized;
+}
+
+}  // namespace push_controller
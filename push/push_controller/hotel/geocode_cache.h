@@ -0,0 +1,72 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#ifndef PUSH_PUSH_CONTROLLER_HOTEL_GEOCODE_CACHE_H_
+#define PUSH_PUSH_CONTROLLER_HOTEL_GEOCODE_CACHE_H_
+
+#include <time.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+#include "base/basictypes.h"
+#include "base/compat.h"
+
+#include "push/util/cache_util.h"
+
+namespace push_controller {
+
+struct GeocodeResult {
+  GeocodeResult() : is_found(false) {}
+  bool is_found;
+  // "lat,lng"
+  string geo;
+};
+
+// Geocodes of addresses by normalized address. Resolved addresses are kept
+// in memory and written to a snapshot file so a restart starts warm, the
+// unresolvable ones are remembered for negative_ttl_seconds.
+class GeocodeCache {
+ public:
+  // Returns false if the service failed, sets is_found to false if it
+  // could not resolve the address.
+  typedef std::function<bool(GeocodeResult* result)> Loader;
+
+  GeocodeCache(const string& snapshot_path, size_t max_size,
+               int negative_ttl_seconds, int snapshot_interval_seconds);
+  // Saves the snapshot if it changed.
+  ~GeocodeCache();
+  // Calls loader on a miss, concurrent misses of an address share one call.
+  bool Get(const string& address, const Loader& loader, string* geo);
+  // Snapshot lines are "normalized address\tlat,lng".
+  bool LoadSnapshot();
+  bool SaveSnapshot();
+  // Drops the whitespace, full width spaces included, and lowers ASCII.
+  static string NormalizeAddress(const string& address);
+
+ private:
+  void Put(const string& key, const GeocodeResult& result);
+
+  string snapshot_path_;
+  size_t max_size_;
+  int negative_ttl_seconds_;
+  int snapshot_interval_seconds_;
+  std::mutex mutex_;
+  // held across a whole save, the signal thread may save concurrently
+  std::mutex save_mutex_;
+  std::unordered_map<string, string> geos_;
+  bool is_dirty_;
+  time_t last_save_time_;
+  recommendation::ExpiringCache<bool> negative_cache_;
+  recommendation::SingleFlight<GeocodeResult> single_flight_;
+  std::atomic<uint64> hit_cnt_;
+  std::atomic<uint64> negative_hit_cnt_;
+  std::atomic<uint64> load_cnt_;
+  DISALLOW_COPY_AND_ASSIGN(GeocodeCache);
+};
+
+}  // namespace push_controller
+
+#endif  // PUSH_PUSH_CONTROLLER_HOTEL_GEOCODE_CACHE_H_
@@ -0,0 +1,86 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/push_controller/hotel/geocode_cache.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "third_party/gtest/gtest.h"
+
+using namespace push_controller;
+
+namespace {
+
+GeocodeCache::Loader FoundLoader(int* call_cnt, const string& geo) {
+  return [call_cnt, geo](GeocodeResult* result) {
+    ++*call_cnt;
+    result->is_found = true;
+    result->geo = geo;
+    return true;
+  };
+}
+
+}
+
+TEST(GeocodeCache, NormalizeAddress) {
+  EXPECT_EQ(u8"北京市海淀区abc1号",
+            GeocodeCache::NormalizeAddress(u8" 北京市　海淀区 ABC 1号\t"));
+  EXPECT_EQ("", GeocodeCache::NormalizeAddress(u8" 　"));
+}
+
+TEST(GeocodeCache, HitByNormalizedAddress) {
+  GeocodeCache cache("", 100, 60, 60);
+  int call_cnt = 0;
+  string geo;
+  EXPECT_TRUE(cache.Get(u8"北京市 海淀区", FoundLoader(&call_cnt, "39.9,116.3"),
+                        &geo));
+  EXPECT_EQ("39.9,116.3", geo);
+  geo.clear();
+  EXPECT_TRUE(cache.Get(u8"北京市海淀区", FoundLoader(&call_cnt, "0,0"),
+                        &geo));
+  EXPECT_EQ("39.9,116.3", geo);
+  EXPECT_EQ(1, call_cnt);
+}
+
+TEST(GeocodeCache, NegativeAndFailedLoads) {
+  GeocodeCache cache("", 100, 60, 60);
+  int call_cnt = 0;
+  auto not_found = [&call_cnt](GeocodeResult* result) {
+    ++call_cnt;
+    result->is_found = false;
+    return true;
+  };
+  string geo;
+  EXPECT_FALSE(cache.Get("nowhere", not_found, &geo));
+  EXPECT_FALSE(cache.Get("nowhere", not_found, &geo));
+  EXPECT_EQ(1, call_cnt);
+  // a failed service call is not remembered
+  auto failed = [&call_cnt](GeocodeResult* result) {
+    ++call_cnt;
+    return false;
+  };
+  EXPECT_FALSE(cache.Get("somewhere", failed, &geo));
+  EXPECT_FALSE(cache.Get("somewhere", failed, &geo));
+  EXPECT_EQ(3, call_cnt);
+}
+
+TEST(GeocodeCache, Snapshot) {
+  char path[] = "/tmp/geocode_cache_test_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  int call_cnt = 0;
+  string geo;
+  {
+    GeocodeCache cache(path, 100, 60, 3600);
+    EXPECT_TRUE(cache.Get("a", FoundLoader(&call_cnt, "1,2"), &geo));
+    EXPECT_TRUE(cache.Get("b", FoundLoader(&call_cnt, "3,4"), &geo));
+  }
+  GeocodeCache cache(path, 100, 60, 3600);
+  EXPECT_TRUE(cache.LoadSnapshot());
+  EXPECT_TRUE(cache.Get("b", FoundLoader(&call_cnt, "0,0"), &geo));
+  EXPECT_EQ("3,4", geo);
+  EXPECT_EQ(2, call_cnt);
+  unlink(path);
+}
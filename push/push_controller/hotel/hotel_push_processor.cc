@@ -7,17 +7,35 @@ DECLARE_bool(use_hotel);
 DECLARE_bool(use_version_filter);
 
 DECLARE_string(location_service);
+DECLARE_string(hotel_geocode_snapshot);
+DECLARE_int32(hotel_geocode_negative_ttl_seconds);
+DECLARE_int32(hotel_geocode_snapshot_interval_seconds);
 DECLARE_string(hotel_version_greater);
 DECLARE_string(hotel_version_equal);
 
+namespace {
+
+static const size_t kGeocodeCacheSize = 200000;
+
+}
+
 namespace push_controller {
 
 HotelPushProcessor::HotelPushProcessor() {
   VLOG(2) << "HotelPushProcessor::HotelPushProcessor()";
+  geocode_cache_.reset(new GeocodeCache(
+      FLAGS_hotel_geocode_snapshot, kGeocodeCacheSize,
+      FLAGS_hotel_geocode_negative_ttl_seconds,
+      FLAGS_hotel_geocode_snapshot_interval_seconds));
+  geocode_cache_->LoadSnapshot();
 }
 
 HotelPushProcessor::~HotelPushProcessor() {}
 
+void HotelPushProcessor::SaveGeocodeSnapshot() {
+  geocode_cache_->SaveSnapshot();
+}
+
 bool HotelPushProcessor::Process(PushEventInfo* push_event) {
   VLOG(2) << "HotelPushProcessor::Process() ...";
   UserOrderInfo user_order;
@@ -31,8 +49,7 @@ bool HotelPushProcessor::Process(PushEventInfo* push_event) {
     return false;
   }
   VLOG(2) << "ParseDetail success, id:" << push_event->id();
-  Json::Value message;
-  if (!BuildPushMessage(user_order, *push_event, &message)) {
+  if (!BuildPushMessage(user_order, *push_event, &message_buffer_)) {
     LOG(ERROR) << "BuildPushMessage failed, id:" << push_event->id();
     return false;
   }
@@ -49,12 +66,12 @@ bool HotelPushProcessor::Process(PushEventInfo* push_event) {
     }
     string message_desc = business_key_map_[push_event->business_type()];
     if (!push_sender_->SendPush(kMessageGeneral, message_desc,
-                                push_event->user_id(),message)) {
+                                push_event->user_id(), message_buffer_)) {
       LOG(ERROR) << "SendPush failed,id:" << push_event->id();
       return false;
     }
     VLOG(2) << "SendPush success, id:" << push_event->id();
-    UploadPushDataToKafka(user_order, *push_event, message);
+    UploadPushDataToKafka(user_order, *push_event, message_buffer_);
   } else {
     LOG(WARNING) << "hotel push disabled or version unsupported, won't send msg, id:"
                  << push_event->id() << ", version:"
@@ -107,30 +124,31 @@ bool HotelPushProcessor::ParseDetail(UserOrderInfo* user_order) {
 
 bool HotelPushProcessor::BuildPushMessage(const UserOrderInfo& user_order,
                                           const PushEventInfo& push_event,
-                                          Json::Value* message) {
+                                          string* message) {
   if (push_event.event_type() != kEventRemindTimelineToday &&
       push_event.event_type() != kEventRemindTimelineLastDay) {
     LOG(ERROR) << "ERR push event type" << push_event.event_type();
     return false;
   }
-  if (!AppendCommonField(user_order, push_event, message)) {
+  PushContent content;
+  if (!AppendCommonField(user_order, push_event, &content)) {
     return false;
   }
-  LOG(INFO) << "MESSAGE:" << JsonToString(*message);
+  RenderPushContent(content, message);
+  VLOG(2) << "MESSAGE:" << *message;
   return true;
 }
 
 bool HotelPushProcessor::AppendCommonField(const UserOrderInfo& user_order,
                                            const PushEventInfo& push_event,
-                                           Json::Value* msg) {
-  Json::Value& message = *msg;
+                                           PushContent* push_content) {
+  PushContent& content = *push_content;
   const UserHotelInfo& user_hotel_info =
     user_order.business_info().user_hotel_info();
   string geo;
   if (!GetLocation(user_hotel_info.address(), &geo)) {
     return false;
   }
-  PushContent content;
   content.status = "success";
   content.id = user_order.id();
   content.event_key = event_key_map_[push_event.event_type()];
@@ -206,14 +224,29 @@ bool HotelPushProcessor::AppendCommonField(const UserOrderInfo& user_order,
   detail.link_list.push_back(detail_taxi);
   detail.link_list.push_back(detail_callup);
   content.detail = detail;
-  SetGeneralPushContent(content, message);
   return true;
 }
 
 bool HotelPushProcessor::GetLocation(const string& address, string* geo) {
+  auto loader = [this, &address](GeocodeResult* result) {
+    return FetchLocation(address, result);
+  };
+  if (!geocode_cache_->Get(address, loader, geo)) {
+    LOG(ERROR) << "get location lng and lat faild, address:" << address;
+    return false;
+  }
+  return true;
+}
+
+bool HotelPushProcessor::FetchLocation(const string& address,
+                                       GeocodeResult* result) {
   string url = StringPrintf(FLAGS_location_service.c_str(), address.c_str());
   util::HttpClient http_client;
-  http_client.FetchUrl(url);
+  if (!http_client.FetchUrl(url) || http_client.response_code() != 200) {
+    LOG(ERROR) << "fetch location failed, code:"
+               << http_client.response_code();
+    return false;
+  }
   string response_body = http_client.ResponseBody();
   Json::Value response;
   Json::Reader reader;
@@ -223,16 +256,20 @@ bool HotelPushProcessor::GetLocation(const string& address, string* geo) {
     LOG(ERROR) << "response parse failed: " << e.what();
     return false;
   }
-  if ("success" == response["status"].asString()) {
-    const Json::Value& data_list = response["result"];
-    for (Json::ArrayIndex index = 0; index < data_list.size(); ++index) {
-      *geo = data_list[index]["answer"]["lat"].asString() + ","
-           + data_list[index]["answer"]["lng"].asString();
-      return true;
+  if ("success" != response["status"].asString()) {
+    LOG(ERROR) << "location service failed, status:" << response["status"];
+    return false;
+  }
+  const Json::Value& data_list = response["result"];
+  result->is_found = false;
+  if (data_list.size() > 0) {
+    const Json::Value& answer = data_list[0]["answer"];
+    if (answer.isMember("lat") && answer.isMember("lng")) {
+      result->is_found = true;
+      result->geo = answer["lat"].asString() + "," + answer["lng"].asString();
     }
   }
-  LOG(ERROR) << "get location lng and lat faild";
-  return false;
+  return true;
 }
 
 }  // namespace push_controller
@@ -4,6 +4,9 @@
 #ifndef PUSH_PUSH_CONTROLLER_HOTEL_PUSH_PROCESSOR_H_
 #define PUSH_PUSH_CONTROLLER_HOTEL_PUSH_PROCESSOR_H_
 
+#include <memory>
+
+#include "push/push_controller/hotel/geocode_cache.h"
 #include "push/push_controller/push_processor.h"
 
 namespace push_controller {
@@ -14,14 +17,22 @@ class HotelPushProcessor : public PushProcessor {
   virtual ~HotelPushProcessor();
   virtual bool Process(PushEventInfo* push_event);
   bool ParseDetail(UserOrderInfo* user_order);
+  // Renders the message into message, see RenderPushContent.
   bool BuildPushMessage(const UserOrderInfo& user_order,
-		                    const PushEventInfo& push_event,
-						            Json::Value* message);
+                        const PushEventInfo& push_event,
+                        string* message);
+  // Called on shutdown, the processor itself is never destroyed.
+  void SaveGeocodeSnapshot();
  private:
   bool AppendCommonField(const UserOrderInfo& user_order,
-		                     const PushEventInfo& push_event,
-						             Json::Value* message);
+                         const PushEventInfo& push_event,
+                         PushContent* content);
+  // Served by geocode_cache_, previously seen hotels never reach
+  // --location_service.
   bool GetLocation(const string& address, string* geo);
+  bool FetchLocation(const string& address, GeocodeResult* result);
+
+  std::unique_ptr<GeocodeCache> geocode_cache_;
   DISALLOW_COPY_AND_ASSIGN(HotelPushProcessor);
 };
 
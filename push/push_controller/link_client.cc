@@ -0,0 +1,234 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/push_controller/link_client.h"
+
+#include <algorithm>
+
+#include "base/log.h"
+
+namespace push_controller {
+
+LinkClient::LinkClient(const string& push_url, const string& batch_push_url,
+                       int connection_num, int batch_size)
+  : push_url_(push_url),
+    batch_push_url_(batch_push_url),
+    batch_size_(static_cast<size_t>(std::max(batch_size, 1))),
+    next_connection_(0),
+    request_cnt_(0),
+    push_cnt_(0),
+    push_fail_cnt_(0),
+    job_generation_(0),
+    job_task_num_(0),
+    job_worker_num_(0),
+    job_running_worker_num_(0),
+    job_task_(NULL),
+    job_next_index_(0),
+    stopped_(false) {
+  CHECK(connection_num > 0) << "invalid connection_num:" << connection_num;
+  for (int i = 0; i < connection_num; ++i) {
+    connections_.emplace_back(new Connection());
+  }
+  // a single connection is driven by the calling thread
+  if (connections_.size() > 1) {
+    for (size_t i = 0; i < connections_.size(); ++i) {
+      workers_.emplace_back(&LinkClient::WorkerLoop, this, i);
+    }
+  }
+}
+
+LinkClient::~LinkClient() {
+  {
+    std::lock_guard<std::mutex> lock(job_mutex_);
+    stopped_ = true;
+  }
+  job_cond_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+bool LinkClient::Send(const string& push_request) {
+  Connection* connection =
+      connections_[next_connection_++ % connections_.size()].get();
+  std::lock_guard<std::mutex> lock(connection->mutex);
+  return SendOne(connection, push_request);
+}
+
+void LinkClient::SendBatch(const vector<string>& push_requests,
+                           vector<bool>* results) {
+  // vector<bool> packs bits, the workers write to their own chars instead
+  vector<char> accepted(push_requests.size(), 0);
+  if (batch_push_url_.empty()) {
+    RunOnConnections(push_requests.size(),
+        [this, &push_requests, &accepted](Connection* connection, size_t i) {
+          accepted[i] = SendOne(connection, push_requests[i]);
+        });
+  } else {
+    size_t batch_num = (push_requests.size() + batch_size_ - 1) / batch_size_;
+    RunOnConnections(batch_num,
+        [this, &push_requests, &accepted](Connection* connection, size_t i) {
+          size_t begin = i * batch_size_;
+          size_t end = std::min(begin + batch_size_, push_requests.size());
+          SendOneBatch(connection, push_requests, begin, end, &accepted);
+        });
+  }
+  results->assign(accepted.begin(), accepted.end());
+}
+
+void LinkClient::GetStats(Json::Value* stats) {
+  (*stats)["connection_num"] = static_cast<Json::UInt64>(connections_.size());
+  (*stats)["request_cnt"] = static_cast<Json::UInt64>(request_cnt_);
+  (*stats)["push_cnt"] = static_cast<Json::UInt64>(push_cnt_);
+  (*stats)["push_fail_cnt"] = static_cast<Json::UInt64>(push_fail_cnt_);
+}
+
+bool LinkClient::Post(Connection* connection, const string& url,
+                      const string& post_data, Json::Value* result) {
+  ++request_cnt_;
+  // Reset keeps the underlying connection open for the next request
+  util::HttpClient& http_client = connection->http_client;
+  http_client.Reset();
+  http_client.SetHttpMethod(util::HttpMethod::kPost);
+  http_client.AddHeader("Content-Type", "application/json; charset=utf-8");
+  http_client.AddHeader("Connection", "keep-alive");
+  http_client.SetPostData(post_data);
+  if (!http_client.FetchUrl(url)) {
+    LOG(ERROR) << "post to link server failed, url:" << url
+               << ", response: " << http_client.ResponseBody();
+    return false;
+  }
+  Json::Reader reader;
+  if (!reader.parse(http_client.ResponseBody(), *result) ||
+      !result->isObject()) {
+    LOG(ERROR) << "bad link server response: " << http_client.ResponseBody();
+    return false;
+  }
+  return true;
+}
+
+bool LinkClient::SendOne(Connection* connection, const string& push_request) {
+  ++push_cnt_;
+  VLOG(1) << "SEND push request: " << push_request;
+  Json::Value result;
+  if (Post(connection, push_url_, push_request, &result) &&
+      result.isMember("status") && result["status"] == true) {
+    VLOG(1) << "SEND push success";
+    return true;
+  }
+  ++push_fail_cnt_;
+  LOG(ERROR) << "send push failed, response: " << result.toStyledString();
+  return false;
+}
+
+void LinkClient::SendOneBatch(Connection* connection,
+                              const vector<string>& push_requests,
+                              size_t begin, size_t end,
+                              vector<char>* accepted) {
+  push_cnt_ += end - begin;
+  string post_data = "{\"pushes\":[";
+  for (size_t i = begin; i < end; ++i) {
+    const string& push_request = push_requests[i];
+    size_t size = push_request.size();
+    // the rendered requests end with the newline of FastWriter
+    if (size > 0 && push_request[size - 1] == '\n') {
+      --size;
+    }
+    if (i != begin) {
+      post_data.push_back(',');
+    }
+    post_data.append(push_request, 0, size);
+  }
+  post_data.append("]}");
+  VLOG(1) << "SEND batch push request, push_cnt:" << end - begin;
+  Json::Value result;
+  if (!Post(connection, batch_push_url_, post_data, &result) ||
+      result["status"] != true) {
+    push_fail_cnt_ += end - begin;
+    LOG(ERROR) << "send batch push failed, push_cnt:" << end - begin;
+    return;
+  }
+  const Json::Value& results = result["results"];
+  if (!results.isArray() || results.size() != end - begin) {
+    push_fail_cnt_ += end - begin;
+    LOG(ERROR) << "bad batch push results, push_cnt:" << end - begin
+               << ", response: " << result.toStyledString();
+    return;
+  }
+  int fail_cnt = 0;
+  for (size_t i = begin; i < end; ++i) {
+    const Json::Value& status = results[static_cast<int>(i - begin)];
+    (*accepted)[i] = status.isBool() && status.asBool();
+    if (!(*accepted)[i]) {
+      ++fail_cnt;
+    }
+  }
+  push_fail_cnt_ += fail_cnt;
+  VLOG(1) << "SEND batch push finished, push_cnt:" << end - begin
+          << ", fail_cnt:" << fail_cnt;
+}
+
+void LinkClient::RunOnConnections(
+    size_t task_num,
+    const std::function<void(Connection*, size_t)>& task) {
+  std::lock_guard<std::mutex> run_lock(run_mutex_);
+  size_t worker_num = std::min(task_num, connections_.size());
+  if (worker_num <= 1) {
+    if (task_num > 0) {
+      job_next_index_ = 0;
+      RunTasks(0, task_num, task);
+    }
+    return;
+  }
+  std::unique_lock<std::mutex> lock(job_mutex_);
+  job_task_num_ = task_num;
+  job_worker_num_ = worker_num;
+  job_running_worker_num_ = worker_num;
+  job_task_ = &task;
+  job_next_index_ = 0;
+  ++job_generation_;
+  job_cond_.notify_all();
+  job_done_cond_.wait(lock, [this] { return job_running_worker_num_ == 0; });
+  job_task_ = NULL;
+}
+
+void LinkClient::WorkerLoop(size_t worker_index) {
+  uint64 generation = 0;
+  while (true) {
+    size_t task_num = 0;
+    const std::function<void(Connection*, size_t)>* task = NULL;
+    {
+      std::unique_lock<std::mutex> lock(job_mutex_);
+      job_cond_.wait(lock, [this, generation] {
+        return stopped_ || job_generation_ != generation;
+      });
+      if (stopped_) {
+        return;
+      }
+      generation = job_generation_;
+      // small jobs need fewer workers than connections
+      if (worker_index >= job_worker_num_) {
+        continue;
+      }
+      task_num = job_task_num_;
+      task = job_task_;
+    }
+    RunTasks(worker_index, task_num, *task);
+    std::lock_guard<std::mutex> lock(job_mutex_);
+    if (--job_running_worker_num_ == 0) {
+      job_done_cond_.notify_one();
+    }
+  }
+}
+
+void LinkClient::RunTasks(
+    size_t worker_index, size_t task_num,
+    const std::function<void(Connection*, size_t)>& task) {
+  Connection* connection = connections_[worker_index].get();
+  std::lock_guard<std::mutex> lock(connection->mutex);
+  for (size_t i = job_next_index_++; i < task_num; i = job_next_index_++) {
+    task(connection, i);
+  }
+}
+
+}  // namespace push_controller
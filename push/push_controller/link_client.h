@@ -0,0 +1,98 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#ifndef PUSH_PUSH_CONTROLLER_LINK_CLIENT_H_
+#define PUSH_PUSH_CONTROLLER_LINK_CLIENT_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "base/basictypes.h"
+#include "base/compat.h"
+#include "third_party/jsoncpp/json.h"
+#include "util/net/http_client/http_client.h"
+
+namespace push_controller {
+
+// Client of the link server. It keeps connection_num HttpClients and
+// reuses them between requests, so consecutive pushes go over keep-alive
+// connections instead of a new tcp connection each. Thread safe.
+//
+// If batch_push_url is set, SendBatch posts up to batch_size pushes in one
+// request:
+//   {"pushes":[<push request>, ...]}
+// and expects the result of each recipient in the same order:
+//   {"status":true,"results":[true, false, ...]}
+// Otherwise the pushes are posted one by one to push_url, spread over the
+// connections. With more than one connection, each is driven by its own
+// long-lived worker thread during SendBatch.
+class LinkClient {
+ public:
+  LinkClient(const string& push_url, const string& batch_push_url,
+             int connection_num, int batch_size);
+  ~LinkClient();
+  // Posts one push request, returns whether the link server accepted it.
+  bool Send(const string& push_request);
+  // (*results)[i] tells whether push_requests[i] is accepted.
+  void SendBatch(const vector<string>& push_requests, vector<bool>* results);
+  void GetStats(Json::Value* stats);
+
+ private:
+  struct Connection {
+    std::mutex mutex;
+    util::HttpClient http_client;
+  };
+
+  // Posts post_data over connection, which the caller has locked.
+  bool Post(Connection* connection, const string& url,
+            const string& post_data, Json::Value* result);
+  bool SendOne(Connection* connection, const string& push_request);
+  // Sends push_requests[begin, end) in one batch request.
+  void SendOneBatch(Connection* connection,
+                    const vector<string>& push_requests,
+                    size_t begin, size_t end, vector<char>* accepted);
+  // Runs task(connection, i) for i in [0, task_num), each worker thread
+  // owns one connection. Calls are serialized.
+  void RunOnConnections(
+      size_t task_num,
+      const std::function<void(Connection*, size_t)>& task);
+  // Waits for the jobs of RunOnConnections, sending over
+  // connections_[worker_index].
+  void WorkerLoop(size_t worker_index);
+  // Takes tasks of the current job until none is left.
+  void RunTasks(size_t worker_index, size_t task_num,
+                const std::function<void(Connection*, size_t)>& task);
+
+  string push_url_;
+  string batch_push_url_;
+  size_t batch_size_;
+  vector<std::unique_ptr<Connection>> connections_;
+  std::atomic<size_t> next_connection_;
+  std::atomic<uint64> request_cnt_;
+  std::atomic<uint64> push_cnt_;
+  std::atomic<uint64> push_fail_cnt_;
+
+  // serializes RunOnConnections
+  std::mutex run_mutex_;
+  // the current job of the workers, the fields below are guarded by it
+  std::mutex job_mutex_;
+  std::condition_variable job_cond_;
+  std::condition_variable job_done_cond_;
+  uint64 job_generation_;
+  size_t job_task_num_;
+  size_t job_worker_num_;
+  size_t job_running_worker_num_;
+  const std::function<void(Connection*, size_t)>* job_task_;
+  std::atomic<size_t> job_next_index_;
+  bool stopped_;
+  vector<std::thread> workers_;
+  DISALLOW_COPY_AND_ASSIGN(LinkClient);
+};
+
+}  // namespace push_controller
+
+#endif  // PUSH_PUSH_CONTROLLER_LINK_CLIENT_H_
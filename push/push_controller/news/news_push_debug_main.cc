@@ -16,6 +16,10 @@ DEFINE_bool(use_channel_filter, false, "");
 DEFINE_bool(enable_load_devices, false, "");
 
 DEFINE_int32(mysql_page_size, 10000, "");
+DEFINE_int32(device_cache_seconds, 600, "");
+DEFINE_int32(device_cache_size, 200000, "");
+DEFINE_int32(push_queue_capacity, 10000, "");
+DEFINE_int32(valid_push_time_internal, 1200, "");
 DEFINE_int32(recommendation_content_expire_seconds, 3 * 24 * 3600, "");
 DEFINE_int32(redis_expire_time,
     48 * 60 * 60, "redis expire time internal");
@@ -26,12 +30,23 @@ DEFINE_int32(zookeeper_reconnect_attempt, 5, "");
 DEFINE_int32(zookeeper_check_interval, 5, "(In Seconds)");
 DEFINE_int32(zookeeper_default_node_port, 9048, "");
 
+DEFINE_string(push_deadline_slack, "1:1200,2:1200,3:900,4:600,5:120,6:120,"
+              "7:180,8:120,9:600,10:300", "");
 DEFINE_string(mysql_config,
     "config/push/push_controller/mysql_server_test.conf", "");
 DEFINE_string(link_server,
     "http://link-server/api/push_message/to_user_device", "link server addr");
+DEFINE_string(link_server_batch, "",
+    "batch push addr of link server, pushes go one by one if empty");
+DEFINE_int32(link_connection_num, 4, "keep-alive connections to link server");
+DEFINE_int32(link_batch_size, 100, "max recipients of a batch push");
 DEFINE_string(recommender_server,
     "http://news-recommender-server-main/news/recommender/recommendation?user_id=%s", "");
+DEFINE_string(recommender_batch_server,
+    "http://news-recommender-server-main/news/recommender/batch_recommendation",
+    "empty asks --recommender_server device by device");
+DEFINE_int32(recommender_batch_size, 100,
+             "devices of one batch recommendation request");
 DEFINE_string(device_test, "a960d251aa89828eb49c8ec701efb6bd", "");
 DEFINE_string(redis_conf,
     "config/onebox/news/redis.conf", "redis config");
@@ -3,6 +3,8 @@
 
 #include "push/push_controller/news/news_push_processor.h"
 
+#include <algorithm>
+
 #include "base/base64.h"
 #include "base/singleton.h"
 #include "base/string_util.h"
@@ -14,6 +16,7 @@
 
 #include "push/push_controller/push_processor.h"
 #include "push/util/zookeeper_util.h"
+#include "recommendation/news/recommender/news_response.h"
 
 DECLARE_bool(is_test);
 DECLARE_bool(use_cluster_mode);
@@ -21,9 +24,11 @@ DECLARE_bool(use_version_filter);
 DECLARE_bool(use_channel_filter);
 
 DECLARE_int32(recommendation_content_expire_seconds);
+DECLARE_int32(recommender_batch_size);
 
 DECLARE_string(device_test);
 DECLARE_string(recommender_server);
+DECLARE_string(recommender_batch_server);
 DECLARE_string(zookeeper_watched_path);
 DECLARE_string(news_version_greater);
 DECLARE_string(news_version_equal);
@@ -31,6 +36,7 @@ DECLARE_string(news_version_equal);
 namespace {
 
 static const char kRecContentKeyPrefix[] = "RECNEWS_";
+static const size_t kPushChunkSize = 1000;
 static const char kIconUrl[] =
   "http://image.ticwear.com/appstore/5d4ab957a08b748c55ead463f56ace3f";
 
@@ -48,10 +54,15 @@ namespace push_controller {
 
 NewsPushProcessor::NewsPushProcessor() {
   device_info_helper_ = Singleton<recommendation::DeviceInfoHelper>::get();
+  redis_pool_ = Singleton<recommendation::RedisConnectionPool>::get();
 }
 
 NewsPushProcessor::~NewsPushProcessor() {}
 
+void NewsPushProcessor::GetLinkStats(Json::Value* stats) {
+  push_sender_.GetLinkStats(stats);
+}
+
 bool NewsPushProcessor::Process() {
   vector<std::pair<string, string>> user_device_vec;
   if (FLAGS_is_test) {
@@ -82,9 +93,9 @@ bool NewsPushProcessor::Process() {
     }
   }
   LOG(INFO) << "News push start, user total:" << user_device_vec.size();
+  vector<std::pair<string, string>> push_user_devices;
   for (auto& user_device : user_device_vec) {
     recommendation::DeviceInfo device_info;
-    const string& user = user_device.first;
     const string& device = user_device.second;
     if (!GetDeviceInfo(device, &device_info)) {
       continue;
@@ -105,8 +116,36 @@ bool NewsPushProcessor::Process() {
         continue;
       }
     }
+    push_user_devices.push_back(user_device);
+  }
+  // sent in chunks, so the batches of the link server stay full
+  vector<PushRequest> pushes;
+  int success_cnt = 0;
+  size_t batch_size = static_cast<size_t>(
+      std::max(FLAGS_recommender_batch_size, 1));
+  map<string, Json::Value> rec_results_map;
+  for (size_t i = 0; i < push_user_devices.size(); ++i) {
+    const string& user = push_user_devices[i].first;
+    const string& device = push_user_devices[i].second;
+    if (i % batch_size == 0) {
+      vector<string> devices;
+      for (size_t j = i; j < std::min(i + batch_size,
+                                      push_user_devices.size()); ++j) {
+        devices.push_back(push_user_devices[j].second);
+      }
+      rec_results_map.clear();
+      GetRecLists(devices, &rec_results_map);
+    }
     Json::Value rec_results;
-    if (!GetRecList(device, &rec_results)) {
+    auto rec_it = rec_results_map.find(device);
+    if (rec_it != rec_results_map.end()) {
+      rec_results = rec_it->second;
+      if (rec_results["status"] != "success") {
+        LOG(ERROR) << "Get bad recommendation, device:" << device
+                   << ", rec_results:" << JsonToString(rec_results);
+        continue;
+      }
+    } else if (!GetRecList(device, &rec_results)) {
       LOG(ERROR) << "Get recommendation list failed, device:" << device;
       continue;
     }
@@ -126,16 +165,41 @@ bool NewsPushProcessor::Process() {
       LOG(ERROR) << "Save rec content to db failed, device:" << device;
       continue;
     }
-    if (!push_sender_.SendPush(kMessageWatchface, "news", user, message)) {
-      LOG(ERROR) << "Send push failed, type: news, User: " 
-                 << user << ", Device:" << device;
-      continue;
+    PushRequest push;
+    push.message_type = kMessageWatchface;
+    push.message_desc = "news";
+    push.user_id = user;
+    push.message_content = JsonToString(message);
+    if (!push.message_content.empty()) {
+      // the ending newline of FastWriter
+      push.message_content.resize(push.message_content.size() - 1);
+    }
+    pushes.push_back(push);
+    if (pushes.size() >= kPushChunkSize) {
+      success_cnt += SendPushes(&pushes);
     }
   }
-  LOG(INFO) << "News push finish";
+  success_cnt += SendPushes(&pushes);
+  LOG(INFO) << "News push finish, success:" << success_cnt;
   return true;
 }
 
+int NewsPushProcessor::SendPushes(vector<PushRequest>* pushes) {
+  vector<bool> results;
+  push_sender_.SendPushBatch(*pushes, &results);
+  int success_cnt = 0;
+  for (size_t i = 0; i < pushes->size(); ++i) {
+    if (results[i]) {
+      ++success_cnt;
+    } else {
+      LOG(ERROR) << "Send push failed, type: news, User: "
+                 << (*pushes)[i].user_id;
+    }
+  }
+  pushes->clear();
+  return success_cnt;
+}
+
 bool NewsPushProcessor::GetRecList(const string& device,
                                    Json::Value* rec_results) {
   string url = StringPrintf(FLAGS_recommender_server.c_str(), device.c_str());
@@ -155,6 +219,38 @@ bool NewsPushProcessor::GetRecList(const string& device,
   }
 }
 
+bool NewsPushProcessor::GetRecLists(
+    const vector<string>& devices,
+    map<string, Json::Value>* rec_results_map) {
+  if (FLAGS_recommender_batch_server.empty() || devices.empty()) {
+    return false;
+  }
+  Json::Value request;
+  Json::Value& user_ids = request["user_ids"];
+  for (auto& device : devices) {
+    user_ids.append(device);
+  }
+  util::HttpClient http_client;
+  http_client.SetHttpMethod(util::HttpMethod::kPost);
+  http_client.SetPostData(JsonToString(request));
+  http_client.AddHeader("Content-Type", "application/json; charset=utf-8");
+  if (!http_client.FetchUrl(FLAGS_recommender_batch_server) ||
+      http_client.response_code() != 200) {
+    LOG(ERROR) << "Get batch recommendation failed, devices:"
+               << devices.size() << ", code:" << http_client.response_code();
+    return false;
+  }
+  // unknown devices get an error result, which Process skips
+  if (!recommendation::ParseBatchNewsResponse(
+          http_client.ResponseBody(), devices, rec_results_map)) {
+    LOG(ERROR) << "Get bad batch recommendation, devices:" << devices.size();
+    return false;
+  }
+  VLOG(1) << "Batch recommendation, devices:" << devices.size()
+          << ", results:" << rec_results_map->size();
+  return true;
+}
+
 bool NewsPushProcessor::BuildPushMessage(
     const string& device, const recommendation::StoryDetail& rec_content,
     Json::Value* message) {
@@ -282,13 +378,18 @@ bool NewsPushProcessor::SaveRecContentToDb(const string& device,
     return false;
   }
   string id = kRecContentKeyPrefix + rec_content.id();
+  recommendation::RedisLease redis_lease = redis_pool_->Borrow();
+  if (!redis_lease.ok()) {
+    LOG(ERROR) << "Redis borrow connection failed, key:" << id;
+    return false;
+  }
   string value;
-  if (redis_client_.Get(id, &value) && !value.empty()) {
+  if (redis_lease->Get(id, &value) && !value.empty()) {
     LOG(INFO) << "News is in redis cache, need not set it, id:" << id;
     return true;
   }
-  if (!redis_client_.Set(id, encoded_rec_string,
-                         FLAGS_recommendation_content_expire_seconds)) {
+  if (!redis_lease->Set(id, encoded_rec_string,
+                        FLAGS_recommendation_content_expire_seconds)) {
     LOG(ERROR) << "Redis set failed, key:" << id << ", device:" << device
                << ", rec_string:" << rec_string;
     return false;
@@ -21,11 +21,16 @@ class NewsPushProcessor {
   NewsPushProcessor();
   ~NewsPushProcessor();
   bool Process();
+  void GetLinkStats(Json::Value* stats);
 
  private:
   friend struct DefaultSingletonTraits<NewsPushProcessor>;
 
   bool GetRecList(const string& device, Json::Value* rec_results);
+  // One request to --recommender_batch_server for all the devices, the
+  // devices missing from rec_results_map are asked one by one.
+  bool GetRecLists(const vector<string>& devices,
+                   map<string, Json::Value>* rec_results_map);
   bool BuildPushMessage(const string& device,
                         const recommendation::StoryDetail& rec_content,
                         Json::Value* message);
@@ -41,10 +46,12 @@ class NewsPushProcessor {
                           const recommendation::StoryDetail& rec_content);
   bool GetDeviceInfo(const string& device,
                      recommendation::DeviceInfo* device_info);
+  // Sends and clears pushes, returns the number of accepted ones.
+  int SendPushes(vector<PushRequest>* pushes);
 
   recommendation::DeviceInfoHelper* device_info_helper_;
   PushSender push_sender_;
-  recommendation::RedisReuseClient redis_client_;
+  recommendation::RedisConnectionPool* redis_pool_;
   DISALLOW_COPY_AND_ASSIGN(NewsPushProcessor);
 };
 
@@ -7,7 +7,10 @@
 #include "base/singleton.h"
 #include "third_party/jsoncpp/json.h"
 #include "util/net/util.h"
+#include "push/push_controller/business_factory.h"
 #include "push/push_controller/news/news_push_processor.h"
+#include "push/push_controller/push_pool_updater.h"
+#include "push/util/weather_helper.h"
 
 namespace serving {
 
@@ -23,6 +26,22 @@ bool StatusHandler::HandleRequest(util::HttpRequest* request,
   result["status"] = "ok";
   result["host"] = util::GetLocalHostName();
   result["service"] = "push controller service";
+  Singleton<push_controller::PushPoolUpdateStats>::get()->GetStats(
+      &result["push_pool_update"]);
+  Singleton<push_controller::WeatherCache>::get()->GetStats(
+      &result["weather_cache"]);
+  const push_controller::BusinessFactory::PushProcessorMapType&
+      push_processor_map = Singleton<push_controller::BusinessFactory>::get()->
+          push_processor_map();
+  for (auto it = push_processor_map.begin();
+       it != push_processor_map.end(); ++it) {
+    const string& business_name =
+        push_controller::BusinessType_Name(it->first);
+    it->second->GetQueueStats(&result["push_queue"][business_name]);
+    it->second->GetLinkStats(&result["link_client"][business_name]);
+  }
+  Singleton<push_controller::NewsPushProcessor>::get()->GetLinkStats(
+      &result["link_client"]["news"]);
   response->AppendBuffer(result.toStyledString());
   return true;
 }
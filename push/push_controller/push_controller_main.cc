@@ -1,7 +1,12 @@
 // Copyright 2016. All Rights Reserved.
 // Author: xjliu@mobvoi.com (Xiaojia Liu)
 
+#include <pthread.h>
+#include <signal.h>
+
+#include <functional>
 #include <memory>
+#include <thread>
 
 #include "base/at_exit.h"
 #include "base/binary_version.h"
@@ -13,6 +18,7 @@
 
 #include "push/push_controller/business_factory.h"
 #include "push/push_controller/business_processor.h"
+#include "push/push_controller/flight/flight_change_consumer.h"
 #include "push/push_controller/flight/flight_push_processor.h"
 #include "push/push_controller/hotel/hotel_push_processor.h"
 #include "push/push_controller/movie/movie_push_processor.h"
@@ -22,6 +28,7 @@
 #include "push/push_controller/push_pool_updater.h"
 #include "push/push_controller/push_controller_handler.h"
 #include "push/proto/push_meta.pb.h"
+#include "push/util/weather_helper.h"
 #include "push/util/zookeeper_util.h"
 
 DEFINE_bool(is_test, true, "");
@@ -32,13 +39,24 @@ DEFINE_bool(use_channel_filter, false, "");
 DEFINE_bool(enable_load_devices, false, "");
 DEFINE_bool(enable_schedule_push, false, "");
 DEFINE_bool(enable_update_push_pool, false, "");
+DEFINE_bool(enable_order_kafka_consumer, false,
+            "create push events from the orders published to kafka");
+DEFINE_bool(enable_flight_change_consumer, false,
+            "push the flight changes published by the flight info server");
+DEFINE_string(flight_change_topic, "flight_change",
+              "redis channel of the flight changes");
 
 DEFINE_int32(listen_port, 9048, "");
 DEFINE_int32(http_server_thread_num, 8, "");
 
 DEFINE_int32(valid_push_time_internal, 1200, "valid push_time internal");
 DEFINE_int32(pool_update_internal, 120, "push pool update schedule internal");
+DEFINE_int32(pool_reconcile_internal, 1800,
+             "push pool update internal when orders come from kafka");
 DEFINE_int32(push_scheduler_internal, 180, "push scheduler time internal");
+DEFINE_int32(push_queue_capacity, 10000, "max events queued per business");
+DEFINE_int32(push_backlog_capacity, 10000,
+             "max events per business waiting for room in its queue");
 
 DEFINE_int32(zookeeper_timeout, 3000, "(In MS)");
 DEFINE_int32(zookeeper_reconnect_attempt, 5, "");
@@ -49,6 +67,8 @@ DEFINE_int32(recommendation_content_expire_seconds, 3 * 24 * 3600, "");
 
 DEFINE_int32(db_batch_query_size, 100, "");
 DEFINE_int32(mysql_page_size, 10000, "");
+DEFINE_int32(device_cache_seconds, 600, "");
+DEFINE_int32(device_cache_size, 200000, "");
 DEFINE_int32(redis_expire_time, 48 * 60 * 60, "redis expire time internal");
 DEFINE_int32(redis_max_sleep, 128, "redis reconnect max sleep time");
 
@@ -56,24 +76,61 @@ DEFINE_string(user_feedback_service,
     "http://user-feedback-service/query_feedback", "user feedback url");
 DEFINE_string(flight_info_service,
     "http://flight-info-service/flight/query_flightinfo", "");
+DEFINE_int32(flight_status_cache_seconds, 600,
+    "seconds a flight status is cached by the push controller");
+DEFINE_int32(flight_status_near_cache_seconds, 60,
+    "seconds a flight status is cached close to the departure");
+DEFINE_int32(flight_status_near_departure_seconds, 3 * 3600,
+    "how close to the takeoff the shorter cache time is used");
 DEFINE_string(train_info_service,
     "http://train-info-service/train/query_timetable", "");
 
 DEFINE_string(location_service,
     "http://location-service/geocoder?address=%s", "");
+DEFINE_string(hotel_geocode_snapshot, "data/push/hotel_geocode_snapshot",
+              "snapshot of the hotel address geocodes, empty disables it");
+DEFINE_int32(hotel_geocode_negative_ttl_seconds, 3600,
+             "seconds to remember an unresolvable hotel address");
+DEFINE_int32(hotel_geocode_snapshot_interval_seconds, 300,
+             "min seconds between two geocode snapshots");
 
 DEFINE_string(weather_service, "https://m.mobvoi.com/search/pc", "");
+DEFINE_int32(weather_cache_update_seconds, 3600,
+             "interval of the forecast updates, 0 disables the weather cache");
+DEFINE_int32(weather_warmup_hour, 7,
+             "warm the weather cache before this hour, -1 disables it");
+DEFINE_int32(weather_warmup_lead_seconds, 600,
+             "seconds before --weather_warmup_hour to warm the weather cache");
 
 DEFINE_string(link_server,
     "http://link-server/api/push_message/to_user_device", "link server addr");
+DEFINE_string(link_server_batch, "",
+    "batch push addr of link server, pushes go one by one if empty");
+DEFINE_int32(link_connection_num, 4, "keep-alive connections to link server");
+DEFINE_int32(link_batch_size, 100, "max recipients of a batch push");
 
 DEFINE_string(recommender_server,
     "http://news-recommender-server-main/news/recommender/recommendation?user_id=%s", "");
+DEFINE_string(recommender_batch_server,
+    "http://news-recommender-server-main/news/recommender/batch_recommendation",
+    "empty asks --recommender_server device by device");
+DEFINE_int32(recommender_batch_size, 100,
+             "devices of one batch recommendation request");
 
 DEFINE_string(burypoint_kafka_log_server, "http://heartbeat-server/log/realtime", "");
 DEFINE_string(burypoint_kafka_topic, "intelligent-push", "");
 DEFINE_string(burypoint_upload_push_log_event_type, "test_push_controller_push_suc", "");
 DEFINE_string(burypoint_upload_fail_log_event_type, "test_push_controller_push_fail", "");
+DEFINE_string(push_deadline_slack, "1:1200,2:1200,3:900,4:600,5:120,6:120,"
+              "7:180,8:120,9:600,10:300",
+              "event_type:seconds after push_time a push is still useful");
+DEFINE_string(order_kafka_event_type, "test_message_receiver_parse",
+              "event of the orders uploaded by message receiver");
+DEFINE_int32(kafka_producer_flush_timeout, 10000, "");
+DEFINE_string(kafka_producer_config,
+    "config/push/push_controller/kafka_producer_test.conf", "");
+DEFINE_string(kafka_consumer_config,
+    "config/push/push_controller/kafka_consumer_test.conf", "");
 
 DEFINE_string(zookeeper_cluster_addr, "ali-hz-dev:2181", "");
 DEFINE_string(zookeeper_this_node_prefix, "/ns/intelligent_push/push_controller/replica_", "");
@@ -94,11 +151,40 @@ DEFINE_string(hotel_version_greater, "tic_4.9.0", "");
 
 using namespace push_controller;
 
+namespace {
+
+// Blocks SIGINT and SIGTERM in the calling thread and the threads it
+// starts later, they are taken by WaitForShutdown instead.
+void BlockShutdownSignals(sigset_t* signals) {
+  sigemptyset(signals);
+  sigaddset(signals, SIGINT);
+  sigaddset(signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, signals, NULL);
+}
+
+// Serv() never returns, so the state worth keeping is saved here, outside
+// of a signal handler, before the signal takes its default action.
+void WaitForShutdown(sigset_t signals,
+                     HotelPushProcessor* hotel_push_processor) {
+  int signal_number = 0;
+  sigwait(&signals, &signal_number);
+  LOG(INFO) << "shutdown on signal:" << signal_number;
+  hotel_push_processor->SaveGeocodeSnapshot();
+  signal(signal_number, SIG_DFL);
+  pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+  raise(signal_number);
+}
+
+}  // namespace
+
 int main(int argc, char** argv) {
   base::AtExitManager at_exit;
   mobvoi::SetupBinaryVersion();
   google::ParseCommandLineFlags(&argc, &argv, false);
   google::InitGoogleLogging(argv[0]);
+  // before any thread is started
+  sigset_t shutdown_signals;
+  BlockShutdownSignals(&shutdown_signals);
 
   recommendation::ZkManager* zk_manager =
     Singleton<recommendation::ZkManager>::get();
@@ -136,18 +222,50 @@ int main(int argc, char** argv) {
   PushProcessor* movie_push_processor = new MoviePushProcessor();
   business_factory->RegisterPushProcessor(
       BusinessType::kBusinessMovie, movie_push_processor);
-  PushProcessor* hotel_push_processor = new HotelPushProcessor();
+  HotelPushProcessor* hotel_push_processor = new HotelPushProcessor();
   business_factory->RegisterPushProcessor(
       BusinessType::kBusinessHotel, hotel_push_processor);
+  std::thread(WaitForShutdown, shutdown_signals, hotel_push_processor)
+      .detach();
 
   // make shared worker thread class
-  std::shared_ptr<PushPoolUpdater> push_pool_updater = (
-      std::make_shared<PushPoolUpdater>());
   std::shared_ptr<PushScheduler> push_scheduler = (
       std::make_shared<PushScheduler>());
+  std::shared_ptr<PushPoolUpdater> push_pool_updater = (
+      std::make_shared<PushPoolUpdater>(
+          std::bind(&PushScheduler::AddPushEvents, push_scheduler.get(),
+                    std::placeholders::_1)));
+
+  std::shared_ptr<OrderEventConsumer> order_event_consumer;
+  if (FLAGS_enable_order_kafka_consumer) {
+    order_event_consumer = std::make_shared<OrderEventConsumer>(
+        std::bind(&PushScheduler::AddPushEvents, push_scheduler.get(),
+                  std::placeholders::_1));
+  }
+  std::shared_ptr<FlightChangeConsumer> flight_change_consumer;
+  if (FLAGS_enable_flight_change_consumer) {
+    flight_change_consumer = std::make_shared<FlightChangeConsumer>(
+        std::bind(&PushScheduler::AddPushEvents, push_scheduler.get(),
+                  std::placeholders::_1));
+  }
+
+  std::shared_ptr<WeatherWarmupThread> weather_warmup_thread;
+  if (FLAGS_weather_cache_update_seconds > 0 &&
+      FLAGS_weather_warmup_hour >= 0) {
+    weather_warmup_thread = std::make_shared<WeatherWarmupThread>();
+  }
 
   push_scheduler->Start();
   push_pool_updater->Start();
+  if (order_event_consumer) {
+    order_event_consumer->Start();
+  }
+  if (flight_change_consumer) {
+    flight_change_consumer->Start();
+  }
+  if (weather_warmup_thread) {
+    weather_warmup_thread->Start();
+  }
   train_push_processor->Start();
   flight_push_processor->Start();
   movie_push_processor->Start();
@@ -183,6 +301,15 @@ int main(int argc, char** argv) {
   http_server.Serv();
 
   push_pool_updater->Join();
+  if (order_event_consumer) {
+    order_event_consumer->Join();
+  }
+  if (flight_change_consumer) {
+    flight_change_consumer->Join();
+  }
+  if (weather_warmup_thread) {
+    weather_warmup_thread->Join();
+  }
   push_scheduler->Join();
   train_push_processor->Join();
   flight_push_processor->Join();
@@ -0,0 +1,103 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/push_controller/push_event_queue.h"
+
+#include <algorithm>
+
+#include "base/log.h"
+#include "base/string_util.h"
+
+namespace push_controller {
+
+PushEventQueue::PushEventQueue(size_t capacity,
+                               const map<int, int>& slack_map,
+                               int default_slack)
+  : capacity_(std::max(capacity, static_cast<size_t>(1))),
+    slack_map_(slack_map),
+    default_slack_(default_slack),
+    next_sequence_(0),
+    push_cnt_(0),
+    pop_cnt_(0),
+    expired_cnt_(0),
+    full_reject_cnt_(0),
+    max_size_(0) {}
+
+PushEventQueue::~PushEventQueue() {}
+
+bool PushEventQueue::Push(const PushEventInfo& push_event) {
+  Item item;
+  item.deadline = GetDeadline(push_event);
+  item.push_event = push_event;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (queue_.size() >= capacity_) {
+    ++full_reject_cnt_;
+    VLOG(1) << "push queue is full, size:" << queue_.size();
+    return false;
+  }
+  item.sequence = next_sequence_++;
+  queue_.push(item);
+  ++push_cnt_;
+  max_size_ = std::max(max_size_, queue_.size());
+  not_empty_cond_.notify_one();
+  return true;
+}
+
+bool PushEventQueue::Pop(PushEventInfo* push_event) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  not_empty_cond_.wait(lock, [this] { return !queue_.empty(); });
+  Item item = queue_.top();
+  queue_.pop();
+  push_event->Swap(&item.push_event);
+  if (item.deadline < time(NULL)) {
+    ++expired_cnt_;
+    LOG(WARNING) << "expired push event, event_id:" << push_event->id()
+                 << ", event_type:" << push_event->event_type()
+                 << ", deadline:" << item.deadline;
+    return false;
+  }
+  ++pop_cnt_;
+  return true;
+}
+
+size_t PushEventQueue::Size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_.size();
+}
+
+void PushEventQueue::GetStats(Json::Value* stats) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  (*stats)["size"] = static_cast<Json::UInt64>(queue_.size());
+  (*stats)["max_size"] = static_cast<Json::UInt64>(max_size_);
+  (*stats)["capacity"] = static_cast<Json::UInt64>(capacity_);
+  (*stats)["push_cnt"] = static_cast<Json::UInt64>(push_cnt_);
+  (*stats)["pop_cnt"] = static_cast<Json::UInt64>(pop_cnt_);
+  (*stats)["expired_cnt"] = static_cast<Json::UInt64>(expired_cnt_);
+  (*stats)["full_reject_cnt"] = static_cast<Json::UInt64>(full_reject_cnt_);
+}
+
+bool PushEventQueue::ParseSlackMap(const string& slack_config,
+                                   map<int, int>* slack_map) {
+  vector<string> items;
+  SplitString(slack_config, ',', &items);
+  for (auto it = items.begin(); it != items.end(); ++it) {
+    vector<string> fields;
+    SplitString(*it, ':', &fields);
+    int event_type = 0, slack = 0;
+    if (fields.size() != 2 || !StringToInt(fields[0], &event_type) ||
+        !StringToInt(fields[1], &slack)) {
+      LOG(ERROR) << "invalid slack config:" << *it;
+      return false;
+    }
+    (*slack_map)[event_type] = slack;
+  }
+  return true;
+}
+
+time_t PushEventQueue::GetDeadline(const PushEventInfo& push_event) const {
+  auto it = slack_map_.find(static_cast<int>(push_event.event_type()));
+  int slack = it != slack_map_.end() ? it->second : default_slack_;
+  return static_cast<time_t>(push_event.push_time()) + slack;
+}
+
+}  // namespace push_controller
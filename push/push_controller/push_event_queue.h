@@ -0,0 +1,77 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#ifndef PUSH_PUSH_CONTROLLER_PUSH_EVENT_QUEUE_H_
+#define PUSH_PUSH_CONTROLLER_PUSH_EVENT_QUEUE_H_
+
+#include <time.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+
+#include "base/basictypes.h"
+#include "base/compat.h"
+#include "third_party/jsoncpp/json.h"
+
+#include "push/proto/push_meta.pb.h"
+
+namespace push_controller {
+
+// Bounded queue of push events served earliest deadline first, where the
+// deadline of an event is its push_time plus the slack of its event type.
+// Push never blocks, it rejects events while the queue is full so the
+// caller can hold them back without stalling other queues.
+class PushEventQueue {
+ public:
+  // slack_map is event_type -> seconds, other types get default_slack.
+  PushEventQueue(size_t capacity, const map<int, int>& slack_map,
+                 int default_slack);
+  ~PushEventQueue();
+  // Returns false if the queue is full.
+  bool Push(const PushEventInfo& push_event);
+  // Blocks until an event is available, returns false if it is past its
+  // deadline and should be given up.
+  bool Pop(PushEventInfo* push_event);
+  size_t Size();
+  void GetStats(Json::Value* stats);
+
+  // Parses "event_type:seconds,..." into slack_map.
+  static bool ParseSlackMap(const string& slack_config,
+                            map<int, int>* slack_map);
+
+ private:
+  struct Item {
+    time_t deadline;
+    uint64 sequence;
+    PushEventInfo push_event;
+  };
+  struct LaterDeadline {
+    bool operator()(const Item& left, const Item& right) const {
+      if (left.deadline != right.deadline) {
+        return left.deadline > right.deadline;
+      }
+      return left.sequence > right.sequence;
+    }
+  };
+
+  time_t GetDeadline(const PushEventInfo& push_event) const;
+
+  size_t capacity_;
+  map<int, int> slack_map_;
+  int default_slack_;
+  std::mutex mutex_;
+  std::condition_variable not_empty_cond_;
+  std::priority_queue<Item, vector<Item>, LaterDeadline> queue_;
+  uint64 next_sequence_;
+  uint64 push_cnt_;
+  uint64 pop_cnt_;
+  uint64 expired_cnt_;
+  uint64 full_reject_cnt_;
+  size_t max_size_;
+  DISALLOW_COPY_AND_ASSIGN(PushEventQueue);
+};
+
+}  // namespace push_controller
+
+#endif  // PUSH_PUSH_CONTROLLER_PUSH_EVENT_QUEUE_H_
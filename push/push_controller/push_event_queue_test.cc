@@ -0,0 +1,106 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/push_controller/push_event_queue.h"
+
+#include <atomic>
+#include <thread>
+
+#include "third_party/gtest/gtest.h"
+
+using namespace push_controller;
+
+namespace {
+
+PushEventInfo MakeEvent(const string& id, EventType event_type,
+                        time_t push_time) {
+  PushEventInfo push_event;
+  push_event.set_id(id);
+  push_event.set_event_type(event_type);
+  push_event.set_push_time(push_time);
+  return push_event;
+}
+
+}  // namespace
+
+TEST(PushEventQueueTest, ParseSlackMap) {
+  map<int, int> slack_map;
+  EXPECT_TRUE(PushEventQueue::ParseSlackMap("1:1200,8:120", &slack_map));
+  EXPECT_EQ(2u, slack_map.size());
+  EXPECT_EQ(1200, slack_map[1]);
+  EXPECT_EQ(120, slack_map[8]);
+  EXPECT_FALSE(PushEventQueue::ParseSlackMap("1:1200,8", &slack_map));
+}
+
+TEST(PushEventQueueTest, EarliestDeadlineFirst) {
+  map<int, int> slack_map = {
+    {kEventRemindTimelineLastDay, 1200},
+    {kEventRemindTimelineTakeoff, 120},
+  };
+  PushEventQueue queue(10, slack_map, 600);
+  time_t now = time(NULL);
+  queue.Push(MakeEvent("lastday", kEventRemindTimelineLastDay, now - 100));
+  queue.Push(MakeEvent("today", kEventRemindTimelineToday, now));
+  queue.Push(MakeEvent("takeoff", kEventRemindTimelineTakeoff, now));
+  queue.Push(MakeEvent("takeoff2", kEventRemindTimelineTakeoff, now));
+  PushEventInfo push_event;
+  EXPECT_TRUE(queue.Pop(&push_event));
+  EXPECT_EQ("takeoff", push_event.id());
+  EXPECT_TRUE(queue.Pop(&push_event));
+  EXPECT_EQ("takeoff2", push_event.id());
+  EXPECT_TRUE(queue.Pop(&push_event));
+  EXPECT_EQ("today", push_event.id());
+  EXPECT_TRUE(queue.Pop(&push_event));
+  EXPECT_EQ("lastday", push_event.id());
+  EXPECT_EQ(0u, queue.Size());
+}
+
+TEST(PushEventQueueTest, ReturnExpired) {
+  map<int, int> slack_map = {{kEventRemindTimeline30Min, 60}};
+  PushEventQueue queue(10, slack_map, 600);
+  time_t now = time(NULL);
+  queue.Push(MakeEvent("expired", kEventRemindTimeline30Min, now - 120));
+  queue.Push(MakeEvent("valid", kEventRemindTimelineToday, now - 120));
+  PushEventInfo push_event;
+  EXPECT_FALSE(queue.Pop(&push_event));
+  EXPECT_EQ("expired", push_event.id());
+  EXPECT_TRUE(queue.Pop(&push_event));
+  EXPECT_EQ("valid", push_event.id());
+  Json::Value stats;
+  queue.GetStats(&stats);
+  EXPECT_EQ(1u, stats["expired_cnt"].asUInt64());
+  EXPECT_EQ(1u, stats["pop_cnt"].asUInt64());
+}
+
+TEST(PushEventQueueTest, RejectWhenFull) {
+  PushEventQueue queue(1, map<int, int>(), 600);
+  time_t now = time(NULL);
+  EXPECT_TRUE(queue.Push(MakeEvent("first", kEventRemindTimelineToday, now)));
+  EXPECT_FALSE(
+      queue.Push(MakeEvent("second", kEventRemindTimelineToday, now)));
+  PushEventInfo push_event;
+  EXPECT_TRUE(queue.Pop(&push_event));
+  EXPECT_EQ("first", push_event.id());
+  EXPECT_TRUE(queue.Push(MakeEvent("second", kEventRemindTimelineToday, now)));
+  EXPECT_TRUE(queue.Pop(&push_event));
+  EXPECT_EQ("second", push_event.id());
+  Json::Value stats;
+  queue.GetStats(&stats);
+  EXPECT_EQ(1u, stats["full_reject_cnt"].asUInt64());
+}
+
+TEST(PushEventQueueTest, PopBlocksUntilPush) {
+  PushEventQueue queue(1, map<int, int>(), 600);
+  std::atomic<bool> popped(false);
+  PushEventInfo push_event;
+  std::thread consumer([&] {
+    queue.Pop(&push_event);
+    popped = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(popped);
+  EXPECT_TRUE(
+      queue.Push(MakeEvent("first", kEventRemindTimelineToday, time(NULL))));
+  consumer.join();
+  EXPECT_EQ("first", push_event.id());
+}
@@ -0,0 +1,284 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/push_controller/push_message_renderer.h"
+
+namespace {
+
+using namespace push_controller;
+
+void AppendString(const string& value, string* buffer) {
+  buffer->append(Json::valueToQuotedString(value.c_str()));
+}
+
+void AppendInt(int64 value, string* buffer) {
+  buffer->append(Json::valueToString(static_cast<Json::LargestInt>(value)));
+}
+
+void AppendBool(bool value, string* buffer) {
+  buffer->append(value ? "true" : "false");
+}
+
+void AppendText(const TextType& text, string* buffer) {
+  buffer->append("{\"bottom_margin\":");
+  AppendInt(text.bottom_margin, buffer);
+  buffer->append(",\"color\":");
+  AppendString(text.color, buffer);
+  buffer->append(",\"font\":");
+  AppendInt(text.font, buffer);
+  buffer->append(",\"icon\":");
+  AppendInt(text.icon, buffer);
+  buffer->append(",\"icon_code\":");
+  AppendString(text.icon_code, buffer);
+  buffer->append(",\"text\":");
+  AppendString(text.text, buffer);
+  buffer->append(",\"top_margin\":");
+  AppendInt(text.top_margin, buffer);
+  buffer->append(",\"word_wrap\":");
+  AppendBool(text.word_wrap, buffer);
+  buffer->push_back('}');
+}
+
+void AppendLink(const LinkType& link, string* buffer) {
+  buffer->append("{\"bg_color\":");
+  AppendString(link.bg_color, buffer);
+  buffer->append(",\"color\":");
+  AppendString(link.color, buffer);
+  buffer->append(",\"data\":");
+  AppendString(link.data, buffer);
+  buffer->append(",\"font\":");
+  AppendInt(link.font, buffer);
+  buffer->append(",\"geo\":");
+  AppendString(link.geo, buffer);
+  buffer->append(",\"id\":");
+  AppendString(link.id, buffer);
+  buffer->append(",\"text\":");
+  AppendString(link.text, buffer);
+  buffer->append(",\"type\":");
+  AppendInt(static_cast<int32>(link.type), buffer);
+  buffer->push_back('}');
+}
+
+void AppendDetail(const DetailFields& detail, string* buffer) {
+  buffer->append("{\"des\":");
+  AppendText(detail.des, buffer);
+  buffer->append(",\"icon\":");
+  AppendInt(detail.icon, buffer);
+  buffer->append(",\"icon_code\":");
+  AppendString(detail.icon_code, buffer);
+  // the Json::Value path never creates empty lists
+  if (!detail.link_list.empty()) {
+    buffer->append(",\"link_list\":[");
+    for (size_t i = 0; i < detail.link_list.size(); ++i) {
+      if (i > 0) {
+        buffer->push_back(',');
+      }
+      AppendLink(detail.link_list[i], buffer);
+    }
+    buffer->push_back(']');
+  }
+  if (!detail.text_list.empty()) {
+    buffer->append(",\"text_list\":[");
+    for (size_t i = 0; i < detail.text_list.size(); ++i) {
+      if (i > 0) {
+        buffer->push_back(',');
+      }
+      AppendText(detail.text_list[i], buffer);
+    }
+    buffer->push_back(']');
+  }
+  buffer->append(",\"title\":");
+  AppendText(detail.title, buffer);
+  buffer->push_back('}');
+}
+
+void AppendPushDetail(bool is_push, const PushFields& push, string* buffer) {
+  if (!is_push) {
+    buffer->append("{}");
+    return;
+  }
+  buffer->append("{\"des\":");
+  AppendString(push.des, buffer);
+  buffer->append(",\"position1\":");
+  AppendString(push.position1, buffer);
+  buffer->append(",\"position2\":");
+  AppendString(push.position2, buffer);
+  buffer->append(",\"position3\":");
+  AppendString(push.position3, buffer);
+  buffer->append(",\"position4\":");
+  AppendString(push.position4, buffer);
+  buffer->append(",\"push_time\":");
+  AppendString(push.push_time, buffer);
+  buffer->append(",\"ui_type\":");
+  AppendString(push.ui_type, buffer);
+  buffer->push_back('}');
+}
+
+void AppendTimeline(const TimelineFields& timeline, string* buffer) {
+  buffer->append("{\"des\":");
+  AppendString(timeline.des, buffer);
+  buffer->append(",\"ticker\":");
+  if (timeline.ticker.empty()) {
+    buffer->append("null");
+  } else {
+    buffer->push_back('[');
+    for (size_t i = 0; i < timeline.ticker.size(); ++i) {
+      if (i > 0) {
+        buffer->push_back(',');
+      }
+      AppendString(timeline.ticker[i], buffer);
+    }
+    buffer->push_back(']');
+  }
+  buffer->append(",\"title\":");
+  AppendString(timeline.title, buffer);
+  buffer->push_back('}');
+}
+
+void SetText(const TextType& text, Json::Value* value) {
+  (*value)["text"] = text.text;
+  (*value)["color"] = text.color;
+  (*value)["font"] = text.font;
+  (*value)["word_wrap"] = text.word_wrap;
+  (*value)["icon"] = text.icon;
+  (*value)["icon_code"] = text.icon_code;
+  (*value)["top_margin"] = text.top_margin;
+  (*value)["bottom_margin"] = text.bottom_margin;
+}
+
+}  // namespace
+
+namespace push_controller {
+
+void BuildPushContentJson(const PushContent& content, Json::Value* message) {
+  Json::Value& msg = *message;
+  msg["status"] = content.status;
+  msg["id"] = content.id;
+  msg["event_key"] = content.event_key;
+  msg["product_key"] = content.product_key;
+  msg["is_push"] = content.is_push;
+  if (content.is_push) {
+    const PushFields& push = content.push_detail;
+    msg["push_detail"]["push_time"] = push.push_time;
+    msg["push_detail"]["position1"] = push.position1;
+    msg["push_detail"]["position2"] = push.position2;
+    msg["push_detail"]["position3"] = push.position3;
+    msg["push_detail"]["position4"] = push.position4;
+    msg["push_detail"]["des"] = push.des;
+    msg["push_detail"]["ui_type"] = push.ui_type;
+  } else {
+    msg["push_detail"] = Json::Value(Json::objectValue);
+  }
+  msg["sys"]["expire_time"] = content.sys.expire_time;
+  msg["timeline_detail"]["title"] = content.timeline_detail.title;
+  msg["timeline_detail"]["des"] = content.timeline_detail.des;
+  Json::Value ticker;
+  for (auto& t : content.timeline_detail.ticker) {
+    ticker.append(t);
+  }
+  msg["timeline_detail"]["ticker"] = ticker;
+  const DetailFields& detail = content.detail;
+  Json::Value& detail_value = msg["detail"];
+  detail_value["icon"] = detail.icon;
+  detail_value["icon_code"] = detail.icon_code;
+  SetText(detail.title, &detail_value["title"]);
+  SetText(detail.des, &detail_value["des"]);
+  for (auto& text : detail.text_list) {
+    Json::Value val;
+    SetText(text, &val);
+    detail_value["text_list"].append(val);
+  }
+  for (auto& link : detail.link_list) {
+    Json::Value val;
+    val["text"] = link.text;
+    val["color"] = link.color;
+    val["font"] = link.font;
+    val["bg_color"] = link.bg_color;
+    val["data"] = link.data;
+    val["geo"] = link.geo;
+    val["type"] = static_cast<int32>(link.type);
+    val["id"] = link.id;
+    detail_value["link_list"].append(val);
+  }
+}
+
+void RenderPushContent(const PushContent& content, string* buffer) {
+  buffer->clear();
+  buffer->append("{\"detail\":");
+  AppendDetail(content.detail, buffer);
+  buffer->append(",\"event_key\":");
+  AppendString(content.event_key, buffer);
+  buffer->append(",\"id\":");
+  AppendString(content.id, buffer);
+  buffer->append(",\"is_push\":");
+  AppendBool(content.is_push, buffer);
+  buffer->append(",\"product_key\":");
+  AppendString(content.product_key, buffer);
+  buffer->append(",\"push_detail\":");
+  AppendPushDetail(content.is_push, content.push_detail, buffer);
+  buffer->append(",\"status\":");
+  AppendString(content.status, buffer);
+  buffer->append(",\"sys\":{\"expire_time\":");
+  AppendString(content.sys.expire_time, buffer);
+  buffer->append("},\"timeline_detail\":");
+  AppendTimeline(content.timeline_detail, buffer);
+  buffer->push_back('}');
+}
+
+void RenderPushRequest(MessageType message_type, const string& message_desc,
+                       const string& user_id, const string& package_name,
+                       const string& content, string* buffer) {
+  buffer->clear();
+  buffer->append("{\"message\":{\"content\":");
+  buffer->append(content);
+  buffer->append(",\"desc\":");
+  AppendString(message_desc, buffer);
+  buffer->append(",\"type\":");
+  AppendInt(message_type, buffer);
+  buffer->append("},\"package_name\":");
+  AppendString(package_name, buffer);
+  buffer->append(",\"user_name\":");
+  AppendString(user_id, buffer);
+  buffer->append("}\n");
+}
+
+void RenderPushLogRequest(const string& topic, const string& event,
+                          uint32 timestamp, bool with_fingerprint_id,
+                          const UserOrderInfo& user_order,
+                          const PushEventInfo& push_event,
+                          const string& push_message, string* buffer) {
+  buffer->clear();
+  buffer->append("{\"topic\":");
+  AppendString(topic, buffer);
+  buffer->append(",\"value\":{\"business_type\":");
+  AppendInt(user_order.business_type(), buffer);
+  buffer->append(",\"event\":");
+  AppendString(event, buffer);
+  if (with_fingerprint_id) {
+    buffer->append(",\"fingerprint_id\":");
+    AppendInt(user_order.fingerprint_id(), buffer);
+  }
+  buffer->append(",\"properties\":{\"business_key\":");
+  AppendString(push_event.business_key(), buffer);
+  buffer->append(",\"business_time\":");
+  AppendInt(user_order.business_time(), buffer);
+  buffer->append(",\"event_id\":");
+  AppendString(push_event.id(), buffer);
+  buffer->append(",\"event_type\":");
+  AppendInt(push_event.event_type(), buffer);
+  buffer->append(",\"order_detail\":");
+  AppendString(user_order.order_detail(), buffer);
+  buffer->append(",\"order_id\":");
+  AppendString(user_order.id(), buffer);
+  buffer->append(",\"push_message\":");
+  buffer->append(push_message);
+  buffer->append(",\"push_time\":");
+  AppendInt(push_event.push_time(), buffer);
+  buffer->append("},\"timestamp\":");
+  AppendInt(timestamp, buffer);
+  buffer->append(",\"user_id\":");
+  AppendString(user_order.user_id(), buffer);
+  buffer->append("}}\n");
+}
+
+}  // namespace push_controller
@@ -0,0 +1,111 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#ifndef PUSH_PUSH_CONTROLLER_PUSH_MESSAGE_RENDERER_H_
+#define PUSH_PUSH_CONTROLLER_PUSH_MESSAGE_RENDERER_H_
+
+#include "base/basictypes.h"
+#include "base/compat.h"
+#include "third_party/jsoncpp/json.h"
+
+#include "push/proto/push_meta.pb.h"
+
+namespace push_controller {
+
+enum ApplicationType {
+  kApplicationDefault = 0,
+  kApplicationNavigation = 1,
+  kApplicationTaxi = 2,
+  kApplicationCallup = 3,
+};
+
+struct TextType {
+  string text;
+  string color;
+  int font;
+  bool word_wrap;
+  int icon;
+  string icon_code;
+  int top_margin;
+  int bottom_margin;
+};
+
+struct LinkType {
+  string text;
+  string color;
+  int font;
+  string bg_color;
+  string data;
+  string geo;
+  ApplicationType type;
+  string id;
+};
+
+struct PushFields {
+  string push_time;
+  string position1;
+  string position2;
+  string position3;
+  string position4;
+  string des;
+  string ui_type;
+};
+
+struct SysFields {
+  string expire_time;
+};
+
+struct TimelineFields {
+  string title;
+  vector<string> ticker;
+  string des;
+};
+
+struct DetailFields {
+  int icon;
+  string icon_code;
+  TextType title;
+  vector<TextType> text_list;
+  TextType des;
+  vector<LinkType> link_list;
+};
+
+struct PushContent {
+  string status;
+  string id;
+  string event_key;
+  string product_key;
+  bool is_push;
+  PushFields push_detail;
+  SysFields sys;
+  TimelineFields timeline_detail;
+  DetailFields detail;
+};
+
+// Builds the content of a general push as a Json::Value.
+void BuildPushContentJson(const PushContent& content, Json::Value* message);
+
+// The renderers below write the JSON straight into buffer, which is
+// cleared but keeps its capacity. The keys come in the fixed order that
+// Json::FastWriter uses, and values are escaped by jsoncpp itself, so the
+// output is byte for byte what FastWriter writes for the same Json::Value.
+
+// FastWriter output of BuildPushContentJson, without the ending newline.
+void RenderPushContent(const PushContent& content, string* buffer);
+
+// The request body of PushSender::SendPush for a rendered content.
+void RenderPushRequest(MessageType message_type, const string& message_desc,
+                       const string& user_id, const string& package_name,
+                       const string& content, string* buffer);
+
+// The request body of PushProcessor::UploadPushDataToKafka for a rendered
+// push message. fingerprint_id is written only if with_fingerprint_id.
+void RenderPushLogRequest(const string& topic, const string& event,
+                          uint32 timestamp, bool with_fingerprint_id,
+                          const UserOrderInfo& user_order,
+                          const PushEventInfo& push_event,
+                          const string& push_message, string* buffer);
+
+}  // namespace push_controller
+
+#endif  // PUSH_PUSH_CONTROLLER_PUSH_MESSAGE_RENDERER_H_
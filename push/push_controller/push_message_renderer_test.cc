@@ -0,0 +1,154 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/push_controller/push_message_renderer.h"
+
+#include "third_party/gtest/gtest.h"
+
+using namespace push_controller;
+
+namespace {
+
+PushContent MakeContent() {
+  PushContent content;
+  content.status = "success";
+  content.id = "order-\"1\"";
+  content.event_key = "today";
+  content.product_key = "hotel";
+  content.is_push = false;
+  content.sys.expire_time = "2017-06-01 23:59";
+  content.timeline_detail.title = u8"八方连锁酒店";
+  content.timeline_detail.ticker.push_back(u8"06-01入住，14:00\n之后");
+  content.timeline_detail.des = u8"出门问问智能推送";
+  content.detail.icon = 5;
+  content.detail.icon_code = "";
+  TextType title = {u8"八方连锁酒店", "#FFFFFF", 16, true, 0, "", 4, 4};
+  TextType address = {u8"地址：\\海淀\t区", "#808080", 15, true, 0, "", 8, 4};
+  TextType des = {u8"出门问问智能推送", "", 0, false, 0, "", 8, 8};
+  content.detail.title = title;
+  content.detail.des = des;
+  content.detail.text_list.push_back(title);
+  content.detail.text_list.push_back(address);
+  LinkType navigation = {u8"导航到酒店", "#FFFFFF", 0, "#5E83E1",
+    u8"海淀区", "116.3,39.9", kApplicationNavigation, "Navigation"};
+  content.detail.link_list.push_back(navigation);
+  return content;
+}
+
+string WriteJson(const Json::Value& value) {
+  Json::FastWriter writer;
+  return writer.write(value);
+}
+
+string RenderContent(const PushContent& content) {
+  string buffer;
+  RenderPushContent(content, &buffer);
+  return buffer;
+}
+
+string BuildContent(const PushContent& content) {
+  Json::Value message;
+  BuildPushContentJson(content, &message);
+  string result = WriteJson(message);
+  result.resize(result.size() - 1);  // the ending newline
+  return result;
+}
+
+}  // namespace
+
+TEST(PushMessageRendererTest, RenderPushContent) {
+  PushContent content = MakeContent();
+  EXPECT_EQ(BuildContent(content), RenderContent(content));
+}
+
+TEST(PushMessageRendererTest, RenderPushContentIsPush) {
+  PushContent content = MakeContent();
+  content.is_push = true;
+  content.push_detail.push_time = "2017-06-01 07:00:00";
+  content.push_detail.position1 = "a";
+  content.push_detail.des = "des";
+  content.push_detail.ui_type = "1";
+  EXPECT_EQ(BuildContent(content), RenderContent(content));
+}
+
+TEST(PushMessageRendererTest, RenderPushContentEmptyLists) {
+  PushContent content = MakeContent();
+  content.timeline_detail.ticker.clear();
+  content.detail.text_list.clear();
+  content.detail.link_list.clear();
+  EXPECT_EQ(BuildContent(content), RenderContent(content));
+}
+
+TEST(PushMessageRendererTest, ReuseBuffer) {
+  PushContent content = MakeContent();
+  string buffer = "stale";
+  RenderPushContent(content, &buffer);
+  RenderPushContent(content, &buffer);
+  EXPECT_EQ(BuildContent(content), buffer);
+}
+
+TEST(PushMessageRendererTest, RenderPushRequest) {
+  PushContent content = MakeContent();
+  Json::Value message_content;
+  BuildPushContentJson(content, &message_content);
+  Json::Value message, push;
+  message["type"] = kMessageGeneral;
+  message["desc"] = "hotel";
+  message["content"] = message_content;
+  push["message"] = message;
+  push["user_name"] = "user";
+  push["package_name"] = "com.mobvoi.ticwear.home";
+  string buffer;
+  RenderPushRequest(kMessageGeneral, "hotel", "user",
+                    "com.mobvoi.ticwear.home", RenderContent(content),
+                    &buffer);
+  EXPECT_EQ(WriteJson(push), buffer);
+}
+
+TEST(PushMessageRendererTest, RenderPushLogRequest) {
+  PushContent content = MakeContent();
+  UserOrderInfo user_order;
+  user_order.set_id("order");
+  user_order.set_user_id("user");
+  user_order.set_business_type(kBusinessHotel);
+  user_order.set_order_detail("{\"tel\":\"123\"}");
+  user_order.set_business_time(1496275200);
+  user_order.set_fingerprint_id(-42);
+  PushEventInfo push_event;
+  push_event.set_id("order-2");
+  push_event.set_event_type(kEventRemindTimelineToday);
+  push_event.set_push_time(1496271600);
+  push_event.set_business_key("key");
+  for (int with_fingerprint_id = 0; with_fingerprint_id < 2;
+       ++with_fingerprint_id) {
+    Json::Value push_message;
+    BuildPushContentJson(content, &push_message);
+    Json::Value data;
+    data["timestamp"] = static_cast<uint32_t>(1496271601);
+    data["event"] = "push_suc";
+    data["user_id"] = user_order.user_id();
+    data["business_type"] = user_order.business_type();
+    if (with_fingerprint_id) {
+      data["fingerprint_id"] =
+        static_cast<Json::Int64>(user_order.fingerprint_id());
+    }
+    Json::Value properties;
+    properties["order_id"] = user_order.id();
+    properties["order_detail"] = user_order.order_detail();
+    properties["business_time"] = user_order.business_time();
+    properties["event_id"] = push_event.id();
+    properties["event_type"] = push_event.event_type();
+    properties["push_time"] = push_event.push_time();
+    properties["business_key"] = push_event.business_key();
+    properties["push_message"] = push_message;
+    data["properties"] = properties;
+    Json::Value post_request;
+    post_request["topic"] = "intelligent-push";
+    post_request["value"] = data;
+    string buffer;
+    RenderPushLogRequest("intelligent-push", "push_suc", 1496271601,
+                         with_fingerprint_id, user_order, push_event,
+                         RenderContent(content), &buffer);
+    EXPECT_EQ(WriteJson(post_request), buffer);
+  }
+}
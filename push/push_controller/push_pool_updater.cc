@@ -3,6 +3,8 @@
 
 #include "push/push_controller/push_pool_updater.h"
 
+#include <algorithm>
+#include <chrono>
 #include <ctime>
 #include <memory>
 #include <sstream>
@@ -12,6 +14,7 @@
 #include "base/string_util.h"
 #include "base/time.h"
 #include "third_party/gflags/gflags.h"
+#include "third_party/jsoncpp/json.h"
 #include "third_party/mysql_client_cpp/include/mysql_connection.h"
 #include "third_party/mysql_client_cpp/include/mysql_driver.h"
 #include "third_party/mysql_client_cpp/include/cppconn/driver.h"
@@ -27,14 +30,21 @@
 
 DECLARE_bool(use_cluster_mode);
 DECLARE_bool(enable_update_push_pool);
+DECLARE_bool(enable_order_kafka_consumer);
 
 DECLARE_int32(pool_update_internal);
+DECLARE_int32(pool_reconcile_internal);
+DECLARE_int32(db_batch_query_size);
+
+DECLARE_string(order_kafka_event_type);
 
 DECLARE_string(mysql_config);
 DECLARE_string(zookeeper_watched_path);
 
 namespace {
 
+using namespace push_controller;
+
 static const string kTimeFormat = "%Y-%m-%d %H:%M:%S";
 
 string kQueryFormat =
@@ -47,18 +57,62 @@ string kQueryFormatV2 =
     "updated, order_status, finished_time, fingerprint_id "
     "FROM %s WHERE updated > '%s' AND mod(fingerprint_id, %d) = %d;";
 
+string kQueryByIdFormat =
+    "SELECT id, user_id, business_type, business_time, order_detail, "
+    "updated, order_status, finished_time, fingerprint_id "
+    "FROM %s WHERE id IN (%s);";
+
+string kQueryByIdFormatV2 =
+    "SELECT id, user_id, business_type, business_time, order_detail, "
+    "updated, order_status, finished_time, fingerprint_id "
+    "FROM %s WHERE id IN (%s) AND mod(fingerprint_id, %d) = %d;";
+
 static const char kTable[] = "user_order_info";
 
+void ParseUserOrder(sql::ResultSet* result_set,
+                    UserOrderInfo* user_order_info) {
+  user_order_info->set_id(result_set->getString("id"));
+  user_order_info->set_user_id(result_set->getString("user_id"));
+  user_order_info->set_business_type(
+      static_cast<BusinessType>(result_set->getInt("business_type")));
+  user_order_info->set_order_detail(result_set->getString("order_detail"));
+  user_order_info->set_order_status(
+      static_cast<OrderStatus>(result_set->getInt("order_status")));
+  time_t business_time, finished_time, updated_time;
+  string business_time_string = (
+      result_set->getString("business_time"));
+  recommendation::DatetimeToTimestamp(
+      business_time_string, &business_time, kTimeFormat);
+  user_order_info->set_business_time(business_time);
+  string updated_string = result_set->getString("updated");
+  recommendation::DatetimeToTimestamp(
+      updated_string, &updated_time, kTimeFormat);
+  user_order_info->set_updated(updated_time);
+  string finished_string = result_set->getString("finished_time");
+  recommendation::DatetimeToTimestamp(
+      finished_string, &finished_time, kTimeFormat);
+  user_order_info->set_finished_time(finished_time);
+  user_order_info->set_fingerprint_id(
+      result_set->getInt64("fingerprint_id"));
+}
+
+int64 NowInMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
 }
 
 namespace push_controller {
 
-PushPoolUpdater::PushPoolUpdater() {}
+PushPoolUpdater::PushPoolUpdater(
+    const PushEventCallback& push_event_callback)
+  : push_event_callback_(push_event_callback) {}
 
 PushPoolUpdater::~PushPoolUpdater() {}
 
 void PushPoolUpdater::Run() {
-  PushEventProcessor push_event_processor;
+  PushEventProcessor push_event_processor(push_event_callback_);
   UserOrderProcessor user_order_processor;
   vector<UserOrderInfo> user_orders;
   while (true) {
@@ -72,10 +126,99 @@ void PushPoolUpdater::Run() {
     } else {
       LOG(INFO) << "push pool need not update";
     }
-    mobvoi::Sleep(FLAGS_pool_update_internal);
+    // orders arrive from kafka, polling only sweeps up the missed ones
+    if (FLAGS_enable_order_kafka_consumer) {
+      mobvoi::Sleep(FLAGS_pool_reconcile_internal);
+    } else {
+      mobvoi::Sleep(FLAGS_pool_update_internal);
+    }
   }
 }
 
+OrderEventConsumer::OrderEventConsumer(
+    const PushEventCallback& push_event_callback)
+  : push_event_callback_(push_event_callback) {
+  message_queue_ = std::make_shared<mobvoi::ConcurrentQueue<string>>();
+  consumer_thread_.reset(new recommendation::KafkaConsumerThread());
+  consumer_thread_->BuildConsumer(message_queue_);
+}
+
+OrderEventConsumer::~OrderEventConsumer() {}
+
+void OrderEventConsumer::Run() {
+  LOG(INFO) << "OrderEventConsumer::Run() ...";
+  consumer_thread_->Start();
+  PushEventProcessor push_event_processor(push_event_callback_);
+  UserOrderProcessor user_order_processor;
+  size_t batch_size = static_cast<size_t>(
+      std::max(FLAGS_db_batch_query_size, 1));
+  while (true) {
+    // block for one message, then take whatever else has arrived
+    map<string, int64> order_time_map;
+    string message;
+    message_queue_->Pop(message);
+    ParseMessage(message, &order_time_map);
+    while (message_queue_->Size() > 0 && order_time_map.size() < batch_size) {
+      message_queue_->Pop(message);
+      ParseMessage(message, &order_time_map);
+    }
+    if (order_time_map.empty()) {
+      continue;
+    }
+    vector<string> order_ids;
+    for (auto it = order_time_map.begin(); it != order_time_map.end(); ++it) {
+      order_ids.push_back(it->first);
+    }
+    vector<UserOrderInfo> user_orders;
+    if (!user_order_processor.QueryUserOrderById(order_ids, &user_orders)) {
+      LOG(ERROR) << "query user order by id failed, size:" << order_ids.size();
+      continue;
+    }
+    if (user_orders.empty()) {
+      continue;
+    }
+    push_event_processor.UpdatePushEvent(&user_orders);
+    int64 now_ms = NowInMs();
+    PushPoolUpdateStats* stats = Singleton<PushPoolUpdateStats>::get();
+    for (auto it = user_orders.begin(); it != user_orders.end(); ++it) {
+      int64 order_time_ms = order_time_map[it->id()];
+      // messages without a timestamp tell nothing about the latency
+      if (order_time_ms > 0) {
+        stats->AddOrderLatency(now_ms - order_time_ms);
+      }
+    }
+  }
+}
+
+void OrderEventConsumer::ParseMessage(const string& message,
+                                      map<string, int64>* order_time_map) {
+  Json::Value root;
+  Json::Reader reader;
+  if (!reader.parse(message, root) || !root.isObject()) {
+    LOG(WARNING) << "invalid order message:" << message;
+    return;
+  }
+  // the log server may keep the envelope of the upload request
+  const Json::Value& data = root.isMember("value") ? root["value"] : root;
+  if (!data.isObject() ||
+      data["event"].asString() != FLAGS_order_kafka_event_type) {
+    return;
+  }
+  string order_id = data["properties"]["order_id"].asString();
+  if (order_id.empty()) {
+    LOG(WARNING) << "order message without order_id:" << message;
+    return;
+  }
+  int64 order_time_ms = 0;
+  if (data.isMember("timestamp_ms")) {
+    order_time_ms = data["timestamp_ms"].asInt64();
+  } else if (data.isMember("timestamp")) {
+    order_time_ms = static_cast<int64>(data["timestamp"].asInt64()) * 1000;
+  }
+  VLOG(1) << "RECEIVE order event, order_id:" << order_id;
+  (*order_time_map)[order_id] = order_time_ms;
+}
+
 UserOrderProcessor::UserOrderProcessor(): last_updated_(0) {
   VLOG(1) << "UserOrderProcessor::UserOrderProcessor()";
   UpdateTimeBackup* update_time_backup = Singleton<UpdateTimeBackup>::get();
@@ -128,29 +271,7 @@ bool UserOrderProcessor::QueryUserOrder(
     std::unique_ptr<sql::ResultSet> result_set(statement->executeQuery(query));
     while (result_set->next()) {
       UserOrderInfo user_order_info;
-      user_order_info.set_id(result_set->getString("id"));
-      user_order_info.set_user_id(result_set->getString("user_id"));
-      user_order_info.set_business_type(
-          static_cast<BusinessType>(result_set->getInt("business_type")));
-      user_order_info.set_order_detail(result_set->getString("order_detail"));
-      user_order_info.set_order_status(
-          static_cast<OrderStatus>(result_set->getInt("order_status")));
-      time_t business_time, finished_time, updated_time;
-      string business_time_string = (
-          result_set->getString("business_time"));
-      recommendation::DatetimeToTimestamp(
-          business_time_string, &business_time, kTimeFormat);
-      user_order_info.set_business_time(business_time);
-      string updated_string = result_set->getString("updated");
-      recommendation::DatetimeToTimestamp(
-          updated_string, &updated_time, kTimeFormat);
-      user_order_info.set_updated(updated_time);
-      string finished_string = result_set->getString("finished_time");
-      recommendation::DatetimeToTimestamp(
-          finished_string, &finished_time, kTimeFormat);
-      user_order_info.set_finished_time(finished_time);
-      user_order_info.set_fingerprint_id(
-          result_set->getInt64("fingerprint_id"));
+      ParseUserOrder(result_set.get(), &user_order_info);
       user_order_vector->push_back(user_order_info);
     }
     LOG(INFO) << "QUERY success, order total count:"
@@ -166,20 +287,83 @@ bool UserOrderProcessor::QueryUserOrder(
   }
 }
 
+bool UserOrderProcessor::QueryUserOrderById(
+    const vector<string>& order_ids,
+    vector<UserOrderInfo>* user_order_vector) {
+  VLOG(2) << "UserOrderProcessor::QueryUserOrderById()";
+  vector<string> quoted_ids;
+  for (auto it = order_ids.begin(); it != order_ids.end(); ++it) {
+    if (it->find_first_of("'\\") != string::npos) {
+      LOG(WARNING) << "invalid order id:" << *it;
+      continue;
+    }
+    quoted_ids.push_back("'" + *it + "'");
+  }
+  if (quoted_ids.empty()) {
+    return true;
+  }
+  try {
+    sql::Driver * driver = sql::mysql::get_driver_instance();
+    std::unique_ptr< sql::Connection >
+        connection(driver->connect(
+            mysql_server_->host(),
+            mysql_server_->user(),
+            mysql_server_->password()));
+    connection->setSchema(mysql_server_->database());
+    std::unique_ptr< sql::Statement > statement(connection->createStatement());
+    string query;
+    if (FLAGS_use_cluster_mode) {
+      recommendation::ZkManager* zk_manager =
+        Singleton<recommendation::ZkManager>::get();
+      int node_pos = zk_manager->GetNodePos(FLAGS_zookeeper_watched_path);
+      int node_cnt = zk_manager->GetTotalNodeCnt(FLAGS_zookeeper_watched_path);
+      if (node_pos < 0 || node_cnt <= 0) {
+        LOG(ERROR) << "Get node data from zk failed, node_pos=" << node_pos
+                   << ", node_cnt=" << node_cnt;
+        return false;
+      }
+      query = StringPrintf(kQueryByIdFormatV2.c_str(), kTable,
+                           JoinString(quoted_ids, ',').c_str(),
+                           node_cnt, node_pos);
+    } else {
+      query = StringPrintf(kQueryByIdFormat.c_str(), kTable,
+                           JoinString(quoted_ids, ',').c_str());
+    }
+    VLOG(2) << "query order by id, sql:" << query;
+    std::unique_ptr<sql::ResultSet> result_set(statement->executeQuery(query));
+    while (result_set->next()) {
+      UserOrderInfo user_order_info;
+      ParseUserOrder(result_set.get(), &user_order_info);
+      user_order_vector->push_back(user_order_info);
+    }
+    VLOG(1) << "QUERY by id success, order count:"
+            << user_order_vector->size();
+    return true;
+  } catch (const sql::SQLException &e) {
+    LOG(ERROR) << "SQLException: " << e.what();
+    return false;
+  }
+}
+
 PushEventProcessor::PushEventProcessor() {}
 
+PushEventProcessor::PushEventProcessor(
+    const PushEventCallback& push_event_callback)
+  : push_event_callback_(push_event_callback) {}
+
 PushEventProcessor::~PushEventProcessor() {}
 
 void PushEventProcessor::UpdatePushEvent(
     vector<UserOrderInfo>* user_orders) {
   VLOG(2) << "The number of user orders:" << user_orders->size();
-  int success_num = 0;
-  int user_orders_number = user_orders->size();
+  BusinessFactory* business_factory = Singleton<BusinessFactory>::get();
+  // events of all orders grouped by business, written in batches
+  map<BusinessType, vector<PushEventInfo>> push_event_map;
+  int event_cnt = 0;
   for(auto it = user_orders->begin();
       it != user_orders->end(); ++it) {
     LOG(INFO) << "READ user order: " << ProtoToString(*it);
     BusinessType business_type = it->business_type();
-    BusinessFactory* business_factory = Singleton<BusinessFactory>::get();
     BaseBusinessProcessor* business_processor = (
         business_factory->GetBusinessProcessor(business_type));
     if (!business_processor) {
@@ -195,15 +379,82 @@ void PushEventProcessor::UpdatePushEvent(
         iter != push_events.end(); ++iter) {
       LOG(INFO) << "CREATE push event: " << ProtoToString(*iter);
     }
-    if (!business_processor->UpdateEventsToDb(push_events)) {
-      LOG(ERROR) << "update events to db failed";
-      continue;
+    event_cnt += push_events.size();
+    vector<PushEventInfo>& business_events = push_event_map[business_type];
+    business_events.insert(business_events.end(),
+                           push_events.begin(), push_events.end());
+  }
+  vector<PushEventInfo> changed_events;
+  for (auto it = push_event_map.begin(); it != push_event_map.end(); ++it) {
+    BaseBusinessProcessor* business_processor = (
+        business_factory->GetBusinessProcessor(it->first));
+    if (!business_processor->UpdateEventsToDb(it->second, &changed_events)) {
+      LOG(WARNING) << "update push events to db failed, business:"
+                   << it->first;
     }
-    ++success_num;
   }
-  if (success_num != user_orders_number) {
-    LOG(WARNING) << "some order fail to update push evnets";
+  LOG(INFO) << "update push events, order num:" << user_orders->size()
+            << ", event num:" << event_cnt
+            << ", written num:" << changed_events.size();
+  Singleton<PushPoolUpdateStats>::get()->AddCycle(
+      user_orders->size(), event_cnt, changed_events.size());
+  if (push_event_callback_ && !changed_events.empty()) {
+    push_event_callback_(changed_events);
   }
 }
 
+PushPoolUpdateStats::PushPoolUpdateStats()
+  : cycle_cnt_(0),
+    order_cnt_(0),
+    event_cnt_(0),
+    written_cnt_(0),
+    last_order_cnt_(0),
+    last_event_cnt_(0),
+    last_written_cnt_(0),
+    order_latency_cnt_(0),
+    total_order_latency_ms_(0),
+    max_order_latency_ms_(0),
+    last_order_latency_ms_(0) {}
+
+PushPoolUpdateStats::~PushPoolUpdateStats() {}
+
+void PushPoolUpdateStats::AddCycle(int order_cnt, int event_cnt,
+                                   int written_cnt) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++cycle_cnt_;
+  order_cnt_ += order_cnt;
+  event_cnt_ += event_cnt;
+  written_cnt_ += written_cnt;
+  last_order_cnt_ = order_cnt;
+  last_event_cnt_ = event_cnt;
+  last_written_cnt_ = written_cnt;
+}
+
+void PushPoolUpdateStats::AddOrderLatency(int64 latency_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++order_latency_cnt_;
+  total_order_latency_ms_ += latency_ms;
+  max_order_latency_ms_ = std::max(max_order_latency_ms_, latency_ms);
+  last_order_latency_ms_ = latency_ms;
+}
+
+void PushPoolUpdateStats::GetStats(Json::Value* stats) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  (*stats)["cycle_cnt"] = static_cast<Json::UInt64>(cycle_cnt_);
+  (*stats)["order_cnt"] = static_cast<Json::UInt64>(order_cnt_);
+  (*stats)["event_cnt"] = static_cast<Json::UInt64>(event_cnt_);
+  (*stats)["written_cnt"] = static_cast<Json::UInt64>(written_cnt_);
+  (*stats)["last_order_cnt"] = last_order_cnt_;
+  (*stats)["last_event_cnt"] = last_event_cnt_;
+  (*stats)["last_written_cnt"] = last_written_cnt_;
+  (*stats)["kafka_order_cnt"] = static_cast<Json::UInt64>(order_latency_cnt_);
+  (*stats)["order_to_event_avg_latency_ms"] = static_cast<Json::Int64>(
+      order_latency_cnt_ > 0 ?
+      total_order_latency_ms_ / static_cast<int64>(order_latency_cnt_) : 0);
+  (*stats)["order_to_event_max_latency_ms"] =
+      static_cast<Json::Int64>(max_order_latency_ms_);
+  (*stats)["order_to_event_last_latency_ms"] =
+      static_cast<Json::Int64>(last_order_latency_ms_);
+}
+
 }  // namespace push_controller
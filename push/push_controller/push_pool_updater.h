@@ -4,30 +4,62 @@
 #ifndef PUSH_PUSH_CONTROLLER_PUSH_POOL_UPDATER_H_
 #define PUSH_PUSH_CONTROLLER_PUSH_POOL_UPDATER_H_
 
+#include <functional>
+#include <mutex>
+
 #include "base/basictypes.h"
 #include "base/compat.h"
+#include "base/concurrent_queue.h"
+#include "base/singleton.h"
 #include "base/thread.h"
 #include "proto/mysql_config.pb.h"
+#include "third_party/jsoncpp/json.h"
+#include "util/kafka/kafka_util.h"
 
 #include "push/proto/push_meta.pb.h"
 
 namespace push_controller {
 
+// Called with the events of an order once they are written to db.
+typedef std::function<void(const vector<PushEventInfo>& push_events)>
+    PushEventCallback;
+
 class PushPoolUpdater : public mobvoi::Thread {
  public:
-  PushPoolUpdater();
+  explicit PushPoolUpdater(const PushEventCallback& push_event_callback);
   virtual ~PushPoolUpdater();
   virtual void Run();
 
  private:
+  PushEventCallback push_event_callback_;
   DISALLOW_COPY_AND_ASSIGN(PushPoolUpdater);
 };
 
+// Turns the orders published by the message receiver into push events as
+// they arrive, the poller above only sweeps up what was missed.
+class OrderEventConsumer : public mobvoi::Thread {
+ public:
+  explicit OrderEventConsumer(const PushEventCallback& push_event_callback);
+  virtual ~OrderEventConsumer();
+  virtual void Run();
+
+ private:
+  // Collects order_id -> time the order was received in ms.
+  void ParseMessage(const string& message, map<string, int64>* order_time_map);
+
+  PushEventCallback push_event_callback_;
+  std::shared_ptr<mobvoi::ConcurrentQueue<string>> message_queue_;
+  std::unique_ptr<recommendation::KafkaConsumerThread> consumer_thread_;
+  DISALLOW_COPY_AND_ASSIGN(OrderEventConsumer);
+};
+
 class UserOrderProcessor {
  public:
   UserOrderProcessor();
   ~UserOrderProcessor();
   bool QueryUserOrder(vector<UserOrderInfo>* user_order_vector);
+  bool QueryUserOrderById(const vector<string>& order_ids,
+                          vector<UserOrderInfo>* user_order_vector);
 
  private:
   time_t last_updated_;
@@ -38,13 +70,43 @@ class UserOrderProcessor {
 class PushEventProcessor {
  public:
   PushEventProcessor();
+  explicit PushEventProcessor(const PushEventCallback& push_event_callback);
   virtual ~PushEventProcessor();
   virtual void UpdatePushEvent(vector<UserOrderInfo>* user_order_vector);
 
  private:
+  PushEventCallback push_event_callback_;
   DISALLOW_COPY_AND_ASSIGN(PushEventProcessor);
 };
 
+// Counters of the pool update cycles, exported by the status handler.
+class PushPoolUpdateStats {
+ public:
+  ~PushPoolUpdateStats();
+  void AddCycle(int order_cnt, int event_cnt, int written_cnt);
+  // From the order received by the message receiver to its push events.
+  void AddOrderLatency(int64 latency_ms);
+  void GetStats(Json::Value* stats);
+
+ private:
+  friend struct DefaultSingletonTraits<PushPoolUpdateStats>;
+  PushPoolUpdateStats();
+
+  std::mutex mutex_;
+  uint64 cycle_cnt_;
+  uint64 order_cnt_;
+  uint64 event_cnt_;
+  uint64 written_cnt_;
+  int last_order_cnt_;
+  int last_event_cnt_;
+  int last_written_cnt_;
+  uint64 order_latency_cnt_;
+  int64 total_order_latency_ms_;
+  int64 max_order_latency_ms_;
+  int64 last_order_latency_ms_;
+  DISALLOW_COPY_AND_ASSIGN(PushPoolUpdateStats);
+};
+
 }  // namespace push_controller
 
 #endif  // PUSH_PUSH_CONTROLLER_PUSH_POOL_UPDATER_H_
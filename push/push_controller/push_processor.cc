@@ -12,6 +12,9 @@
 #include "third_party/mysql_client_cpp/include/cppconn/statement.h"
 
 DECLARE_bool(use_cluster_mode);
+DECLARE_int32(push_queue_capacity);
+DECLARE_int32(valid_push_time_internal);
+DECLARE_string(push_deadline_slack);
 DECLARE_string(mysql_config);
 DECLARE_string(burypoint_kafka_log_server);
 DECLARE_string(burypoint_kafka_topic);
@@ -46,6 +49,7 @@ static const char kNameEventShowtime[] = "showtime";
 static const char kNameEvent30Min[] = "30min";
 static const char kNameEventTakeoff[] = "takeoff";
 static const char kNameEventArrive[] = "arrive";
+static const char kNameEventFlightChange[] = "flight_change";
 
 }
 
@@ -58,14 +62,27 @@ PushProcessor::PushProcessor() {
 
 PushProcessor::~PushProcessor() {}
 
-void PushProcessor::PushToQueue(const PushEventInfo& push_event) {
-  push_event_queue_->Push(push_event);
+bool PushProcessor::PushToQueue(const PushEventInfo& push_event) {
+  return push_event_queue_->Push(push_event);
+}
+
+void PushProcessor::GetQueueStats(Json::Value* stats) {
+  push_event_queue_->GetStats(stats);
+}
+
+void PushProcessor::GetLinkStats(Json::Value* stats) {
+  push_sender_->GetLinkStats(stats);
 }
 
 void PushProcessor::Run() {
   while (true) {
     PushEventInfo push_event;
-    push_event_queue_->Pop(push_event);
+    if (!push_event_queue_->Pop(&push_event)) {
+      // too late to be worth pushing, give it up like a failed push
+      push_sender_->UpdatePushStatus(push_event, kPushCancled);
+      UploadFailedPushDataToKafka(push_event);
+      continue;
+    }
     VLOG(2) << "Pop push event, event_id:" << push_event.id();
     if (!Process(&push_event)) {
       push_sender_->UpdatePushStatus(push_event, kPushFailed);
@@ -94,13 +111,19 @@ void PushProcessor::Init() {
     {kEventRemindTimelineShowtime, kNameEventShowtime},
     {kEventRemindTimeline30Min, kNameEvent30Min},
     {kEventRemindTimelineTakeoff, kNameEventTakeoff},
-    {kEventRemindTimelineArrive, kNameEventArrive}
+    {kEventRemindTimelineArrive, kNameEventArrive},
+    {kEventRemindTimelineFlightChange, kNameEventFlightChange}
   };
   mysql_server_.reset(new MysqlServer());
   CHECK(file::ReadProtoFromTextFile(FLAGS_mysql_config, mysql_server_.get()));
   VLOG(2) << "Read mysqlConf success, file:" << FLAGS_mysql_config;
   push_sender_.reset(new PushSender());
-  push_event_queue_.reset(new mobvoi::ConcurrentQueue<PushEventInfo>());
+  map<int, int> slack_map;
+  CHECK(PushEventQueue::ParseSlackMap(FLAGS_push_deadline_slack, &slack_map))
+      << "invalid push_deadline_slack:" << FLAGS_push_deadline_slack;
+  push_event_queue_.reset(new PushEventQueue(
+      static_cast<size_t>(FLAGS_push_queue_capacity), slack_map,
+      FLAGS_valid_push_time_internal));
 }
 
 bool PushProcessor::GetUserOrder(const PushEventInfo& push_event,
@@ -233,6 +256,25 @@ void PushProcessor::UploadPushDataToKafka(const UserOrderInfo& user_order,
   LOG(INFO) << "UPLOAD TO KAFKA, data:" << post_data;
 }
 
+void PushProcessor::UploadPushDataToKafka(const UserOrderInfo& user_order,
+                                          const PushEventInfo& push_event,
+                                          const string& push_message) {
+  RenderPushLogRequest(FLAGS_burypoint_kafka_topic,
+                       FLAGS_burypoint_upload_push_log_event_type,
+                       static_cast<uint32_t>(time(NULL)),
+                       FLAGS_use_cluster_mode, user_order, push_event,
+                       push_message, &log_buffer_);
+  util::HttpClient http_client;
+  http_client.SetHttpMethod(util::HttpMethod::kPost);
+  http_client.SetPostData(log_buffer_);
+  if (!http_client.FetchUrl(FLAGS_burypoint_kafka_log_server)) {
+    LOG(WARNING) << "Failed to upload to kafka, response code:"
+                 << http_client.response_code();
+    return;
+  }
+  LOG(INFO) << "UPLOAD TO KAFKA, data:" << log_buffer_;
+}
+
 void PushProcessor::UploadFailedPushDataToKafka(
     const PushEventInfo& push_event) {
   time_t now = time(NULL);
@@ -268,95 +310,7 @@ void PushProcessor::UploadFailedPushDataToKafka(
 
 void PushProcessor::SetGeneralPushContent(const PushContent& content,
                                           Json::Value& message) {
-  message["status"] = content.status;
-  message["id"] = content.id;
-  message["event_key"] = content.event_key;
-  message["product_key"] = content.product_key;
-  message["is_push"] = content.is_push;
-  SetGeneralPushDetail(content.is_push, content.push_detail, message);
-  SetGeneralSys(content.sys, message);
-  SetGeneralTimeline(content.timeline_detail, message);
-  SetGeneralDetail(content.detail, message);
-}
-
-void PushProcessor::SetGeneralPushDetail(bool is_push,
-                                         const PushFields& push,
-                                         Json::Value& message) {
-  if (!is_push) {
-    Json::Value null_val(Json::objectValue);
-    message["push_detail"] = null_val;
-    return;
-  }
-  message["push_detail"]["push_time"] = push.push_time;
-  message["push_detail"]["position1"] = push.position1;
-  message["push_detail"]["position2"] = push.position2;
-  message["push_detail"]["position3"] = push.position3;
-  message["push_detail"]["position4"] = push.position4;
-  message["push_detail"]["des"] = push.des;
-  message["push_detail"]["ui_type"] = push.ui_type;
-}
-
-void PushProcessor::SetGeneralSys(const SysFields& sys,
-                                  Json::Value& message) {
-  message["sys"]["expire_time"] = sys.expire_time;
-}
-
-void PushProcessor::SetGeneralTimeline(const TimelineFields& timeline,
-                                       Json::Value& message) {
-  message["timeline_detail"]["title"] = timeline.title;
-  message["timeline_detail"]["des"] = timeline.des;
-  Json::Value ticker;
-  for (auto t : timeline.ticker) {
-    ticker.append(t);
-  }
-  message["timeline_detail"]["ticker"] = ticker;
-}
-
-void PushProcessor::SetGeneralDetail(const DetailFields& detail,
-                                     Json::Value& message) {
-  message["detail"]["icon"] = detail.icon;
-  message["detail"]["icon_code"] = detail.icon_code;
-  message["detail"]["title"]["text"] = detail.title.text;
-  message["detail"]["title"]["color"] = detail.title.color;
-  message["detail"]["title"]["font"] = detail.title.font;
-  message["detail"]["title"]["word_wrap"] = detail.title.word_wrap;
-  message["detail"]["title"]["icon"] = detail.title.icon;
-  message["detail"]["title"]["icon_code"] = detail.title.icon_code;
-  message["detail"]["title"]["top_margin"] = detail.title.top_margin;
-  message["detail"]["title"]["bottom_margin"] =
-    detail.title.bottom_margin;
-  message["detail"]["des"]["text"] = detail.des.text;
-  message["detail"]["des"]["color"] = detail.des.color;
-  message["detail"]["des"]["font"] = detail.des.font;
-  message["detail"]["des"]["word_wrap"] = detail.des.word_wrap;
-  message["detail"]["des"]["icon"] = detail.des.icon;
-  message["detail"]["des"]["icon_code"] = detail.des.icon_code;
-  message["detail"]["des"]["top_margin"] = detail.des.top_margin;
-  message["detail"]["des"]["bottom_margin"] = detail.des.bottom_margin;
-  for (auto text : detail.text_list) {
-    Json::Value val;
-    val["text"] = text.text;
-    val["color"] = text.color;
-    val["font"] = text.font;
-    val["word_wrap"] = text.word_wrap;
-    val["icon"] = text.icon;
-    val["icon_code"] = text.icon_code;
-    val["top_margin"] = text.top_margin;
-    val["bottom_margin"] = text.bottom_margin;
-    message["detail"]["text_list"].append(val);
-  }
-  for (auto link : detail.link_list) {
-    Json::Value val;
-    val["text"] = link.text;
-    val["color"] = link.color;
-    val["font"] = link.font;
-    val["bg_color"] = link.bg_color;
-    val["data"] = link.data;
-    val["geo"] = link.geo;
-    val["type"] = static_cast<int32>(link.type);
-    val["id"] = link.id;
-    message["detail"]["link_list"].append(val);
-  }
+  BuildPushContentJson(content, &message);
 }
 
 bool PushProcessor::FilterVersion(const string& wear_version,
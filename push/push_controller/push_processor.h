@@ -17,6 +17,8 @@
 #include "third_party/jsoncpp/json.h"
 #include "util/net/http_client/http_client.h"
 
+#include "push/push_controller/push_event_queue.h"
+#include "push/push_controller/push_message_renderer.h"
 #include "push/push_controller/push_sender.h"
 #include "push/proto/flight_meta.pb.h"
 #include "push/proto/train_meta.pb.h"
@@ -55,81 +57,14 @@ enum IconValue {
   kIconSmallDefault = 6,
 };
 
-enum ApplicationType {
-  kApplicationDefault = 0,
-  kApplicationNavigation = 1,
-  kApplicationTaxi = 2,
-  kApplicationCallup = 3,
-};
-
-struct TextType {
-  string text;
-  string color;
-  int font;
-  bool word_wrap;
-  int icon;
-  string icon_code;
-  int top_margin;
-  int bottom_margin;
-};
-
-struct LinkType {
-  string text;
-  string color;
-  int font;
-  string bg_color;
-  string data;
-  string geo;
-  ApplicationType type;
-  string id;
-};
-
-struct PushFields {
-  string push_time;
-  string position1;
-  string position2;
-  string position3;
-  string position4;
-  string des;
-  string ui_type;
-};
-
-struct SysFields {
-  string expire_time;
-};
-
-struct TimelineFields {
-  string title;
-  vector<string> ticker;
-  string des;
-};
-
-struct DetailFields {
-  int icon;
-  string icon_code;
-  TextType title;
-  vector<TextType> text_list;
-  TextType des;
-  vector<LinkType> link_list;
-};
-
-struct PushContent {
-  string status;
-  string id;
-  string event_key;
-  string product_key;
-  bool is_push;
-  PushFields push_detail;
-  SysFields sys;
-  TimelineFields timeline_detail;
-  DetailFields detail;
-};
-
 class PushProcessor : public mobvoi::Thread {
  public:
   PushProcessor();
   virtual ~PushProcessor();
-  void PushToQueue(const PushEventInfo& push_event);
+  // Returns false if the queue of the processor is full.
+  bool PushToQueue(const PushEventInfo& push_event);
+  void GetQueueStats(Json::Value* stats);
+  void GetLinkStats(Json::Value* stats);
   virtual bool Process(PushEventInfo* push_event) = 0;
   void Run();
   void Init();
@@ -154,21 +89,23 @@ class PushProcessor : public mobvoi::Thread {
   void UploadPushDataToKafka(const UserOrderInfo& user_order,
                              const PushEventInfo& push_event,
                              const Json::Value& push_message);
+  // For a push message rendered by RenderPushContent.
+  void UploadPushDataToKafka(const UserOrderInfo& user_order,
+                             const PushEventInfo& push_event,
+                             const string& push_message);
   void UploadFailedPushDataToKafka(const PushEventInfo& push_event);
   void SetGeneralPushContent(const PushContent& content, Json::Value& message);
-  void SetGeneralPushDetail(bool is_push, const PushFields& push,
-                            Json::Value& message);
-  void SetGeneralSys(const SysFields& sys, Json::Value& message);
-  void SetGeneralTimeline(const TimelineFields& timeline, Json::Value& message);
-  void SetGeneralDetail(const DetailFields& detail, Json::Value& message);
 
   map<BusinessType, string> business_key_map_;
   map<EventType, string> event_key_map_;
   std::unique_ptr<MysqlServer> mysql_server_;
   std::unique_ptr<PushSender> push_sender_;
+  // reused by the rendered pushes of the processor thread
+  string message_buffer_;
 
  private:
-  std::unique_ptr<mobvoi::ConcurrentQueue<PushEventInfo>> push_event_queue_;
+  string log_buffer_;
+  std::unique_ptr<PushEventQueue> push_event_queue_;
   DISALLOW_COPY_AND_ASSIGN(PushProcessor);
 };
 
@@ -1,6 +1,9 @@
 // Copyright 2016 Mobvoi Inc. All Rights Reserved.
 // Author: xjliu@mobvoi.com (Xiaojia Liu)
 
+#include <chrono>
+#include <thread>
+
 #include "base/file/proto_util.h"
 #include "base/log.h"
 #include "base/string_util.h"
@@ -23,7 +26,9 @@
 
 DECLARE_bool(use_cluster_mode);
 DECLARE_bool(enable_schedule_push);
+DECLARE_int32(push_backlog_capacity);
 DECLARE_int32(push_scheduler_internal);
+DECLARE_int32(valid_push_time_internal);
 DECLARE_string(mysql_config);
 DECLARE_string(zookeeper_watched_path);
 
@@ -33,15 +38,17 @@ static const string kTimeFormat = "%Y-%m-%d %H:%M:%S";
 
 static const char kSelectFormat[] =
   "SELECT id, order_id, user_id, business_type, event_type, push_detail, "
-  "push_time, business_key, is_realtime, push_status, updated, finished_time "
-  "FROM push_event_info WHERE date(push_time) IN ('%s', '%s', '%s');";
+  "push_time, business_key, is_realtime, push_status, updated, finished_time, "
+  "fingerprint_id "
+  "FROM push_event_info WHERE push_time BETWEEN FROM_UNIXTIME(%ld) AND "
+  "FROM_UNIXTIME(%ld);";
 
 static const char kSelectFormatV2[] =
   "SELECT id, order_id, user_id, business_type, event_type, push_detail, "
   "push_time, business_key, is_realtime, push_status, updated, finished_time, "
   "fingerprint_id "
-  "FROM push_event_info WHERE date(push_time) IN ('%s', '%s', '%s') "
-  "AND mod(fingerprint_id, %d) = %d;";
+  "FROM push_event_info WHERE push_time BETWEEN FROM_UNIXTIME(%ld) AND "
+  "FROM_UNIXTIME(%ld) AND mod(fingerprint_id, %d) = %d;";
 
 static const char kFetchPhoneNicknameFormat[] =
   "SELECT package_name, name, device_id FROM nickname WHERE name = '%s' AND "
@@ -67,16 +74,29 @@ PushScheduler::PushScheduler() {
   CHECK(file::ReadProtoFromTextFile(FLAGS_mysql_config, mysql_server_.get()));
   VLOG(1) << "Read MySQLConf from file:" << FLAGS_mysql_config;
   filter_manager_.reset(new FilterManager());
+  timer_wheel_.reset(
+      new PushTimerWheel(time(NULL), FLAGS_valid_push_time_internal));
+  last_reconcile_time_ = 0;
+  backlog_drop_cnt_ = 0;
 }
 
 PushScheduler::~PushScheduler() {}
 
 void PushScheduler::Run() {
   LOG(INFO) << "PushScheduler::Run() ...";
+  auto next_tick = std::chrono::system_clock::now();
   while (true) {
     if (FLAGS_enable_schedule_push) {
+      time_t now = time(NULL);
+      if (now - last_reconcile_time_ >= FLAGS_push_scheduler_internal) {
+        ReconcilePushEvents();
+        last_reconcile_time_ = now;
+      }
       vector<PushEventInfo> push_events;
-      FetchPushEvents(&push_events);
+      {
+        std::lock_guard<std::mutex> lock(wheel_mutex_);
+        timer_wheel_->Advance(now, &push_events);
+      }
       if (!push_events.empty()) {
         FetchNicknameTable(&push_events);
         FetchDeviceTable(&push_events);
@@ -85,23 +105,48 @@ void PushScheduler::Run() {
         FilterPushEvents(&push_events);
         LOG(INFO) << "Finish to filter push events, size: " << push_events.size();
       }
-      if (!push_events.empty()) {
-        PushToQueue(push_events);
-        VLOG(2) << "Push to queue finished";
+      // also drains the backlogs when nothing new is due
+      PushToQueue(push_events);
+      next_tick += std::chrono::seconds(1);
+      if (next_tick < std::chrono::system_clock::now()) {
+        next_tick = std::chrono::system_clock::now();
       }
+      std::this_thread::sleep_until(next_tick);
     } else {
       LOG(INFO) << "push need not schedule";
+      mobvoi::Sleep(FLAGS_push_scheduler_internal);
+      next_tick = std::chrono::system_clock::now();
+    }
+  }
+}
+
+void PushScheduler::AddPushEvents(const vector<PushEventInfo>& push_events) {
+  int added_cnt = 0;
+  std::lock_guard<std::mutex> lock(wheel_mutex_);
+  for (auto it = push_events.begin(); it != push_events.end(); ++it) {
+    if (timer_wheel_->Add(*it)) {
+      ++added_cnt;
     }
-    mobvoi::Sleep(FLAGS_push_scheduler_internal);
   }
+  VLOG(1) << "add push events, size:" << push_events.size()
+          << ", added:" << added_cnt
+          << ", scheduled:" << timer_wheel_->size();
+}
+
+void PushScheduler::ReconcilePushEvents() {
+  vector<PushEventInfo> push_events;
+  FetchPushEvents(&push_events);
+  AddPushEvents(push_events);
+  LOG(INFO) << "Finish to reconcile push events, size: " << push_events.size();
 }
 
 void PushScheduler::FetchPushEvents(vector<PushEventInfo>* push_events) {
   VLOG(2) << "PushScheduler::FetchPushEvents() ...";
-  string today, tomorrow, yesterday;
-  recommendation::MakeDate(0, &today);
-  recommendation::MakeDate(1, &tomorrow);
-  recommendation::MakeDate(-1, &yesterday);
+  // events still valid now, up to the ones due before the next reconcile,
+  // a range on push_time so the index on it can be used
+  time_t now = time(NULL);
+  long begin_time = now - FLAGS_valid_push_time_internal;
+  long end_time = now + 2 * FLAGS_push_scheduler_internal;
   try {
     sql::Driver* driver = sql::mysql::get_driver_instance();
     std::unique_ptr<sql::Connection>
@@ -122,12 +167,10 @@ void PushScheduler::FetchPushEvents(vector<PushEventInfo>* push_events) {
                    << ", node_cnt=" << node_cnt;
         return;
       }
-      select_sql = StringPrintf(kSelectFormatV2, yesterday.c_str(),
-                                today.c_str(), tomorrow.c_str(),
+      select_sql = StringPrintf(kSelectFormatV2, begin_time, end_time,
                                 node_cnt, node_pos);
     } else {
-      select_sql = StringPrintf(kSelectFormat, yesterday.c_str(),
-                                today.c_str(), tomorrow.c_str());
+      select_sql = StringPrintf(kSelectFormat, begin_time, end_time);
     }
     VLOG(2) << "SELECT command: " << select_sql;
     std::unique_ptr<sql::ResultSet> result_set(
@@ -333,18 +376,45 @@ void PushScheduler::FilterPushEvents(vector<PushEventInfo>* push_events) {
 
 void PushScheduler::PushToQueue(const vector<PushEventInfo>& push_events) {
   VLOG(2) << "PushScheduler::PushToQueue, event size:" << push_events.size();
+  int drop_cnt = 0;
   for (auto it = push_events.begin(); it != push_events.end(); ++it) {
-    BusinessType business_type = it->business_type();
-    BusinessFactory* business_factory = Singleton<BusinessFactory>::get();
+    std::deque<PushEventInfo>& backlog = backlog_map_[it->business_type()];
+    // a processor stuck for long must not grow the backlog without bound
+    if (static_cast<int>(backlog.size()) >= FLAGS_push_backlog_capacity) {
+      ++drop_cnt;
+      continue;
+    }
+    backlog.push_back(*it);
+  }
+  if (drop_cnt > 0) {
+    backlog_drop_cnt_ += drop_cnt;
+    LOG(WARNING) << "push backlog is full, dropped:" << drop_cnt
+                 << ", total dropped:" << backlog_drop_cnt_;
+  }
+  BusinessFactory* business_factory = Singleton<BusinessFactory>::get();
+  for (auto it = backlog_map_.begin(); it != backlog_map_.end();) {
+    BusinessType business_type = it->first;
+    std::deque<PushEventInfo>& backlog = it->second;
     PushProcessor* push_processor =
       business_factory->GetPushProcessor(business_type);
     if (!push_processor) {
       LOG(ERROR) << "Get push processor failed, business_type:"
-                 << business_type;
+                 << business_type << ", dropped:" << backlog.size();
+      it = backlog_map_.erase(it);
       continue;
     }
-    push_processor->PushToQueue(*it);
-    VLOG(2) << "finish to push one to queue, business_type:" << business_type;
+    // a full queue only holds back its own business, the rest are retried
+    // on the next tick
+    while (!backlog.empty() && push_processor->PushToQueue(backlog.front())) {
+      backlog.pop_front();
+    }
+    if (backlog.empty()) {
+      it = backlog_map_.erase(it);
+    } else {
+      VLOG(1) << "push queue is full, business_type:" << business_type
+              << ", backlog:" << backlog.size();
+      ++it;
+    }
   }
 }
 
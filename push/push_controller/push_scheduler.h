@@ -4,31 +4,54 @@
 #ifndef PUSH_PUSH_CONTROLLER_PUSH_SCHEDULER_H_
 #define PUSH_PUSH_CONTROLLER_PUSH_SCHEDULER_H_
 
+#include <time.h>
+
+#include <deque>
+#include <mutex>
+
 #include "base/basictypes.h"
 #include "base/compat.h"
 #include "base/thread.h"
 #include "proto/mysql_config.pb.h"
 
 #include "push/push_controller/filter.h"
+#include "push/push_controller/push_timer_wheel.h"
 #include "push/proto/push_meta.pb.h"
 
 namespace push_controller {
 
+// Keeps the upcoming push events in a timer wheel and hands each one to its
+// push processor when its push_time comes. Events arrive from the pool
+// updater as they are written, and a periodic reconciliation against db
+// picks up whatever was missed, e.g. after a restart.
 class PushScheduler : public mobvoi::Thread {
  public:
   PushScheduler();
   virtual ~PushScheduler();
   virtual void Run();
+  // Thread safe, called by the pool updater after writing events to db.
+  void AddPushEvents(const vector<PushEventInfo>& push_events);
 
  private:
+  void ReconcilePushEvents();
   void FetchPushEvents(vector<PushEventInfo>* push_events);
   void FetchNicknameTable(vector<PushEventInfo>* push_events);
   void FetchDeviceTable(vector<PushEventInfo>* push_events);
   void FilterPushEvents(vector<PushEventInfo>* push_events);
+  // Hands the due events to the queues of their processors without
+  // blocking, what a full queue rejects waits in its business backlog.
+  // Events beyond --push_backlog_capacity per business are dropped.
   void PushToQueue(const vector<PushEventInfo>& push_events);
 
   std::unique_ptr<MysqlServer> mysql_server_;
   std::unique_ptr<FilterManager> filter_manager_;
+  std::mutex wheel_mutex_;
+  std::unique_ptr<PushTimerWheel> timer_wheel_;
+  time_t last_reconcile_time_;
+  // business_type -> filtered events waiting for room in the queue of the
+  // processor, only touched by the scheduler thread
+  map<BusinessType, std::deque<PushEventInfo>> backlog_map_;
+  uint64 backlog_drop_cnt_;
   DISALLOW_COPY_AND_ASSIGN(PushScheduler);
 };
 
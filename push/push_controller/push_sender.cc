@@ -14,12 +14,16 @@
 #include "third_party/mysql_client_cpp/include/cppconn/exception.h"
 #include "third_party/mysql_client_cpp/include/cppconn/resultset.h"
 #include "third_party/mysql_client_cpp/include/cppconn/statement.h"
-#include "util/net/http_client/http_client.h"
 
+#include "push/push_controller/push_message_renderer.h"
 #include "push/util/common_util.h"
 
-DECLARE_string(mysql_config);
+DECLARE_int32(link_batch_size);
+DECLARE_int32(link_connection_num);
+
 DECLARE_string(link_server);
+DECLARE_string(link_server_batch);
+DECLARE_string(mysql_config);
 
 namespace {
 
@@ -38,6 +42,10 @@ PushSender::PushSender() {
   mysql_server_.reset(new MysqlServer());
   CHECK(file::ReadProtoFromTextFile(FLAGS_mysql_config, mysql_server_.get()));
   VLOG(1) << "Read MySQLConf from file:" << FLAGS_mysql_config;
+  link_client_.reset(new LinkClient(FLAGS_link_server,
+                                    FLAGS_link_server_batch,
+                                    FLAGS_link_connection_num,
+                                    FLAGS_link_batch_size));
 }
 
 PushSender::~PushSender() {}
@@ -46,9 +54,6 @@ bool PushSender::SendPush(MessageType message_type,
                           const string& message_desc,
                           const string& user_id,
                           const Json::Value& message_content) {
-  util::HttpClient http_client;
-  http_client.SetHttpMethod(util::HttpMethod::kPost);
-  http_client.AddHeader("Content-Type", "application/json; charset=utf-8");
   Json::Value message, push;
   message["type"] = message_type;
   message["desc"] = message_desc;
@@ -56,28 +61,31 @@ bool PushSender::SendPush(MessageType message_type,
   push["message"] = message;
   push["user_name"] = user_id;
   push["package_name"] = kPackageName;
-  string post_data = JsonToString(push);
-  LOG(INFO) << "SEND push request: " << post_data;
-  http_client.SetPostData(post_data);
-  if (http_client.FetchUrl(FLAGS_link_server)) {
-    string result = http_client.ResponseBody();
-    try {
-      Json::Value value;
-      Json::Reader reader;
-      if (reader.parse(result, value)) {
-        if (value.isMember("status") && value["status"] == true) {
-          LOG(INFO) << "SEND push success, response:" << result;
-          return true;
-        }
-      }
-    } catch (const std::exception& e) {
-      LOG(ERROR) << "send push failed: " << e.what() << ", response: "
-        << http_client.ResponseBody();
-      return false;
-    }
+  return link_client_->Send(JsonToString(push));
+}
+
+bool PushSender::SendPush(MessageType message_type,
+                          const string& message_desc,
+                          const string& user_id,
+                          const string& message_content) {
+  RenderPushRequest(message_type, message_desc, user_id, kPackageName,
+                    message_content, &request_buffer_);
+  return link_client_->Send(request_buffer_);
+}
+
+void PushSender::SendPushBatch(const vector<PushRequest>& pushes,
+                               vector<bool>* results) {
+  vector<string> push_requests(pushes.size());
+  for (size_t i = 0; i < pushes.size(); ++i) {
+    const PushRequest& push = pushes[i];
+    RenderPushRequest(push.message_type, push.message_desc, push.user_id,
+                      kPackageName, push.message_content, &push_requests[i]);
   }
-  LOG(ERROR) << "send push failed: response: " << http_client.ResponseBody();
-  return false;
+  link_client_->SendBatch(push_requests, results);
+}
+
+void PushSender::GetLinkStats(Json::Value* stats) {
+  link_client_->GetStats(stats);
 }
 
 bool PushSender::UpdatePushStatus(const PushEventInfo& push_event_info,
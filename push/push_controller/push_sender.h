@@ -4,14 +4,25 @@
 #ifndef PUSH_PUSH_CONTROLLER_PUSH_SENDER_H_
 #define PUSH_PUSH_CONTROLLER_PUSH_SENDER_H_
 
+#include <memory>
+
 #include "base/basictypes.h"
 #include "base/compat.h"
 #include "proto/mysql_config.pb.h"
 #include "third_party/jsoncpp/json.h"
 #include "push/proto/push_meta.pb.h"
+#include "push/push_controller/link_client.h"
 
 namespace push_controller {
 
+// One push of SendPushBatch, message_content is a serialized JSON object.
+struct PushRequest {
+  MessageType message_type;
+  string message_desc;
+  string user_id;
+  string message_content;
+};
+
 class PushSender {
  public:
   PushSender();
@@ -20,11 +31,25 @@ class PushSender {
                 const string& message_desc,
                 const string& user_id,
                 const Json::Value& message_content);
+  // For a content rendered by RenderPushContent, not thread safe.
+  bool SendPush(MessageType message_type,
+                const string& message_desc,
+                const string& user_id,
+                const string& message_content);
+  // Sends the pushes over the keep-alive connections to the link server,
+  // in batch requests if --link_server_batch is set. (*results)[i] tells
+  // whether pushes[i] is accepted.
+  void SendPushBatch(const vector<PushRequest>& pushes,
+                     vector<bool>* results);
   bool UpdatePushStatus(const PushEventInfo& push_event_info,
                         PushStatus push_status);
+  // Stats of the connections to the link server.
+  void GetLinkStats(Json::Value* stats);
 
  private:
   std::unique_ptr<MysqlServer> mysql_server_;
+  std::unique_ptr<LinkClient> link_client_;
+  string request_buffer_;
   DISALLOW_COPY_AND_ASSIGN(PushSender);
 };
 
@@ -0,0 +1,126 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/push_controller/push_timer_wheel.h"
+
+#include "base/log.h"
+
+namespace push_controller {
+
+PushTimerWheel::PushTimerWheel(time_t now, int fired_retention_seconds)
+  : current_time_(now),
+    fired_retention_seconds_(fired_retention_seconds),
+    next_generation_(0) {}
+
+PushTimerWheel::~PushTimerWheel() {}
+
+bool PushTimerWheel::Add(const PushEventInfo& push_event) {
+  time_t push_time = static_cast<time_t>(push_event.push_time());
+  if (push_time + fired_retention_seconds_ <= current_time_) {
+    VLOG(2) << "outdated push event, id:" << push_event.id();
+    return false;
+  }
+  auto fired_it = fired_map_.find(push_event.id());
+  if (fired_it != fired_map_.end()) {
+    if (fired_it->second == push_time) {
+      return false;
+    }
+    // the push time moved, e.g. a delayed flight, push it again
+    fired_map_.erase(fired_it);
+  }
+  Entry& entry = entries_[push_event.id()];
+  entry.push_event = push_event;
+  entry.generation = ++next_generation_;
+  SlotItem item;
+  item.id = push_event.id();
+  item.generation = entry.generation;
+  item.expire_time = push_time;
+  Schedule(item);
+  return true;
+}
+
+void PushTimerWheel::Advance(time_t now, vector<PushEventInfo>* due_events) {
+  if (!due_items_.empty()) {
+    vector<SlotItem> items;
+    items.swap(due_items_);
+    Fire(items, due_events);
+  }
+  while (current_time_ < now) {
+    ++current_time_;
+    for (int level = 1; level < kLevelNum; ++level) {
+      int shift = kSlotBits * level;
+      if (((current_time_ >> (shift - kSlotBits)) & kSlotMask) != 0) {
+        break;
+      }
+      if (level == kLevelNum - 1 &&
+          ((current_time_ >> shift) & kSlotMask) == 0) {
+        // the top level wrapped, the overflow may fit in now
+        vector<SlotItem> items;
+        items.swap(overflow_);
+        for (auto& item : items) {
+          Schedule(item);
+        }
+      }
+      Cascade(level);
+    }
+    vector<SlotItem> items;
+    items.swap(slots_[0][current_time_ & kSlotMask]);
+    // items cascaded right onto their expire time land in due_items_
+    items.insert(items.end(), due_items_.begin(), due_items_.end());
+    due_items_.clear();
+    Fire(items, due_events);
+    if ((current_time_ & kSlotMask) == 0) {
+      PruneFired();
+    }
+  }
+}
+
+void PushTimerWheel::Schedule(const SlotItem& item) {
+  time_t delta = item.expire_time - current_time_;
+  if (delta <= 0) {
+    due_items_.push_back(item);
+    return;
+  }
+  for (int level = 0; level < kLevelNum; ++level) {
+    int shift = kSlotBits * level;
+    if (delta < (static_cast<time_t>(1) << (shift + kSlotBits))) {
+      slots_[level][(item.expire_time >> shift) & kSlotMask].push_back(item);
+      return;
+    }
+  }
+  overflow_.push_back(item);
+}
+
+void PushTimerWheel::Cascade(int level) {
+  int shift = kSlotBits * level;
+  vector<SlotItem> items;
+  items.swap(slots_[level][(current_time_ >> shift) & kSlotMask]);
+  for (auto& item : items) {
+    Schedule(item);
+  }
+}
+
+void PushTimerWheel::Fire(const vector<SlotItem>& items,
+                          vector<PushEventInfo>* due_events) {
+  for (auto& item : items) {
+    auto it = entries_.find(item.id);
+    if (it == entries_.end() || it->second.generation != item.generation) {
+      continue;
+    }
+    fired_map_[item.id] = item.expire_time;
+    due_events->push_back(it->second.push_event);
+    entries_.erase(it);
+  }
+}
+
+void PushTimerWheel::PruneFired() {
+  for (auto it = fired_map_.begin(); it != fired_map_.end();) {
+    if (it->second + fired_retention_seconds_ <= current_time_) {
+      it = fired_map_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace push_controller
@@ -0,0 +1,78 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#ifndef PUSH_PUSH_CONTROLLER_PUSH_TIMER_WHEEL_H_
+#define PUSH_PUSH_CONTROLLER_PUSH_TIMER_WHEEL_H_
+
+#include <time.h>
+
+#include <unordered_map>
+
+#include "base/basictypes.h"
+#include "base/compat.h"
+
+#include "push/proto/push_meta.pb.h"
+
+namespace push_controller {
+
+// Hierarchical timing wheel of push events with one second ticks. Four
+// levels of 64 slots cover about 194 days, later events wait in an
+// overflow list. Adding an event is O(1) and so is each tick, apart from
+// the amortized cascading of the upper levels. Not thread safe.
+class PushTimerWheel {
+ public:
+  // Events fired or due more than fired_retention_seconds ago are
+  // rejected, so a reconciled event is not fired twice.
+  PushTimerWheel(time_t now, int fired_retention_seconds);
+  ~PushTimerWheel();
+  // Adds the event or replaces the one with the same id. Returns false if
+  // the event is outdated or already fired at the same push_time.
+  bool Add(const PushEventInfo& push_event);
+  // Ticks up to now and appends the events whose push_time has come.
+  void Advance(time_t now, vector<PushEventInfo>* due_events);
+  size_t size() const {
+    return entries_.size();
+  }
+  time_t current_time() const {
+    return current_time_;
+  }
+
+ private:
+  static const int kLevelNum = 4;
+  static const int kSlotBits = 6;
+  static const int kSlotNum = 1 << kSlotBits;
+  static const int kSlotMask = kSlotNum - 1;
+
+  struct Entry {
+    PushEventInfo push_event;
+    uint64 generation;
+  };
+  struct SlotItem {
+    string id;
+    uint64 generation;
+    time_t expire_time;
+  };
+
+  void Schedule(const SlotItem& item);
+  // Moves the items of the current slot of level down to lower levels.
+  void Cascade(int level);
+  void Fire(const vector<SlotItem>& items,
+            vector<PushEventInfo>* due_events);
+  void PruneFired();
+
+  time_t current_time_;
+  int fired_retention_seconds_;
+  uint64 next_generation_;
+  vector<SlotItem> slots_[kLevelNum][kSlotNum];
+  vector<SlotItem> overflow_;
+  vector<SlotItem> due_items_;
+  // id -> the latest version of the event, stale slot items are skipped
+  std::unordered_map<string, Entry> entries_;
+  // id -> push_time it was fired at
+  std::unordered_map<string, time_t> fired_map_;
+  DISALLOW_COPY_AND_ASSIGN(PushTimerWheel);
+};
+
+}  // namespace push_controller
+
+#endif  // PUSH_PUSH_CONTROLLER_PUSH_TIMER_WHEEL_H_
@@ -0,0 +1,75 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "base/string_util.h"
+#include "push/push_controller/push_timer_wheel.h"
+#include "third_party/gtest/gtest.h"
+
+using namespace push_controller;
+
+namespace {
+
+static const time_t kNow = 1500000000;
+static const int kRetentionSeconds = 1200;
+
+PushEventInfo MakeEvent(const string& id, time_t push_time) {
+  PushEventInfo push_event;
+  push_event.set_id(id);
+  push_event.set_push_time(push_time);
+  return push_event;
+}
+
+// Advances second by second and returns the time each event fired at.
+map<string, time_t> RunUntil(PushTimerWheel* wheel, time_t end_time) {
+  map<string, time_t> fired_map;
+  vector<PushEventInfo> due_events;
+  for (time_t now = wheel->current_time(); now <= end_time; ++now) {
+    due_events.clear();
+    wheel->Advance(now, &due_events);
+    for (auto& push_event : due_events) {
+      fired_map[push_event.id()] = now;
+    }
+  }
+  return fired_map;
+}
+
+}  // namespace
+
+TEST(PushTimerWheelTest, FireAtPushTime) {
+  PushTimerWheel wheel(kNow, kRetentionSeconds);
+  vector<time_t> offsets = {1, 63, 64, 65, 4095, 4096, 4097, 86400, 3 * 86400};
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    EXPECT_TRUE(wheel.Add(MakeEvent(IntToString(i), kNow + offsets[i])));
+  }
+  EXPECT_EQ(offsets.size(), wheel.size());
+  map<string, time_t> fired_map = RunUntil(&wheel, kNow + 3 * 86400 + 10);
+  ASSERT_EQ(offsets.size(), fired_map.size());
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    EXPECT_EQ(kNow + offsets[i], fired_map[IntToString(i)]) << offsets[i];
+  }
+  EXPECT_EQ(0u, wheel.size());
+}
+
+TEST(PushTimerWheelTest, DueAndOutdatedEvents) {
+  PushTimerWheel wheel(kNow, kRetentionSeconds);
+  EXPECT_TRUE(wheel.Add(MakeEvent("due", kNow - 60)));
+  EXPECT_FALSE(wheel.Add(MakeEvent("outdated", kNow - kRetentionSeconds)));
+  vector<PushEventInfo> due_events;
+  wheel.Advance(kNow, &due_events);
+  ASSERT_EQ(1u, due_events.size());
+  EXPECT_EQ("due", due_events[0].id());
+  // reconciliation brings the fired event again
+  EXPECT_FALSE(wheel.Add(MakeEvent("due", kNow - 60)));
+}
+
+TEST(PushTimerWheelTest, ReplaceEvent) {
+  PushTimerWheel wheel(kNow, kRetentionSeconds);
+  EXPECT_TRUE(wheel.Add(MakeEvent("flight", kNow + 100)));
+  EXPECT_TRUE(wheel.Add(MakeEvent("flight", kNow + 5000)));
+  EXPECT_EQ(1u, wheel.size());
+  map<string, time_t> fired_map = RunUntil(&wheel, kNow + 6000);
+  ASSERT_EQ(1u, fired_map.size());
+  EXPECT_EQ(kNow + 5000, fired_map["flight"]);
+  // a delayed push time fires again
+  EXPECT_TRUE(wheel.Add(MakeEvent("flight", kNow + 6100)));
+}
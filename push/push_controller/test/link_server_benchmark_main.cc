@@ -0,0 +1,156 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include <chrono>
+#include <thread>
+
+#include "base/at_exit.h"
+#include "base/log.h"
+#include "base/string_util.h"
+#include "third_party/gflags/gflags.h"
+#include "third_party/jsoncpp/json.h"
+#include "util/net/http_client/http_client.h"
+#include "util/net/http_server/http_handler.h"
+#include "util/net/http_server/http_server.h"
+
+#include "push/push_controller/link_client.h"
+#include "push/push_controller/push_message_renderer.h"
+
+DEFINE_int32(fake_link_port, 9099, "loopback port of the fake link server");
+DEFINE_int32(fake_link_thread_num, 8, "");
+DEFINE_int32(fake_link_latency_ms, 0, "time the fake link server takes "
+             "for each request");
+DEFINE_int32(benchmark_push_cnt, 2000, "pushes per mode");
+DEFINE_int32(benchmark_connection_num, 4, "");
+DEFINE_int32(benchmark_batch_size, 100, "");
+
+using namespace push_controller;
+
+namespace {
+
+bool HandlePush(util::HttpRequest* request, util::HttpResponse* response) {
+  if (FLAGS_fake_link_latency_ms > 0) {
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(FLAGS_fake_link_latency_ms));
+  }
+  response->AppendHeader("Content-Type", "application/json;charset=UTF-8");
+  response->AppendBuffer("{\"status\":true}");
+  return true;
+}
+
+// Accepts every push of the batch.
+bool HandleBatchPush(util::HttpRequest* request,
+                     util::HttpResponse* response) {
+  if (FLAGS_fake_link_latency_ms > 0) {
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(FLAGS_fake_link_latency_ms));
+  }
+  Json::Value batch;
+  Json::Reader reader;
+  Json::Value result;
+  result["status"] = reader.parse(request->GetRequestData(), batch) &&
+                     batch["pushes"].isArray();
+  Json::Value results(Json::arrayValue);
+  for (Json::ArrayIndex i = 0; i < batch["pushes"].size(); ++i) {
+    results.append(true);
+  }
+  result["results"] = results;
+  Json::FastWriter writer;
+  response->AppendHeader("Content-Type", "application/json;charset=UTF-8");
+  response->AppendBuffer(writer.write(result));
+  return true;
+}
+
+void RunFakeLinkServer() {
+  util::HttpServer http_server(
+      FLAGS_fake_link_port,
+      static_cast<size_t>(FLAGS_fake_link_thread_num));
+  util::DefaultHttpHandler push_http_handler(HandlePush);
+  util::DefaultHttpHandler batch_push_http_handler(HandleBatchPush);
+  http_server.RegisterHttpHandler("/push", &push_http_handler);
+  http_server.RegisterHttpHandler("/batch_push", &batch_push_http_handler);
+  http_server.Serv();
+}
+
+// What PushSender did before LinkClient: a new HttpClient for each push.
+bool SendWithNewConnection(const string& url, const string& push_request) {
+  util::HttpClient http_client;
+  http_client.SetHttpMethod(util::HttpMethod::kPost);
+  http_client.AddHeader("Content-Type", "application/json; charset=utf-8");
+  http_client.SetPostData(push_request);
+  return http_client.FetchUrl(url) && http_client.response_code() == 200;
+}
+
+void Report(const string& mode,
+            std::chrono::steady_clock::time_point start,
+            const vector<bool>& results) {
+  double elapsed_ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+  int success_cnt = 0;
+  for (bool result : results) {
+    success_cnt += result ? 1 : 0;
+  }
+  LOG(INFO) << "mode=" << mode
+            << ", pushes=" << results.size()
+            << ", success=" << success_cnt
+            << ", elapsed_ms=" << elapsed_ms
+            << ", pushes_per_second=" << results.size() * 1000.0 / elapsed_ms;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  base::AtExitManager at_exit;
+  google::ParseCommandLineFlags(&argc, &argv, false);
+  google::InitGoogleLogging(argv[0]);
+  CHECK(FLAGS_benchmark_push_cnt > 0);
+
+  std::thread server_thread(RunFakeLinkServer);
+  server_thread.detach();
+  std::this_thread::sleep_for(std::chrono::seconds(1));
+  string push_url =
+      StringPrintf("http://127.0.0.1:%d/push", FLAGS_fake_link_port);
+  string batch_push_url =
+      StringPrintf("http://127.0.0.1:%d/batch_push", FLAGS_fake_link_port);
+
+  // a content about the size of a hotel push
+  Json::Value content;
+  content["status"] = "success";
+  content["detail"] = string(1500, 'x');
+  Json::FastWriter writer;
+  vector<string> push_requests(FLAGS_benchmark_push_cnt);
+  for (int i = 0; i < FLAGS_benchmark_push_cnt; ++i) {
+    RenderPushRequest(kMessageGeneral, "benchmark",
+                      "benchmark_user_" + IntToString(i),
+                      "com.mobvoi.ticwear.home", writer.write(content),
+                      &push_requests[i]);
+  }
+
+  vector<bool> results;
+  auto start = std::chrono::steady_clock::now();
+  for (auto& push_request : push_requests) {
+    results.push_back(SendWithNewConnection(push_url, push_request));
+  }
+  Report("new_connection", start, results);
+
+  LinkClient keep_alive_client(push_url, "", 1, 1);
+  results.clear();
+  start = std::chrono::steady_clock::now();
+  for (auto& push_request : push_requests) {
+    results.push_back(keep_alive_client.Send(push_request));
+  }
+  Report("keep_alive", start, results);
+
+  LinkClient parallel_client(push_url, "", FLAGS_benchmark_connection_num, 1);
+  start = std::chrono::steady_clock::now();
+  parallel_client.SendBatch(push_requests, &results);
+  Report("keep_alive_parallel", start, results);
+
+  LinkClient batch_client(push_url, batch_push_url,
+                          FLAGS_benchmark_connection_num,
+                          FLAGS_benchmark_batch_size);
+  start = std::chrono::steady_clock::now();
+  batch_client.SendBatch(push_requests, &results);
+  Report("batch", start, results);
+  return 0;
+}
@@ -13,8 +13,12 @@
 
 DEFINE_bool(use_cluster_mode, false, "");
 DEFINE_bool(enable_update_push_pool, true, "");
+DEFINE_bool(enable_order_kafka_consumer, false, "");
 
 DEFINE_int32(pool_update_internal, 120, "push pool update schedule internal");
+DEFINE_int32(pool_reconcile_internal, 1800, "");
+DEFINE_int32(db_batch_query_size, 100, "");
+DEFINE_int32(kafka_producer_flush_timeout, 10000, "");
 DEFINE_int32(zookeeper_timeout, 3000, "(In MS)");
 DEFINE_int32(zookeeper_reconnect_attempt, 5, "");
 DEFINE_int32(zookeeper_check_interval, 5, "(In Seconds)");
@@ -22,6 +26,11 @@ DEFINE_int32(zookeeper_default_node_port, 9312, "");
 
 DEFINE_string(mysql_config,
     "config/recommendation/push_controller/mysql_server_test.conf", "");
+DEFINE_string(order_kafka_event_type, "test_message_receiver_parse", "");
+DEFINE_string(kafka_producer_config,
+    "config/push/push_controller/kafka_producer_test.conf", "");
+DEFINE_string(kafka_consumer_config,
+    "config/push/push_controller/kafka_consumer_test.conf", "");
 DEFINE_string(zookeeper_cluster_addr, "ali-hz-dev:2181", "");
 DEFINE_string(zookeeper_this_node_prefix,
     "/ns/intelligent_push/push_controller/replica_", "");
@@ -0,0 +1,97 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include <chrono>
+
+#include "base/at_exit.h"
+#include "base/log.h"
+#include "third_party/gflags/gflags.h"
+#include "third_party/jsoncpp/json.h"
+
+#include "push/push_controller/push_message_renderer.h"
+
+DEFINE_int32(benchmark_message_cnt, 100000, "messages to build per path");
+
+using namespace push_controller;
+
+namespace {
+
+// A hotel push of the size the timeline sends.
+void MakeContent(PushContent* content) {
+  content->status = "success";
+  content->id = "5c0bd6d4a3e1f2b7";
+  content->event_key = "today";
+  content->product_key = "hotel";
+  content->is_push = false;
+  content->sys.expire_time = "2017-06-01 23:59";
+  content->timeline_detail.title = "八方连锁酒店(北京中关村店)";
+  content->timeline_detail.ticker.push_back("06-01入住，14:00之后");
+  content->timeline_detail.des = "出门问问智能推送";
+  content->detail.icon = 5;
+  TextType title = {"八方连锁酒店(北京中关村店)", "#FFFFFF", 16, true, 0,
+    "", 4, 4};
+  TextType date = {"入住：06-01 14:00之后", "#FFFFFF", 15, true, 0, "", 4, 4};
+  TextType address = {"地址：北京市海淀区中关村大街1号", "#808080", 15,
+    true, 0, "", 8, 4};
+  TextType des = {"出门问问智能推送", "", 0, false, 0, "", 8, 8};
+  content->detail.title = title;
+  content->detail.des = des;
+  content->detail.text_list.push_back(title);
+  content->detail.text_list.push_back(date);
+  content->detail.text_list.push_back(address);
+  LinkType navigation = {"导航到酒店", "#FFFFFF", 0, "#5E83E1",
+    "北京市海淀区中关村大街1号", "116.31,39.98", kApplicationNavigation,
+    "Navigation"};
+  LinkType callup = {"联系酒店", "#FFFFFF", 0, "#5E83E1", "", "",
+    kApplicationCallup, "Callup"};
+  content->detail.link_list.push_back(navigation);
+  content->detail.link_list.push_back(callup);
+}
+
+double NanosPerMessage(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(
+      std::chrono::steady_clock::now() - start).count() /
+      FLAGS_benchmark_message_cnt;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  base::AtExitManager at_exit;
+  google::ParseCommandLineFlags(&argc, &argv, false);
+  google::InitGoogleLogging(argv[0]);
+  CHECK(FLAGS_benchmark_message_cnt > 0);
+  PushContent content;
+  MakeContent(&content);
+
+  string json_result;
+  size_t json_bytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < FLAGS_benchmark_message_cnt; ++i) {
+    Json::Value message;
+    BuildPushContentJson(content, &message);
+    Json::FastWriter writer;
+    json_result = writer.write(message);
+    json_bytes += json_result.size();
+  }
+  double json_ns = NanosPerMessage(start);
+
+  string buffer;
+  size_t render_bytes = 0;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < FLAGS_benchmark_message_cnt; ++i) {
+    RenderPushContent(content, &buffer);
+    render_bytes += buffer.size();
+  }
+  double render_ns = NanosPerMessage(start);
+
+  json_result.resize(json_result.size() - 1);
+  CHECK(json_result == buffer) << "rendered message differs";
+  LOG(INFO) << "messages=" << FLAGS_benchmark_message_cnt
+            << ", bytes=" << buffer.size()
+            << ", json_ns_per_message=" << json_ns
+            << ", render_ns_per_message=" << render_ns
+            << ", speedup=" << json_ns / render_ns
+            << ", checksum=" << json_bytes + render_bytes;
+  return 0;
+}
@@ -17,6 +17,10 @@ DEFINE_bool(use_cluster_mode, false, "");
 DEFINE_bool(use_hotel, true, "");
 DEFINE_bool(use_version_filter, true, "");
 
+DEFINE_int32(push_queue_capacity, 10000, "");
+DEFINE_int32(valid_push_time_internal, 1200, "");
+DEFINE_string(push_deadline_slack, "1:1200,2:1200,3:900,4:600,5:120,6:120,"
+              "7:180,8:120,9:600,10:300", "");
 DEFINE_string(mysql_config,
     "config/push/push_controller/mysql_server_test.conf", "");
 DEFINE_string(burypoint_kafka_log_server, "http://heartbeat-server/log/realtime", "");
@@ -25,14 +29,30 @@ DEFINE_string(burypoint_upload_push_log_event_type, "test_push_controller_push_s
 DEFINE_string(burypoint_upload_fail_log_event_type, "test_push_controller_push_fail", "");
 DEFINE_string(flight_info_service,
     "http://flight-info-service/flight/query_flightinfo", "");
+DEFINE_int32(flight_status_cache_seconds, 600,
+    "seconds a flight status is cached by the push controller");
+DEFINE_int32(flight_status_near_cache_seconds, 60,
+    "seconds a flight status is cached close to the departure");
+DEFINE_int32(flight_status_near_departure_seconds, 3 * 3600,
+    "how close to the takeoff the shorter cache time is used");
 DEFINE_string(train_info_service,
     "http://train-info-service/train/query_timetable",
     "train info service addr");
 DEFINE_string(link_server,
     "http://link-server/api/push_message/to_user_device", "link server addr");
+DEFINE_string(link_server_batch, "",
+    "batch push addr of link server, pushes go one by one if empty");
+DEFINE_int32(link_connection_num, 4, "keep-alive connections to link server");
+DEFINE_int32(link_batch_size, 100, "max recipients of a batch push");
 DEFINE_string(weather_service,
     "https://m.mobvoi.com/search/pc", "weather server addr");
+DEFINE_int32(weather_cache_update_seconds, 3600, "");
+DEFINE_int32(weather_warmup_hour, 7, "");
+DEFINE_int32(weather_warmup_lead_seconds, 600, "");
 DEFINE_string(location_service, "http://location-service/geocoder?address=%s", "");
+DEFINE_string(hotel_geocode_snapshot, "", "");
+DEFINE_int32(hotel_geocode_negative_ttl_seconds, 3600, "");
+DEFINE_int32(hotel_geocode_snapshot_interval_seconds, 300, "");
 DEFINE_string(hotel_version_equal, "tic_4.9.0", "");
 DEFINE_string(hotel_version_greater, "tic_4.9.0", "");
 
@@ -383,7 +403,7 @@ int main(int argc, char** argv) {
   HotelPushProcessor hotel_push_processor;
   HotelPushTest hotel_push_test;
   for (int i = 0; i < 1; ++i) {
-    Json::Value message;
+    string message;
     TestDataInfo& data = hotel_push_test.test_data_info_vector_[i];
     bool ret = hotel_push_processor.BuildPushMessage(data.user_order_info,
                                                      data.push_event_info,
@@ -0,0 +1,105 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/serving/flight/flight_change.h"
+
+#include "third_party/jsoncpp/json.h"
+
+namespace {
+
+static const char kTrue[] = "true";
+
+// An empty value means upstream does not know it yet, not a change.
+bool IsChanged(const string& old_value, const string& new_value) {
+  return !old_value.empty() && !new_value.empty() && old_value != new_value;
+}
+
+}  // namespace
+
+namespace flight {
+
+bool DiffFlightResponse(const vector<string>& old_values,
+                        const FlightResponse& response,
+                        FlightChange* change) {
+  // the flight is seen for the first time if is_delay is not stored yet
+  if (old_values.size() != 4 || old_values[0].empty()) {
+    return false;
+  }
+  change->changes.clear();
+  if (old_values[0] != kTrue && response.is_delay() == kTrue) {
+    change->changes.push_back(kChangeDelay);
+  }
+  if (IsChanged(old_values[1], response.actual_gate())) {
+    change->changes.push_back(kChangeGate);
+  }
+  if (IsChanged(old_values[2], response.estimated_takeoff())) {
+    change->changes.push_back(kChangeTakeoff);
+  }
+  if (IsChanged(old_values[3], response.estimated_arrive())) {
+    change->changes.push_back(kChangeArrive);
+  }
+  if (change->changes.empty()) {
+    return false;
+  }
+  change->flight_no = response.flight_no();
+  change->depart_date = response.depart_date();
+  change->is_delay = response.is_delay();
+  change->actual_gate = response.actual_gate();
+  change->estimated_takeoff = response.estimated_takeoff();
+  change->estimated_arrive = response.estimated_arrive();
+  change->timestamp = time(NULL);
+  return true;
+}
+
+string FlightChangeToString(const FlightChange& change) {
+  Json::Value root;
+  root["flight_no"] = change.flight_no;
+  root["depart_date"] = change.depart_date;
+  Json::Value changes(Json::arrayValue);
+  for (auto& kind : change.changes) {
+    changes.append(kind);
+  }
+  root["changes"] = changes;
+  root["is_delay"] = change.is_delay;
+  root["actual_gate"] = change.actual_gate;
+  root["estimated_takeoff"] = change.estimated_takeoff;
+  root["estimated_arrive"] = change.estimated_arrive;
+  root["timestamp"] = static_cast<Json::Int64>(change.timestamp);
+  Json::FastWriter writer;
+  return writer.write(root);
+}
+
+bool ParseFlightChange(const string& message, FlightChange* change) {
+  Json::Value root;
+  Json::Reader reader;
+  if (!reader.parse(message, root) || !root.isObject() ||
+      !root["changes"].isArray()) {
+    return false;
+  }
+  change->flight_no = root["flight_no"].asString();
+  change->depart_date = root["depart_date"].asString();
+  if (change->flight_no.empty() || change->depart_date.empty()) {
+    return false;
+  }
+  change->changes.clear();
+  for (auto& kind : root["changes"]) {
+    change->changes.push_back(kind.asString());
+  }
+  change->is_delay = root["is_delay"].asString();
+  change->actual_gate = root["actual_gate"].asString();
+  change->estimated_takeoff = root["estimated_takeoff"].asString();
+  change->estimated_arrive = root["estimated_arrive"].asString();
+  change->timestamp = static_cast<time_t>(root["timestamp"].asInt64());
+  return !change->changes.empty();
+}
+
+void ApplyFlightChange(const FlightChange& change, FlightResponse* response) {
+  response->set_is_delay(change.is_delay);
+  response->set_actual_gate(change.actual_gate);
+  response->set_estimated_takeoff(change.estimated_takeoff);
+  response->set_estimated_arrive(change.estimated_arrive);
+  response->set_gate_is_change(
+      response->plan_gate() != response->actual_gate() ? kTrue : "false");
+}
+
+}  // namespace flight
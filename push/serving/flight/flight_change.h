@@ -0,0 +1,51 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#ifndef PUSH_SERVING_FLIGHT_FLIGHT_CHANGE_H_
+#define PUSH_SERVING_FLIGHT_FLIGHT_CHANGE_H_
+
+#include <time.h>
+
+#include "base/basictypes.h"
+#include "base/compat.h"
+
+#include "push/proto/flight_meta.pb.h"
+
+namespace flight {
+
+// Kinds of change pushed to the passengers at once.
+const char kChangeDelay[] = "delay";
+const char kChangeGate[] = "gate";
+const char kChangeTakeoff[] = "takeoff";
+const char kChangeArrive[] = "arrive";
+
+// Change event published by the flight info server when it writes a new
+// status of a flight, the fields carry the new values.
+struct FlightChange {
+  string flight_no;
+  string depart_date;
+  vector<string> changes;
+  string is_delay;
+  string actual_gate;
+  string estimated_takeoff;
+  string estimated_arrive;
+  time_t timestamp;
+  FlightChange() : timestamp(0) {}
+};
+
+// Compares the stored is_delay, actual_gate, estimated_takeoff and
+// estimated_arrive, in this order in old_values, with response. Returns
+// false if nothing changed or the flight is seen for the first time.
+bool DiffFlightResponse(const vector<string>& old_values,
+                        const FlightResponse& response,
+                        FlightChange* change);
+
+string FlightChangeToString(const FlightChange& change);
+bool ParseFlightChange(const string& message, FlightChange* change);
+
+// Overwrites the tracked fields of response with the values of change.
+void ApplyFlightChange(const FlightChange& change, FlightResponse* response);
+
+}  // namespace flight
+
+#endif  // PUSH_SERVING_FLIGHT_FLIGHT_CHANGE_H_
@@ -0,0 +1,93 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/serving/flight/flight_change.h"
+#include "third_party/gtest/gtest.h"
+
+using namespace flight;
+
+namespace {
+
+FlightResponse MakeResponse() {
+  FlightResponse response;
+  response.set_flight_no("CA1234");
+  response.set_depart_date("2017-06-01");
+  response.set_is_delay("false");
+  response.set_plan_gate("12");
+  response.set_actual_gate("12");
+  response.set_estimated_takeoff("2017-06-01 08:00");
+  response.set_estimated_arrive("2017-06-01 10:30");
+  return response;
+}
+
+vector<string> OldValues(const FlightResponse& response) {
+  vector<string> old_values;
+  old_values.push_back(response.is_delay());
+  old_values.push_back(response.actual_gate());
+  old_values.push_back(response.estimated_takeoff());
+  old_values.push_back(response.estimated_arrive());
+  return old_values;
+}
+
+}  // namespace
+
+TEST(FlightChangeTest, NoChange) {
+  FlightResponse response = MakeResponse();
+  FlightChange change;
+  EXPECT_FALSE(DiffFlightResponse(OldValues(response), response, &change));
+}
+
+TEST(FlightChangeTest, FirstSeen) {
+  FlightResponse response = MakeResponse();
+  FlightChange change;
+  EXPECT_FALSE(DiffFlightResponse(vector<string>(4), response, &change));
+  EXPECT_FALSE(DiffFlightResponse(vector<string>(), response, &change));
+}
+
+TEST(FlightChangeTest, DelayAndGate) {
+  FlightResponse response = MakeResponse();
+  vector<string> old_values = OldValues(response);
+  response.set_is_delay("true");
+  response.set_actual_gate("15");
+  response.set_estimated_arrive("");
+  FlightChange change;
+  ASSERT_TRUE(DiffFlightResponse(old_values, response, &change));
+  ASSERT_EQ(2u, change.changes.size());
+  EXPECT_EQ(kChangeDelay, change.changes[0]);
+  EXPECT_EQ(kChangeGate, change.changes[1]);
+  EXPECT_EQ("CA1234", change.flight_no);
+  EXPECT_EQ("15", change.actual_gate);
+}
+
+TEST(FlightChangeTest, StillDelayed) {
+  FlightResponse response = MakeResponse();
+  response.set_is_delay("true");
+  vector<string> old_values = OldValues(response);
+  response.set_estimated_takeoff("2017-06-01 09:00");
+  FlightChange change;
+  ASSERT_TRUE(DiffFlightResponse(old_values, response, &change));
+  ASSERT_EQ(1u, change.changes.size());
+  EXPECT_EQ(kChangeTakeoff, change.changes[0]);
+}
+
+TEST(FlightChangeTest, RoundTrip) {
+  FlightResponse response = MakeResponse();
+  vector<string> old_values = OldValues(response);
+  response.set_actual_gate("15");
+  FlightChange change;
+  ASSERT_TRUE(DiffFlightResponse(old_values, response, &change));
+  FlightChange parsed;
+  ASSERT_TRUE(ParseFlightChange(FlightChangeToString(change), &parsed));
+  EXPECT_EQ(change.flight_no, parsed.flight_no);
+  EXPECT_EQ(change.depart_date, parsed.depart_date);
+  EXPECT_EQ(change.changes, parsed.changes);
+  EXPECT_EQ(change.actual_gate, parsed.actual_gate);
+  EXPECT_EQ(change.timestamp, parsed.timestamp);
+  EXPECT_FALSE(ParseFlightChange("{}", &parsed));
+  EXPECT_FALSE(ParseFlightChange("not json", &parsed));
+
+  FlightResponse cached = MakeResponse();
+  ApplyFlightChange(parsed, &cached);
+  EXPECT_EQ("15", cached.actual_gate());
+  EXPECT_EQ("true", cached.gate_is_change());
+}
@@ -30,6 +30,14 @@ FlightDataFetcher::~FlightDataFetcher() {}
 
 bool FlightDataFetcher::FetchFlightData(const FlightRequest& request, 
                                         FlightResponse* response) {
+  bool is_not_found = false;
+  return FetchFlightData(request, response, &is_not_found);
+}
+
+bool FlightDataFetcher::FetchFlightData(const FlightRequest& request,
+                                        FlightResponse* response,
+                                        bool* is_not_found) {
+  *is_not_found = false;
   LOG(INFO) << "Request ==>" << "\n" << request.Utf8DebugString();
   const string& flight_no = request.flight_no();
   string depart_date = request.depart_date();
@@ -38,7 +46,7 @@ bool FlightDataFetcher::FetchFlightData(const FlightRequest& request,
     LOG(ERROR) << "Call GetRepsonseBody failed";
     return false;
   }
-  if (!BuildResponse(response_body, depart_date, response)) {
+  if (!BuildResponse(response_body, depart_date, response, is_not_found)) {
     LOG(WARNING) << "Call BuildResponse failed";
     return false;
   }
@@ -69,7 +77,8 @@ bool FlightDataFetcher::GetRepsonseBody(const string& flight_no,
 
 bool FlightDataFetcher::BuildResponse(const string& response_body,
                                       const string& depart_date, 
-                                      FlightResponse* response) {
+                                      FlightResponse* response,
+                                      bool* is_not_found) {
   Json::Value root;
   string datetime_format = "%Y-%m-%d %H:%M";
   try {
@@ -149,6 +158,7 @@ bool FlightDataFetcher::BuildResponse(const string& response_body,
     return true;
   } else {
     LOG(WARNING) << "reponse data array empty";
+    *is_not_found = true;
     return false;
   }
 }
@@ -18,6 +18,10 @@ class FlightDataFetcher {
   ~FlightDataFetcher();
   bool FetchFlightData(const FlightRequest& request, 
                        FlightResponse* response);
+  // is_not_found is set when upstream answers without any flight data
+  bool FetchFlightData(const FlightRequest& request,
+                       FlightResponse* response,
+                       bool* is_not_found);
  
  private:
   bool GetRepsonseBody(const string& flight_no, 
@@ -25,7 +29,8 @@ class FlightDataFetcher {
                        string* response_body);
   bool BuildResponse(const string& response_body,
                      const string& depart_date,
-                     FlightResponse* response);
+                     FlightResponse* response,
+                     bool* is_not_found);
 
   DISALLOW_COPY_AND_ASSIGN(FlightDataFetcher);
 };
@@ -5,6 +5,7 @@
 
 #include "base/file/proto_util.h"
 #include "base/log.h"
+#include "base/singleton.h"
 #include "base/time.h"
 #include "base/string_util.h"
 #include "third_party/gflags/gflags.h"
@@ -16,10 +17,35 @@
 #include "third_party/mysql_client_cpp/include/cppconn/statement.h"
 
 DECLARE_int32(flight_update_duration);
+DECLARE_int32(flight_update_thread_num);
 DECLARE_string(mysql_config);
 
 namespace flight {
 
+FlightRefreshWorker::FlightRefreshWorker(
+    FlightRefreshScheduler* scheduler,
+    FlightDbInterface* flight_db_interface)
+  : Thread(true),
+    scheduler_(scheduler),
+    flight_db_interface_(flight_db_interface) {}
+
+FlightRefreshWorker::~FlightRefreshWorker() {}
+
+void FlightRefreshWorker::Run() {
+  FlightRefreshTask task;
+  while (scheduler_->WaitNext(&task)) {
+    scheduler_->AcquireFetchQuota();
+    FlightResponse response;
+    bool success = flight_db_interface_->UpdateFlightData(
+        task.flight_no, task.depart_date, &response);
+    if (!success) {
+      LOG(WARNING) << "refresh flight data failed, key:" << task.key();
+    }
+    scheduler_->Complete(&task, success, response);
+  }
+  LOG(INFO) << "shut down FlightRefreshWorker, id:" << this->GetThreadId();
+}
+
 FlightDataUpdater::FlightDataUpdater() 
   : schedule_internal_(1800) { // default duration: 30min
   Init();
@@ -31,6 +57,7 @@ FlightDataUpdater::~FlightDataUpdater() {}
 
 void FlightDataUpdater::Init() {
   flight_db_interface_.reset(new FlightDbInterface);
+  scheduler_ = Singleton<FlightRefreshScheduler>::get();
   mysql_server_.reset(new MysqlServer());
   CHECK(file::ReadProtoFromTextFile(FLAGS_mysql_config, mysql_server_.get()));
   LOG(INFO) << "Init mysql config from file:" << FLAGS_mysql_config;
@@ -42,15 +69,27 @@ void FlightDataUpdater::Init() {
 void FlightDataUpdater::Run() {
   LOG(INFO) << "start thread FlightDataUpdater";
   mobvoi::Sleep(5);
+  for (int i = 0; i < FLAGS_flight_update_thread_num; ++i) {
+    workers_.emplace_back(
+        new FlightRefreshWorker(scheduler_, flight_db_interface_.get()));
+    workers_.back()->Start();
+  }
   vector<string> flight_no_vector;
   while (true) {
     flight_no_vector.clear();
-    if (QueryAllFlightNo(&flight_no_vector) &&
-        UpdateAllFlightInfo(flight_no_vector)) {
-      LOG(INFO) << "update flight data successfully";
+    if (QueryAllFlightNo(&flight_no_vector)) {
+      // the next day of every flight is tracked after midnight
+      for (auto& flight_no : flight_no_vector) {
+        scheduler_->Track(flight_no);
+      }
+      scheduler_->Retain(flight_no_vector);
+      LOG(INFO) << "track flight no successfully";
     } else {
-      LOG(INFO) << "update flight data failed";
+      LOG(INFO) << "track flight no failed";
     }
+    Json::Value stats;
+    scheduler_->GetStats(&stats);
+    LOG(INFO) << "flight refresh stats:" << stats.toStyledString();
     mobvoi::Sleep(schedule_internal_);
   }
 }
@@ -87,22 +126,4 @@ bool FlightDataUpdater::QueryAllFlightNo(vector<string>* flight_no_vector) {
   }
 }
 
-bool FlightDataUpdater::UpdateAllFlightInfo(
-    const vector<string>& flight_no_vector) {
-  if (flight_no_vector.empty()) {
-    return true;
-  }
-  int success_cnt = 0;
-  for (auto& flight_no : flight_no_vector) {
-    if (!flight_db_interface_->UpdateFlightData(flight_no)) {
-      LOG(WARNING) << "update flight data failed, no:" << flight_no;
-      continue;
-    }
-    ++success_cnt;
-  }
-  LOG(INFO) << "all flight count:" << flight_no_vector.size()
-            << ",update success count:" << success_cnt;
-  return true;
-}
-
 }  // namespace flight 
@@ -12,10 +12,26 @@
 #include "proto/mysql_config.pb.h"
 
 #include "push/serving/flight/flight_db_interface.h"
+#include "push/serving/flight/flight_refresh_scheduler.h"
 #include "push/proto/flight_meta.pb.h"
 
 namespace flight {
 
+class FlightRefreshWorker : public mobvoi::Thread {
+ public:
+  FlightRefreshWorker(FlightRefreshScheduler* scheduler,
+                      FlightDbInterface* flight_db_interface);
+  virtual ~FlightRefreshWorker();
+  virtual void Run();
+
+ private:
+  FlightRefreshScheduler* scheduler_;
+  FlightDbInterface* flight_db_interface_;
+  DISALLOW_COPY_AND_ASSIGN(FlightRefreshWorker);
+};
+
+// Keeps the refresh scheduler in sync with the flight_no table, the
+// fetches are done by a bounded pool of FlightRefreshWorker.
 class FlightDataUpdater : public mobvoi::Thread {
  public:
   FlightDataUpdater();
@@ -25,11 +41,12 @@ class FlightDataUpdater : public mobvoi::Thread {
  private:
   void Init();
   bool QueryAllFlightNo(vector<string>* flight_no_vector);
-  bool UpdateAllFlightInfo(const vector<string>& flight_no_vector);
-  
+
   time_t schedule_internal_;
   std::unique_ptr<MysqlServer> mysql_server_;
   std::unique_ptr<FlightDbInterface> flight_db_interface_;
+  FlightRefreshScheduler* scheduler_;
+  vector<std::unique_ptr<FlightRefreshWorker>> workers_;
   DISALLOW_COPY_AND_ASSIGN(FlightDataUpdater);
 };
 
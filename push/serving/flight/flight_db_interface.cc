@@ -7,34 +7,60 @@
 
 #include "base/compat.h"
 #include "base/log.h"
+#include "base/singleton.h"
 #include "base/file/proto_util.h"
+#include "base/string_util.h"
 #include "third_party/gflags/gflags.h"
 
-#include "push/util/time_util.h"
+#include "push/serving/flight/flight_change.h"
 
 DECLARE_int32(redis_expire_time);
+DECLARE_string(flight_change_topic);
 DECLARE_string(mysql_config);
 
+namespace {
+
+static const int kMaxRetryCnt = 3;
+
+// KEYS[1]: flight key, ARGV[1]: expire seconds, ARGV[2]: plan gate,
+// ARGV[3...]: field value pairs of the flight data.
+// Returns the tracked fields of flight_change.h as they were before.
+// 第一次插入plan_gate作为计划登机口，以后不再更新
+static const char kUpdateFlightScript[] =
+    "local old = redis.call('HMGET', KEYS[1], 'is_delay', 'actual_gate', "
+    "  'estimated_takeoff', 'estimated_arrive') "
+    "local gate = redis.call('HGET', KEYS[1], 'plan_gate') "
+    "if (not gate) or gate == '' then "
+    "  redis.call('HSET', KEYS[1], 'plan_gate', ARGV[2]) "
+    "end "
+    "redis.call('HMSET', KEYS[1], unpack(ARGV, 3)) "
+    "redis.call('EXPIRE', KEYS[1], ARGV[1]) "
+    "return old";
+
+}  // namespace
+
 namespace flight {
 
 FlightDbInterface::FlightDbInterface() {
   LOG(INFO) << "Construct FlightDbInterface";
   flight_data_fetcher_.reset(new FlightDataFetcher);
+  redis_pool_ = Singleton<recommendation::RedisConnectionPool>::get();
 }
 
 FlightDbInterface::~FlightDbInterface() {}
 
 bool FlightDbInterface::GetFlightInfo(FlightRequest* request,
                                       FlightResponse* response) {
-  if (!redis_client_.InitConnection()) {
-    LOG(ERROR) << "redis init connection failed";
+  recommendation::RedisLease redis_lease = redis_pool_->Borrow();
+  if (!redis_lease.ok()) {
+    LOG(ERROR) << "redis borrow connection failed";
     return false;
   }
   const string& flight_no = request->flight_no();
   const string& depart_date = request->depart_date();
   string key = flight_no + "&" + depart_date;
   map<string, string> result_map;
-  if (redis_client_.Hgetall(key, &result_map)) {
+  if (redis_lease->Hgetall(key, &result_map)) {
     response->set_flight_no(result_map["flight_no"]);  
     response->set_airport_from(result_map["airport_from"]);  
     response->set_airport_to(result_map["airport_to"]);  
@@ -62,161 +88,177 @@ bool FlightDbInterface::GetFlightInfo(FlightRequest* request,
     } else {
       response->set_gate_is_change("false");
     }
-    redis_client_.FreeConnection();
     return true;
   } else {
     LOG(ERROR) << "Hgetall failed, key:" << key;
-    redis_client_.FreeConnection();
     return false;
   }
 }
 
-bool FlightDbInterface::UpdateFlightData(const string& flight_no) {
-  bool success = true;
+bool FlightDbInterface::UpdateFlightData(const string& flight_no,
+                                         const string& depart_date,
+                                         FlightResponse* response) {
+  bool is_not_found = false;
+  return UpdateFlightData(flight_no, depart_date, response, &is_not_found);
+}
+
+bool FlightDbInterface::UpdateFlightData(const string& flight_no,
+                                         const string& depart_date,
+                                         FlightResponse* response,
+                                         bool* is_not_found) {
   FlightRequest request;
-  FlightResponse response;
-  request.Clear();
-  response.Clear();
-  BuildFlightRequestForToday(flight_no, &request);
-  if (!FetchAndUpdateFlight(request, &response)) {
-    success = false;
+  request.set_flight_no(flight_no);
+  request.set_depart_date(depart_date);
+  if (!flight_data_fetcher_->FetchFlightData(request, response,
+                                             is_not_found)) {
+    LOG(WARNING) << "fetch failed, flight_no:" << flight_no
+                 << ", not_found:" << *is_not_found;
+    return false;
   }
-  request.Clear();
-  response.Clear();
-  BuildFlightRequestForTomorrow(flight_no, &request);
-  if (!FetchAndUpdateFlight(request, &response)) {
-    success = false;
+  vector<FlightResponse> response_vec;
+  response_vec.push_back(*response);
+  if (!UpdateFlightDataToRedis(response_vec)) {
+    LOG(WARNING) << "update to redis failed, flight_no:" << flight_no
+                 << ", depart_date:" << depart_date;
+    return false;
   }
-  return success;
+  return true;
 }
 
-bool FlightDbInterface::UpdateFlightDataToRedis(FlightResponse* response) {
-  if (!redis_client_.InitConnection()) {
-    LOG(ERROR) << "redis init connection failed";
+bool FlightDbInterface::UpdateFlightDataToRedis(
+    const vector<FlightResponse>& response_vec) {
+  for (int retry_cnt = 0; retry_cnt < kMaxRetryCnt; ++retry_cnt) {
+    // broken connections are dropped by the pool when the lease ends
+    recommendation::RedisLease redis_lease = redis_pool_->Borrow();
+    if (!redis_lease.ok()) {
+      LOG(ERROR) << "redis borrow connection failed";
+      continue;
+    }
+    if (PipelineUpdateToRedis(redis_lease.get(), response_vec)) {
+      return true;
+    }
+    // script cache may be flushed by a server restart, reload it next time
+    redis_lease->ClearScriptCache();
+  }
+  LOG(ERROR) << "redis update failed after retry, count:"
+             << response_vec.size();
+  return false;
+}
+
+bool FlightDbInterface::PipelineUpdateToRedis(
+    recommendation::RedisBase* redis_client,
+    const vector<FlightResponse>& response_vec) {
+  string sha;
+  if (!redis_client->ScriptLoad(kUpdateFlightScript, &sha)) {
+    LOG(ERROR) << "load update flight script failed";
     return false;
   }
-  LOG(INFO) << "Redis connect success";
-  const string& flight_no = response->flight_no();
-  const string& depart_date = response->depart_date();
-  string key = flight_no + "&" + depart_date;
-  map<string, string> flight_data_map;
-  SetFlightDataMap(response, &flight_data_map);
-  SetPlanGateToMap(key, response, &flight_data_map);
-  int retry_cnt = 3;
-  while (retry_cnt-- > 0) {
-    if (redis_client_.Hmset(key, flight_data_map)) {
-      break;
+  vector<redisReply*> replies;
+  for (auto& response : response_vec) {
+    vector<string> args;
+    BuildUpdateScriptArgs(sha, response, &args);
+    if (!redis_client->AppendCommandArgv(args)) {
+      // drain what has been appended so the pipeline stays in sync
+      redis_client->GetPipelineReplies(&replies);
+      recommendation::RedisBase::FreeReplies(&replies);
+      return false;
     }
   }
-  if (retry_cnt == 0) {
-    LOG(ERROR) << "redis mset failed, key:" << key;
-    redis_client_.FreeConnection();
+  if (!redis_client->GetPipelineReplies(&replies)) {
+    LOG(ERROR) << "redis pipeline update failed";
     return false;
   }
-  LOG(INFO) << "Redis hmset success, key:" << key;
-  retry_cnt = 3;
-  while (retry_cnt-- > 0) {
-    if (redis_client_.Expire(key, FLAGS_redis_expire_time)) {
-      break;
+  bool success = true;
+  vector<string> change_messages;
+  for (size_t i = 0; i < replies.size(); ++i) {
+    const FlightResponse& response = response_vec[i];
+    string key = response.flight_no() + "&" + response.depart_date();
+    if (replies[i]->type == REDIS_REPLY_ERROR) {
+      LOG(ERROR) << "redis update script failed, key:" << key
+                 << ", err:" << replies[i]->str;
+      success = false;
+      continue;
+    }
+    LOG(INFO) << "Redis update success, key:" << key;
+    FlightChange change;
+    if (ParseOldValues(replies[i], response, &change)) {
+      change_messages.push_back(FlightChangeToString(change));
+      LOG(INFO) << "Flight changed, key:" << key << ", changes:"
+                << JoinString(change.changes, ',');
     }
   }
-  if (retry_cnt == 0) {
-    LOG(ERROR) << "redis set expire failed, key:" << key;
-    redis_client_.FreeConnection();
-    return false;
+  recommendation::RedisBase::FreeReplies(&replies);
+  // the script saw the old and the new values at once, so only one
+  // writer publishes a change
+  if (!FLAGS_flight_change_topic.empty()) {
+    for (auto& message : change_messages) {
+      if (!redis_client->Publish(FLAGS_flight_change_topic, message)) {
+        LOG(ERROR) << "publish flight change failed, message:" << message;
+      }
+    }
   }
-  LOG(INFO) << "Redis set expire success, key:" << key;
-  redis_client_.FreeConnection();
-  return true;
-}
-
-void FlightDbInterface::BuildFlightRequestForToday(
-    const string& flight_no,
-    FlightRequest* flight_request) {
-  string date;
-  recommendation::MakeDate(0, &date);
-  flight_request->set_flight_no(flight_no);
-  flight_request->set_depart_date(date);
-}
-
-void FlightDbInterface::BuildFlightRequestForTomorrow(
-    const string& flight_no,
-    FlightRequest* flight_request) {
-  string date;
-  recommendation::MakeDate(1, &date);
-  flight_request->set_flight_no(flight_no);
-  flight_request->set_depart_date(date);
+  return success;
 }
 
-bool FlightDbInterface::FetchAndUpdateFlight(const FlightRequest& request,
-                                             FlightResponse* response) {
-  if (!flight_data_fetcher_->FetchFlightData(request, response)) {
-    LOG(WARNING) << "fetch failed, flight_no:" << request.flight_no();
+bool FlightDbInterface::ParseOldValues(redisReply* reply,
+                                       const FlightResponse& response,
+                                       FlightChange* change) {
+  if (reply->type != REDIS_REPLY_ARRAY) {
     return false;
   }
-  LOG(INFO) << "fetch success, flight_no:" << request.flight_no();
-  if (!UpdateFlightDataToRedis(response)) {
-    LOG(WARNING) << "update to redis failed, flight_no:" 
-                 << request.flight_no();
-    return false;
+  vector<string> old_values;
+  for (size_t i = 0; i < reply->elements; ++i) {
+    redisReply* element = reply->element[i];
+    if (element->type == REDIS_REPLY_STRING) {
+      old_values.push_back(string(element->str, element->len));
+    } else {
+      old_values.push_back("");
+    }
   }
-  LOG(INFO) << "update to redis success, flight_no:" 
-            << request.flight_no();
-  return true;
+  return DiffFlightResponse(old_values, response, change);
 }
 
 void FlightDbInterface::SetFlightDataMap(
-    FlightResponse* response,
+    const FlightResponse& response,
     map<string, string>* flight_data_map_pointer) {
   map<string, string> &flight_data_map = *flight_data_map_pointer;
-  flight_data_map["flight_no"] = response->flight_no();
-  flight_data_map["airport_from"] = response->airport_from();
-  flight_data_map["airport_to"] = response->airport_to();
-  flight_data_map["city_from"] = response->city_from();
-  flight_data_map["city_to"] = response->city_to();
-  flight_data_map["terminal_from"] = response->terminal_from();
-  flight_data_map["terminal_to"] = response->terminal_to();
-  flight_data_map["plan_takeoff"] = response->plan_takeoff();
-  flight_data_map["plan_arrive"] = response->plan_arrive();
-  flight_data_map["estimated_takeoff"] = response->estimated_takeoff();
-  flight_data_map["estimated_arrive"] = response->estimated_arrive();
-  flight_data_map["actual_takeoff"] = response->actual_takeoff();
-  flight_data_map["actual_arrive"] = response->actual_arrive();
-  flight_data_map["checkin_counter"] = response->checkin_counter();
-  flight_data_map["checkin_stoptime"] = response->checkin_stoptime();
-  flight_data_map["actual_gate"] = response->actual_gate();
-  flight_data_map["is_delay"] = response->is_delay();
-  flight_data_map["carousel"] = response->carousel();
-  flight_data_map["depart_date"] = response->depart_date();
+  flight_data_map["flight_no"] = response.flight_no();
+  flight_data_map["airport_from"] = response.airport_from();
+  flight_data_map["airport_to"] = response.airport_to();
+  flight_data_map["city_from"] = response.city_from();
+  flight_data_map["city_to"] = response.city_to();
+  flight_data_map["terminal_from"] = response.terminal_from();
+  flight_data_map["terminal_to"] = response.terminal_to();
+  flight_data_map["plan_takeoff"] = response.plan_takeoff();
+  flight_data_map["plan_arrive"] = response.plan_arrive();
+  flight_data_map["estimated_takeoff"] = response.estimated_takeoff();
+  flight_data_map["estimated_arrive"] = response.estimated_arrive();
+  flight_data_map["actual_takeoff"] = response.actual_takeoff();
+  flight_data_map["actual_arrive"] = response.actual_arrive();
+  flight_data_map["checkin_counter"] = response.checkin_counter();
+  flight_data_map["checkin_stoptime"] = response.checkin_stoptime();
+  flight_data_map["actual_gate"] = response.actual_gate();
+  flight_data_map["is_delay"] = response.is_delay();
+  flight_data_map["carousel"] = response.carousel();
+  flight_data_map["depart_date"] = response.depart_date();
 }
 
-void FlightDbInterface::SetPlanGateToMap(
-    const string& key,
-    FlightResponse* response,
-    map<string, string>* flight_data_map_pointer) {
-  string field = "plan_gate";
-  bool is_existed = true;
-  if (!redis_client_.Exists(key)) {
-    is_existed = false;
-  } else {
-    if (!redis_client_.Hexists(key, field)) {
-      is_existed = false;
-    } else {
-      string value;
-      if (redis_client_.Hget(key, field, &value)) {
-        if (value.empty()) {
-          is_existed = false;
-        }
-      }
-    }
-  }
-  // 第一次插入plan_gate作为计划登机口，以后不再更新
-  if (!is_existed) {
-    map<string, string> &flight_data_map = *flight_data_map_pointer;
-    flight_data_map["plan_gate"] = response->plan_gate();
-    LOG(INFO) << "plan to insert gate, key:" << key << ",plan_gate:" 
-              << flight_data_map["plan_gate"];
+void FlightDbInterface::BuildUpdateScriptArgs(const string& sha,
+                                              const FlightResponse& response,
+                                              vector<string>* args) {
+  string key = response.flight_no() + "&" + response.depart_date();
+  args->push_back("EVALSHA");
+  args->push_back(sha);
+  args->push_back("1");
+  args->push_back(key);
+  args->push_back(IntToString(FLAGS_redis_expire_time));
+  args->push_back(response.plan_gate());
+  map<string, string> flight_data_map;
+  SetFlightDataMap(response, &flight_data_map);
+  for (auto& field_value : flight_data_map) {
+    args->push_back(field_value.first);
+    args->push_back(field_value.second);
   }
 }
 
-}  // namespace flight 
+}  // namespace flight
@@ -7,6 +7,7 @@
 #include "base/basictypes.h"
 #include "base/compat.h"
 
+#include "push/serving/flight/flight_change.h"
 #include "push/serving/flight/flight_data_fetcher.h"
 #include "push/proto/flight_meta.pb.h"
 #include "push/util/redis_util.h"
@@ -19,24 +20,29 @@ class FlightDbInterface {
   ~FlightDbInterface();
   bool GetFlightInfo(FlightRequest* request,
                      FlightResponse* response);
-  bool UpdateFlightData(const string& flight_no);
+  // Refreshes one depart date, the fetched data is returned in response.
+  bool UpdateFlightData(const string& flight_no, const string& depart_date,
+                        FlightResponse* response);
+  bool UpdateFlightData(const string& flight_no, const string& depart_date,
+                        FlightResponse* response, bool* is_not_found);
 
  private:
-  bool UpdateFlightDataToRedis(FlightResponse* response);
-  void BuildFlightRequestForToday(const string& flight_no,
-                                  FlightRequest* flight_request);
-  void BuildFlightRequestForTomorrow(const string& flight_no,
-                                     FlightRequest* flight_request);
-  bool FetchAndUpdateFlight(const FlightRequest& request,
-                            FlightResponse* response);
-  void SetFlightDataMap(FlightResponse* response,
-                        map<string, string>* flight_data_map_pointer);
-  void SetPlanGateToMap(const string& key,
-                        FlightResponse* response,
+  bool UpdateFlightDataToRedis(const vector<FlightResponse>& response_vec);
+  // Also publishes the changes of the tracked fields to
+  // --flight_change_topic.
+  bool PipelineUpdateToRedis(recommendation::RedisBase* redis_client,
+                             const vector<FlightResponse>& response_vec);
+  // Compares the values returned by the update script with response.
+  bool ParseOldValues(redisReply* reply, const FlightResponse& response,
+                      FlightChange* change);
+  void SetFlightDataMap(const FlightResponse& response,
                         map<string, string>* flight_data_map_pointer);
+  void BuildUpdateScriptArgs(const string& sha,
+                             const FlightResponse& response,
+                             vector<string>* args);
 
   std::unique_ptr<FlightDataFetcher> flight_data_fetcher_;
-  recommendation::RedisClient redis_client_;
+  recommendation::RedisConnectionPool* redis_pool_;
   DISALLOW_COPY_AND_ASSIGN(FlightDbInterface);
 };
 
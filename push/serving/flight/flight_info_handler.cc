@@ -5,6 +5,7 @@
 
 #include "base/file/proto_util.h"
 #include "base/log.h"
+#include "base/singleton.h"
 #include "base/string_util.h"
 #include "third_party/gflags/gflags.h"
 #include "third_party/jsoncpp/json.h"
@@ -16,12 +17,17 @@
 #include "third_party/mysql_client_cpp/include/cppconn/statement.h"
 #include "util/net/util.h"
 
+#include "push/serving/flight/flight_refresh_scheduler.h"
 #include "push/util/common_util.h"
 
+DECLARE_int32(flight_hot_cache_seconds);
+DECLARE_int32(flight_negative_cache_seconds);
 DECLARE_string(mysql_config);
 
 namespace {
-  
+
+static const int kHotCacheSize = 100000;
+static const int kNegativeCacheSize = 100000;
 static const char kOkText[] = "ok";
 static const char kServiceName[] = "flight info service";
 static const char kQueryFormat[] = (
@@ -44,6 +50,10 @@ FlightInfoQueryHandler::~FlightInfoQueryHandler() {}
 
 void FlightInfoQueryHandler::Init() {
   flight_db_interface_.reset(new FlightDbInterface);
+  hot_cache_.reset(
+      new recommendation::ExpiringCache<FlightResponse>(kHotCacheSize));
+  negative_cache_.reset(
+      new recommendation::ExpiringCache<bool>(kNegativeCacheSize));
   mysql_server_.reset(new MysqlServer());
   CHECK(file::ReadProtoFromTextFile(FLAGS_mysql_config, mysql_server_.get()));
   LOG(INFO) << "Init mysql config from file:" << FLAGS_mysql_config;
@@ -68,21 +78,57 @@ bool FlightInfoQueryHandler::HandleRequest(util::HttpRequest* request,
   FlightResponse flight_response;
   flight_request.set_flight_no(req["flight_no"].asString());
   flight_request.set_depart_date(req["depart_date"].asString());
+  string key = flight_request.flight_no() + "&" +
+               flight_request.depart_date();
+  if (hot_cache_->Get(key, &flight_response)) {
+    VLOG(1) << "Hit hot cache, key:" << key;
+    response->AppendBuffer(ResponseInfo(flight_response));
+    return true;
+  }
   if (flight_db_interface_->GetFlightInfo(&flight_request, &flight_response)) {
+    hot_cache_->Put(key, flight_response, FLAGS_flight_hot_cache_seconds);
     response->AppendBuffer(ResponseInfo(flight_response));
     return true;
-  } else {
-    LOG(ERROR) << "Get flight info failed, flight_no:"
-               << flight_request.flight_no();
-    if (!UpdateFlightNo(flight_request.flight_no())) {
-      LOG(ERROR) << "update flight no to db failed";
-    }
-    if (!flight_db_interface_->UpdateFlightData(flight_request.flight_no())) {
-      LOG(ERROR) << "fetch and update flight data to redis failed";
-    }
+  }
+  LOG(ERROR) << "Get flight info failed, flight_no:"
+             << flight_request.flight_no();
+  bool is_not_found = false;
+  if (negative_cache_->Get(key, &is_not_found)) {
+    LOG(INFO) << "Hit negative cache, key:" << key;
     response->AppendBuffer(ErrorInfo("Get flight info failed"));
     return false;
   }
+  auto loader = [this, &flight_request](FlightResponse* loaded_response) {
+    return FetchOnMiss(flight_request, loaded_response);
+  };
+  if (miss_single_flight_.Do(key, loader, &flight_response)) {
+    hot_cache_->Put(key, flight_response, FLAGS_flight_hot_cache_seconds);
+    response->AppendBuffer(ResponseInfo(flight_response));
+    return true;
+  }
+  response->AppendBuffer(ErrorInfo("Get flight info failed"));
+  return false;
+}
+
+bool FlightInfoQueryHandler::FetchOnMiss(const FlightRequest& flight_request,
+                                         FlightResponse* flight_response) {
+  const string& flight_no = flight_request.flight_no();
+  const string& depart_date = flight_request.depart_date();
+  if (!UpdateFlightNo(flight_no)) {
+    LOG(ERROR) << "update flight no to db failed";
+  }
+  bool is_not_found = false;
+  if (!flight_db_interface_->UpdateFlightData(flight_no, depart_date,
+                                              flight_response,
+                                              &is_not_found)) {
+    LOG(ERROR) << "fetch and update flight data to redis failed";
+    if (is_not_found) {
+      negative_cache_->Put(flight_no + "&" + depart_date, true,
+                           FLAGS_flight_negative_cache_seconds);
+    }
+    return false;
+  }
+  return true;
 }
 
 string FlightInfoQueryHandler::ErrorInfo(const string& error) const {
@@ -166,6 +212,9 @@ bool StatusHandler::HandleRequest(util::HttpRequest* request,
   result["status"] = kOkText;
   result["host"] = util::GetLocalHostName();
   result["service"] = kServiceName;
+  Json::Value refresh_stats;
+  Singleton<FlightRefreshScheduler>::get()->GetStats(&refresh_stats);
+  result["flight_refresh"] = refresh_stats;
   response->AppendBuffer(result.toStyledString());
   return true;
 }
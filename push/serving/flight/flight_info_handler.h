@@ -13,6 +13,7 @@
 
 #include "push/proto/flight_meta.pb.h"
 #include "push/serving/flight/flight_db_interface.h"
+#include "push/util/cache_util.h"
 
 namespace serving {
 
@@ -30,9 +31,17 @@ class FlightInfoQueryHandler : public HttpRequestHandler {
   string ErrorInfo(const string& error) const;
   string ResponseInfo(const FlightResponse& response);
   bool UpdateFlightNo(const string& flight_no);
+  bool FetchOnMiss(const FlightRequest& flight_request,
+                   FlightResponse* flight_response);
 
   std::unique_ptr<MysqlServer> mysql_server_;
   std::unique_ptr<FlightDbInterface> flight_db_interface_;
+  // hot responses served without leaving the process
+  std::unique_ptr<recommendation::ExpiringCache<FlightResponse>> hot_cache_;
+  // flight numbers upstream does not know, not fetched again until expired
+  std::unique_ptr<recommendation::ExpiringCache<bool>> negative_cache_;
+  // concurrent misses of the same flight_no&depart_date share one fetch
+  recommendation::SingleFlight<FlightResponse> miss_single_flight_;
   DISALLOW_COPY_AND_ASSIGN(FlightInfoQueryHandler);
 };
 
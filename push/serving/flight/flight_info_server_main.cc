@@ -21,11 +21,23 @@ DEFINE_int32(redis_expire_time,
 DEFINE_int32(redis_max_sleep,
     128, "redis reconnect max sleep time");
 DEFINE_int32(flight_update_duration, 600, "flight info update duration");
+DEFINE_int32(flight_update_thread_num, 4, "flight refresh worker count");
+DEFINE_int32(flight_fetch_qps, 10, "upstream flight fetch qps cap");
+DEFINE_int32(flight_refresh_min_interval,
+    120, "refresh interval near departure");
+DEFINE_int32(flight_refresh_max_interval,
+    3600, "refresh interval far from departure");
+DEFINE_int32(flight_hot_cache_seconds,
+    10, "ttl of the in-process flight response cache");
+DEFINE_int32(flight_negative_cache_seconds,
+    300, "ttl of flights not found upstream");
 
 DEFINE_string(redis_conf,
     "config/push/flight/redis_test.conf", "redis config");
 DEFINE_string(redis_sub_topic,
     "push_controller", "redis subscribe topic");
+DEFINE_string(flight_change_topic, "flight_change",
+    "topic the flight changes are published to, not published if empty");
 DEFINE_string(mysql_config,
   "config/push/flight/mysql_server.conf", "mysql config");
 
@@ -0,0 +1,283 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/serving/flight/flight_refresh_scheduler.h"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+#include "base/hash.h"
+#include "base/log.h"
+#include "third_party/gflags/gflags.h"
+
+#include "push/util/time_util.h"
+
+DECLARE_int32(flight_update_duration);
+DECLARE_int32(flight_fetch_qps);
+DECLARE_int32(flight_refresh_min_interval);
+DECLARE_int32(flight_refresh_max_interval);
+
+namespace {
+
+static const char kDatetimeFormat[] = "%Y-%m-%d %H:%M";
+static const int kMaxChangeCnt = 3;
+static const int kNearDepartureSeconds = 3 * 60 * 60;
+static const int kOverdueSeconds = 60;
+
+struct TaskLater {
+  bool operator()(const flight::FlightRefreshTask& left,
+                  const flight::FlightRefreshTask& right) const {
+    return left.next_refresh_time > right.next_refresh_time;
+  }
+};
+
+}  // namespace
+
+namespace flight {
+
+int ComputeRefreshInterval(time_t now, const FlightRefreshTask& task,
+                           int min_interval, int max_interval) {
+  if (task.is_arrived) {
+    return max_interval;
+  }
+  int interval = max_interval;
+  if (task.takeoff_time > 0) {
+    time_t to_departure = task.takeoff_time - now;
+    if (to_departure <= -60 * 60) {
+      // in the air, only the arrival time is still moving
+      interval = 10 * 60;
+    } else if (to_departure <= 60 * 60) {
+      interval = min_interval;
+    } else if (to_departure <= 3 * 60 * 60) {
+      interval = 5 * 60;
+    } else if (to_departure <= 6 * 60 * 60) {
+      interval = 15 * 60;
+    } else if (to_departure <= 24 * 60 * 60) {
+      interval = 30 * 60;
+    }
+  }
+  for (int i = 0; i < task.change_cnt; ++i) {
+    interval /= 2;
+  }
+  return std::min(std::max(interval, min_interval), max_interval);
+}
+
+FlightRefreshScheduler::FlightRefreshScheduler()
+  : shut_down_(false),
+    next_generation_(0),
+    upstream_call_cnt_(0),
+    fetch_fail_cnt_(0),
+    changed_cnt_(0),
+    current_minute_(0),
+    current_minute_call_cnt_(0),
+    last_minute_call_cnt_(0),
+    next_fetch_slot_(std::chrono::steady_clock::now()) {
+  LOG(INFO) << "Construct FlightRefreshScheduler";
+}
+
+FlightRefreshScheduler::~FlightRefreshScheduler() {}
+
+void FlightRefreshScheduler::Track(const string& flight_no) {
+  time_t now = time(NULL);
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (int days = 0; days <= 1; ++days) {
+    FlightRefreshTask task;
+    task.flight_no = flight_no;
+    recommendation::MakeDate(days, &task.depart_date);
+    if (tracked_keys_.find(task.key()) != tracked_keys_.end()) {
+      continue;
+    }
+    task.next_refresh_time = now;
+    task.generation = ++next_generation_;
+    tracked_keys_[task.key()] = task.generation;
+    PushTask(task);
+    VLOG(1) << "track new flight, key:" << task.key();
+  }
+}
+
+void FlightRefreshScheduler::Retain(const vector<string>& flight_nos) {
+  set<string> reported(flight_nos.begin(), flight_nos.end());
+  auto is_dropped = [&reported](const FlightRefreshTask& task) {
+    return reported.find(task.flight_no) == reported.end();
+  };
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t old_size = task_heap_.size();
+  task_heap_.erase(std::remove_if(task_heap_.begin(), task_heap_.end(),
+                                  is_dropped),
+                   task_heap_.end());
+  std::make_heap(task_heap_.begin(), task_heap_.end(), TaskLater());
+  for (auto it = tracked_keys_.begin(); it != tracked_keys_.end();) {
+    if (reported.find(it->first.substr(0, it->first.find('&'))) ==
+        reported.end()) {
+      it = tracked_keys_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  LOG(INFO) << "untrack flights no longer reported, tasks:"
+            << old_size - task_heap_.size();
+}
+
+bool FlightRefreshScheduler::WaitNext(FlightRefreshTask* task) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!shut_down_) {
+    time_t now = time(NULL);
+    if (task_heap_.empty() || task_heap_.front().next_refresh_time > now) {
+      time_t wait_seconds = 1;
+      if (!task_heap_.empty()) {
+        wait_seconds = task_heap_.front().next_refresh_time - now;
+      }
+      cond_.wait_for(lock, std::chrono::seconds(wait_seconds));
+      continue;
+    }
+    PopTask(task);
+    string today;
+    recommendation::MakeDate(0, &today);
+    if (task->depart_date < today) {
+      if (IsCurrent(*task)) {
+        tracked_keys_.erase(task->key());
+      }
+      VLOG(1) << "drop outdated flight, key:" << task->key();
+      continue;
+    }
+    return true;
+  }
+  return false;
+}
+
+void FlightRefreshScheduler::Complete(FlightRefreshTask* task, bool success,
+                                      const FlightResponse& response) {
+  time_t now = time(NULL);
+  bool is_changed = false;
+  if (success) {
+    string response_string;
+    response.SerializeToString(&response_string);
+    uint64 fingerprint = static_cast<uint64>(
+        mobvoi::Fingerprint(response_string));
+    is_changed = task->fingerprint != 0 && task->fingerprint != fingerprint;
+    if (is_changed) {
+      task->change_cnt = std::min(task->change_cnt + 1, kMaxChangeCnt);
+    } else if (task->change_cnt > 0) {
+      --task->change_cnt;
+    }
+    task->fingerprint = fingerprint;
+    task->last_refresh_time = now;
+    task->is_arrived = !response.actual_arrive().empty();
+    string takeoff;
+    if (recommendation::GetTakeoff(response.plan_takeoff(),
+                                   response.estimated_takeoff(),
+                                   response.actual_takeoff(),
+                                   &takeoff)) {
+      recommendation::DatetimeToTimestamp(takeoff, &task->takeoff_time,
+                                          kDatetimeFormat);
+    }
+    task->next_refresh_time = now + ComputeRefreshInterval(
+        now, *task, FLAGS_flight_refresh_min_interval,
+        FLAGS_flight_refresh_max_interval);
+  } else {
+    task->next_refresh_time = now + FLAGS_flight_update_duration;
+  }
+  VLOG(1) << "flight refreshed, key:" << task->key()
+          << ", success:" << success
+          << ", next_refresh_time:" << task->next_refresh_time;
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++upstream_call_cnt_;
+  if (!success) {
+    ++fetch_fail_cnt_;
+  } else if (is_changed) {
+    ++changed_cnt_;
+  }
+  time_t minute = now / 60;
+  if (minute != current_minute_) {
+    last_minute_call_cnt_ =
+        (minute == current_minute_ + 1) ? current_minute_call_cnt_ : 0;
+    current_minute_ = minute;
+    current_minute_call_cnt_ = 0;
+  }
+  ++current_minute_call_cnt_;
+  if (!IsCurrent(*task)) {
+    // untracked, or re-tracked with a fresh task while this one was out
+    VLOG(1) << "drop untracked flight, key:" << task->key();
+    return;
+  }
+  PushTask(*task);
+}
+
+void FlightRefreshScheduler::AcquireFetchQuota() {
+  if (FLAGS_flight_fetch_qps <= 0) {
+    return;
+  }
+  std::chrono::steady_clock::time_point fetch_slot;
+  {
+    std::lock_guard<std::mutex> lock(quota_mutex_);
+    auto now = std::chrono::steady_clock::now();
+    if (next_fetch_slot_ < now) {
+      next_fetch_slot_ = now;
+    }
+    fetch_slot = next_fetch_slot_;
+    next_fetch_slot_ += std::chrono::microseconds(
+        1000000 / FLAGS_flight_fetch_qps);
+  }
+  std::this_thread::sleep_until(fetch_slot);
+}
+
+void FlightRefreshScheduler::ShutDown() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  shut_down_ = true;
+  cond_.notify_all();
+}
+
+void FlightRefreshScheduler::GetStats(Json::Value* stats) {
+  time_t now = time(NULL);
+  std::lock_guard<std::mutex> lock(mutex_);
+  int near_departure_cnt = 0;
+  int overdue_cnt = 0;
+  time_t max_age = 0;
+  time_t total_age = 0;
+  for (auto& task : task_heap_) {
+    if (task.next_refresh_time + kOverdueSeconds < now) {
+      ++overdue_cnt;
+    }
+    if (task.takeoff_time == 0 || task.is_arrived ||
+        task.takeoff_time - now > kNearDepartureSeconds ||
+        task.takeoff_time < now) {
+      continue;
+    }
+    time_t age = now - task.last_refresh_time;
+    ++near_departure_cnt;
+    total_age += age;
+    max_age = std::max(max_age, age);
+  }
+  (*stats)["tracked_cnt"] = static_cast<Json::UInt64>(tracked_keys_.size());
+  (*stats)["queued_cnt"] = static_cast<Json::UInt64>(task_heap_.size());
+  (*stats)["overdue_cnt"] = overdue_cnt;
+  (*stats)["near_departure_cnt"] = near_departure_cnt;
+  (*stats)["near_departure_max_age"] = static_cast<Json::Int64>(max_age);
+  (*stats)["near_departure_avg_age"] = static_cast<Json::Int64>(
+      near_departure_cnt > 0 ? total_age / near_departure_cnt : 0);
+  (*stats)["upstream_call_cnt"] =
+      static_cast<Json::UInt64>(upstream_call_cnt_);
+  (*stats)["upstream_last_minute_call_cnt"] = last_minute_call_cnt_;
+  (*stats)["fetch_fail_cnt"] = static_cast<Json::UInt64>(fetch_fail_cnt_);
+  (*stats)["changed_cnt"] = static_cast<Json::UInt64>(changed_cnt_);
+}
+
+void FlightRefreshScheduler::PushTask(const FlightRefreshTask& task) {
+  task_heap_.push_back(task);
+  std::push_heap(task_heap_.begin(), task_heap_.end(), TaskLater());
+  cond_.notify_one();
+}
+
+void FlightRefreshScheduler::PopTask(FlightRefreshTask* task) {
+  std::pop_heap(task_heap_.begin(), task_heap_.end(), TaskLater());
+  *task = task_heap_.back();
+  task_heap_.pop_back();
+}
+
+bool FlightRefreshScheduler::IsCurrent(const FlightRefreshTask& task) const {
+  auto it = tracked_keys_.find(task.key());
+  return it != tracked_keys_.end() && it->second == task.generation;
+}
+
+}  // namespace flight
@@ -0,0 +1,94 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#ifndef PUSH_SERVING_FLIGHT_FLIGHT_REFRESH_SCHEDULER_H_
+#define PUSH_SERVING_FLIGHT_FLIGHT_REFRESH_SCHEDULER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "base/basictypes.h"
+#include "base/compat.h"
+#include "base/singleton.h"
+#include "third_party/jsoncpp/json.h"
+
+#include "push/proto/flight_meta.pb.h"
+
+namespace flight {
+
+struct FlightRefreshTask {
+  string flight_no;
+  string depart_date;
+  time_t next_refresh_time;
+  time_t last_refresh_time;
+  time_t takeoff_time;  // 0 before the first successful fetch
+  bool is_arrived;
+  int change_cnt;  // recent changes, decays on every unchanged refresh
+  uint64 fingerprint;
+  uint64 generation;  // set by Track, stale once the key is re-tracked
+  FlightRefreshTask()
+    : next_refresh_time(0), last_refresh_time(0), takeoff_time(0),
+      is_arrived(false), change_cnt(0), fingerprint(0), generation(0) {}
+  string key() const {
+    return flight_no + "&" + depart_date;
+  }
+};
+
+// Seconds until the next refresh of the task: every min_interval near
+// departure, up to max_interval when far out or arrived, and shorter when
+// the flight has been changing recently.
+int ComputeRefreshInterval(time_t now, const FlightRefreshTask& task,
+                           int min_interval, int max_interval);
+
+// Process-wide refresh queue ordered by next refresh time, shared by the
+// updater workers and exported on the status handler.
+class FlightRefreshScheduler {
+ public:
+  ~FlightRefreshScheduler();
+  // Tracks today and tomorrow of the flight, no-op if already tracked.
+  void Track(const string& flight_no);
+  // Untracks the flights missing from flight_nos, the ones being refreshed
+  // are dropped when they complete.
+  void Retain(const vector<string>& flight_nos);
+  // Blocks until a task is due, returns false after ShutDown.
+  bool WaitNext(FlightRefreshTask* task);
+  // Reschedules the task with the result of its refresh, unless its key
+  // was untracked or re-tracked meanwhile.
+  void Complete(FlightRefreshTask* task, bool success,
+                const FlightResponse& response);
+  // Blocks until the upstream qps cap allows one more fetch.
+  void AcquireFetchQuota();
+  void ShutDown();
+  void GetStats(Json::Value* stats);
+
+ private:
+  friend struct DefaultSingletonTraits<FlightRefreshScheduler>;
+  FlightRefreshScheduler();
+  void PushTask(const FlightRefreshTask& task);
+  void PopTask(FlightRefreshTask* task);
+  bool IsCurrent(const FlightRefreshTask& task) const;
+
+  bool shut_down_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  // min heap on next_refresh_time, a vector so stats can walk it
+  vector<FlightRefreshTask> task_heap_;
+  // key -> generation of its live task
+  map<string, uint64> tracked_keys_;
+  uint64 next_generation_;
+  uint64 upstream_call_cnt_;
+  uint64 fetch_fail_cnt_;
+  uint64 changed_cnt_;
+  time_t current_minute_;
+  int current_minute_call_cnt_;
+  int last_minute_call_cnt_;
+
+  std::mutex quota_mutex_;
+  std::chrono::steady_clock::time_point next_fetch_slot_;
+  DISALLOW_COPY_AND_ASSIGN(FlightRefreshScheduler);
+};
+
+}  // namespace flight
+
+#endif  // PUSH_SERVING_FLIGHT_FLIGHT_REFRESH_SCHEDULER_H_
@@ -0,0 +1,94 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/serving/flight/flight_refresh_scheduler.h"
+#include "third_party/gtest/gtest.h"
+#include "third_party/gflags/gflags.h"
+
+DEFINE_int32(flight_update_duration, 600, "flight info update duration");
+DEFINE_int32(flight_fetch_qps, 10, "upstream flight fetch qps cap");
+DEFINE_int32(flight_refresh_min_interval, 120, "min refresh interval");
+DEFINE_int32(flight_refresh_max_interval, 3600, "max refresh interval");
+
+using namespace flight;
+
+namespace {
+static const time_t kNow = 1500000000;
+static const int kMinInterval = 120;
+static const int kMaxInterval = 3600;
+}
+
+TEST(ComputeRefreshIntervalTest, UnknownTakeoff) {
+  FlightRefreshTask task;
+  EXPECT_EQ(kMaxInterval,
+            ComputeRefreshInterval(kNow, task, kMinInterval, kMaxInterval));
+}
+
+TEST(ComputeRefreshIntervalTest, ProximityToDeparture) {
+  FlightRefreshTask task;
+  task.takeoff_time = kNow + 20 * 60;
+  EXPECT_EQ(kMinInterval,
+            ComputeRefreshInterval(kNow, task, kMinInterval, kMaxInterval));
+  task.takeoff_time = kNow + 2 * 60 * 60;
+  EXPECT_EQ(5 * 60,
+            ComputeRefreshInterval(kNow, task, kMinInterval, kMaxInterval));
+  task.takeoff_time = kNow + 12 * 60 * 60;
+  EXPECT_EQ(30 * 60,
+            ComputeRefreshInterval(kNow, task, kMinInterval, kMaxInterval));
+  task.takeoff_time = kNow + 30 * 60 * 60;
+  EXPECT_EQ(kMaxInterval,
+            ComputeRefreshInterval(kNow, task, kMinInterval, kMaxInterval));
+  task.is_arrived = true;
+  task.takeoff_time = kNow - 3 * 60 * 60;
+  EXPECT_EQ(kMaxInterval,
+            ComputeRefreshInterval(kNow, task, kMinInterval, kMaxInterval));
+}
+
+TEST(ComputeRefreshIntervalTest, RecentChanges) {
+  FlightRefreshTask task;
+  task.takeoff_time = kNow + 12 * 60 * 60;
+  task.change_cnt = 2;
+  EXPECT_EQ(30 * 60 / 4,
+            ComputeRefreshInterval(kNow, task, kMinInterval, kMaxInterval));
+  task.takeoff_time = kNow + 2 * 60 * 60;
+  task.change_cnt = 3;
+  EXPECT_EQ(kMinInterval,
+            ComputeRefreshInterval(kNow, task, kMinInterval, kMaxInterval));
+}
+
+TEST(FlightRefreshSchedulerTest, RetainReportedFlights) {
+  FlightRefreshScheduler* scheduler = Singleton<FlightRefreshScheduler>::get();
+  scheduler->Track("CA1234");
+  scheduler->Track("MU5678");
+  Json::Value stats;
+  scheduler->GetStats(&stats);
+  EXPECT_EQ(4, stats["tracked_cnt"].asInt());
+  scheduler->Retain(vector<string>(1, "MU5678"));
+  scheduler->GetStats(&stats);
+  EXPECT_EQ(2, stats["tracked_cnt"].asInt());
+  FlightRefreshTask task;
+  ASSERT_TRUE(scheduler->WaitNext(&task));
+  EXPECT_EQ("MU5678", task.flight_no);
+  // a refresh completing after its flight is untracked is not requeued
+  scheduler->Retain(vector<string>());
+  scheduler->Complete(&task, false, FlightResponse());
+  scheduler->GetStats(&stats);
+  EXPECT_EQ(0, stats["tracked_cnt"].asInt());
+}
+
+TEST(FlightRefreshSchedulerTest, DropStaleTaskOfRetrackedFlight) {
+  FlightRefreshScheduler* scheduler = Singleton<FlightRefreshScheduler>::get();
+  scheduler->Track("ZH9999");
+  FlightRefreshTask task;
+  ASSERT_TRUE(scheduler->WaitNext(&task));
+  // untracked and tracked again while the refresh is running
+  scheduler->Retain(vector<string>());
+  scheduler->Track("ZH9999");
+  Json::Value stats;
+  scheduler->GetStats(&stats);
+  EXPECT_EQ(2, stats["queued_cnt"].asInt());
+  scheduler->Complete(&task, false, FlightResponse());
+  scheduler->GetStats(&stats);
+  EXPECT_EQ(2, stats["tracked_cnt"].asInt());
+  EXPECT_EQ(2, stats["queued_cnt"].asInt());
+}
@@ -6,6 +6,12 @@
 
 #include "push/serving/train/time_table_dumper.h"
 
+DEFINE_int32(time_table_refresh_thread_num, 8,
+  "time table bulk refresh crawler thread number");
+DEFINE_int32(train_crawl_qps, 2, "time table crawl qps cap per data source");
+DEFINE_int32(train_refresh_window, 600,
+  "seconds a crawled train is not crawled again");
+
 DEFINE_string(mysql_config,
   "config/recommendation/train/mysql_server.conf", "");
 DEFINE_string(baidu_search_template_file,
@@ -5,7 +5,13 @@
 
 #include <stdlib.h>
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
+
 #include "base/file/proto_util.h"
+#include "base/hash.h"
 #include "base/log.h"
 #include "base/string_util.h"
 #include "third_party/gflags/gflags.h"
@@ -16,7 +22,12 @@
 #include "third_party/mysql_client_cpp/include/cppconn/resultset.h"
 #include "third_party/mysql_client_cpp/include/cppconn/statement.h"
 
+#include "push/serving/train/time_table_index.h"
+#include "push/serving/train/train_update_queue.h"
+#include "push/util/common_util.h"
+
 DECLARE_int32(data_source);
+DECLARE_int32(time_table_refresh_thread_num);
 DECLARE_string(mysql_config);
 
 DECLARE_string(mysql_config);
@@ -25,9 +36,110 @@ DECLARE_string(baidu_search_url_format);
 DECLARE_string(ctrip_template_file);
 DECLARE_string(ctrip_url_format);
 
+namespace {
+
+using push_controller::EscapeSqlString;
+
+// changed trains written by one upsert
+static const size_t kWriteBatchTrainCnt = 50;
+
+bool StationNoLess(const train::TimeTable& left,
+                   const train::TimeTable& right) {
+  return left.station_no() < right.station_no();
+}
+
+// Hash of the columns stored in train_time_table, so a fetched train and
+// the same train read back from db hash equal.
+uint64 ContentHash(const vector<train::TimeTable>& station_vector) {
+  string content;
+  for (auto& station : station_vector) {
+    content += StringPrintf("%s\t%d\t%s\t%s\t%s\t%s\n",
+                            station.train_no().c_str(),
+                            station.station_no(),
+                            station.station_name().c_str(),
+                            station.get_in_time().c_str(),
+                            station.depart_time().c_str(),
+                            station.stay_time().c_str());
+  }
+  return static_cast<uint64>(mobvoi::Fingerprint(content));
+}
+
+string QuoteTrainNoList(const vector<string>& train_no_vector) {
+  vector<string> quoted_vector;
+  for (auto& train_no : train_no_vector) {
+    quoted_vector.push_back("'" + EscapeSqlString(train_no) + "'");
+  }
+  return JoinString(quoted_vector, ',');
+}
+
+train::TimeTableContent MakeContent(
+    const vector<train::TimeTable>& station_vector) {
+  train::TimeTableContent content;
+  content.content_hash = ContentHash(station_vector);
+  if (!station_vector.empty()) {
+    content.last_station_no = station_vector.back().station_no();
+  }
+  return content;
+}
+
+}  // namespace
+
 namespace train {
 
-BaseTimeTableDumper::BaseTimeTableDumper() {
+TimeTableContentHolder::TimeTableContentHolder() {
+  LOG(INFO) << "Construct TimeTableContentHolder";
+}
+
+TimeTableContentHolder::~TimeTableContentHolder() {}
+
+bool TimeTableContentHolder::Get(const string& train_no,
+                                 TimeTableContent* content) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = content_map_.find(train_no);
+  if (it == content_map_.end()) {
+    return false;
+  }
+  *content = it->second;
+  return true;
+}
+
+void TimeTableContentHolder::Set(const string& train_no,
+                                 const TimeTableContent& content) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  content_map_[train_no] = content;
+}
+
+void TimeTableContentHolder::Reset(
+    std::unordered_map<string, TimeTableContent>* content_map) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  content_map_.swap(*content_map);
+}
+
+void TimeTableRefreshStats::Merge(const TimeTableRefreshStats& other) {
+  train_cnt += other.train_cnt;
+  fetch_fail_cnt += other.fetch_fail_cnt;
+  changed_cnt += other.changed_cnt;
+  write_fail_cnt += other.write_fail_cnt;
+  db_round_trip_cnt += other.db_round_trip_cnt;
+}
+
+void TimeTableRefreshStats::ToJson(Json::Value* value) const {
+  (*value)["train_cnt"] = train_cnt;
+  (*value)["fetch_fail_cnt"] = fetch_fail_cnt;
+  (*value)["changed_cnt"] = changed_cnt;
+  (*value)["write_fail_cnt"] = write_fail_cnt;
+  (*value)["db_round_trip_cnt"] = db_round_trip_cnt;
+  (*value)["elapsed_ms"] = static_cast<Json::Int64>(elapsed_ms);
+  (*value)["trains_per_second"] =
+      elapsed_ms > 0 ? train_cnt * 1000.0 / elapsed_ms : 0.0;
+  int fetched_cnt = train_cnt - fetch_fail_cnt;
+  (*value)["changed_ratio"] =
+      fetched_cnt > 0 ? static_cast<double>(changed_cnt) / fetched_cnt : 0.0;
+}
+
+BaseTimeTableDumper::BaseTimeTableDumper(int data_source)
+  : data_source_(data_source),
+    content_holder_(Singleton<TimeTableContentHolder>::get()) {
   LOG(INFO) << "Construct BaseTimeTableDumper";
   Init();
 }
@@ -42,42 +154,99 @@ void BaseTimeTableDumper::Init() {
 }
 
 bool BaseTimeTableDumper::UpdateTimeTable() {
+  TimeTableRefreshStats stats;
+  return UpdateTimeTable(&stats);
+}
+
+bool BaseTimeTableDumper::UpdateTimeTable(TimeTableRefreshStats* stats) {
+  auto start = std::chrono::steady_clock::now();
   vector<string> trainno_vector;
+  ++stats->db_round_trip_cnt;
   if (!QueryAllTrainNo(&trainno_vector)) {
     return false;
   }
+  if (!LoadContent(vector<string>(), stats)) {
+    LOG(WARNING) << "load content hash failed, every train will be written";
+  }
 
-  size_t batch_size = 50;
-  vector<vector<string>> trainno_2d_vector;
-  size_t set_count = trainno_vector.size() / batch_size; 
-  for (size_t i = 0; i < set_count; ++i) {
-    size_t b = batch_size * i;
-    size_t e = batch_size * (i + 1);
-    if (i == set_count - 1) {
-      e = trainno_vector.size();
-    }
-    vector<string> sub_vector(trainno_vector.begin() + b,
-                              trainno_vector.begin() + e);
-    trainno_2d_vector.push_back(sub_vector);
+  std::atomic<size_t> next_index(0);
+  int thread_num = std::max(FLAGS_time_table_refresh_thread_num, 1);
+  vector<TimeTableRefreshStats> worker_stats(thread_num);
+  vector<std::thread> workers;
+  for (int i = 0; i < thread_num; ++i) {
+    workers.emplace_back(&BaseTimeTableDumper::RefreshWorker, this,
+                         std::cref(trainno_vector), &next_index,
+                         &worker_stats[i]);
+  }
+  for (int i = 0; i < thread_num; ++i) {
+    workers[i].join();
+    stats->Merge(worker_stats[i]);
   }
+  stats->elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count();
 
-  // TODO(xjliu): using concurrency
-  bool whole_success = true;
-  vector<TimeTable> time_table_vector;
-  for (auto it = trainno_2d_vector.begin(); 
-      it != trainno_2d_vector.end(); ++it) {
-    LOG(INFO) << "current batch size:" << it->size();
-    time_table_vector.clear();
-    FetchTimeTable(*it, &time_table_vector);
-    if (!DumpResultIntoDb(time_table_vector)) {
-      whole_success = false;
+  Json::Value stats_value;
+  stats->ToJson(&stats_value);
+  Json::FastWriter writer;
+  LOG(INFO) << "update time table finished, stats:"
+            << writer.write(stats_value);
+  if (stats->changed_cnt > 0 &&
+      Singleton<TimeTableIndexHolder>::get()->is_loaded() &&
+      !LoadTimeTableIndex()) {
+    LOG(ERROR) << "reload time table index failed, keep the old one";
+  }
+  return stats->write_fail_cnt == 0;
+}
+
+void BaseTimeTableDumper::RefreshWorker(const vector<string>& trainno_vector,
+                                        std::atomic<size_t>* next_index,
+                                        TimeTableRefreshStats* stats) {
+  TrainUpdateQueue* update_queue = Singleton<TrainUpdateQueue>::get();
+  std::unique_ptr<sql::Connection> connection;
+  vector<vector<TimeTable>> pending_vector;
+  vector<TimeTable> station_vector;
+  TimeTableContent content;
+  for (size_t i = (*next_index)++; i < trainno_vector.size();
+       i = (*next_index)++) {
+    const string& train_no = trainno_vector[i];
+    ++stats->train_cnt;
+    station_vector.clear();
+    // the per-train crawls and the bulk refresh share the source qps cap
+    update_queue->AcquireFetchQuota(data_source_);
+    if (!FetchTimeTableByTrainNo(train_no, &station_vector) ||
+        station_vector.empty()) {
+      LOG(ERROR) << "Fetch time table by no failed, no:" << train_no;
+      ++stats->fetch_fail_cnt;
+      continue;
+    }
+    std::sort(station_vector.begin(), station_vector.end(), StationNoLess);
+    if (content_holder_->Get(train_no, &content) &&
+        content.content_hash == ContentHash(station_vector)) {
+      VLOG(1) << "time table unchanged, train_no:" << train_no;
+      continue;
+    }
+    ++stats->changed_cnt;
+    pending_vector.push_back(station_vector);
+    if (pending_vector.size() >= kWriteBatchTrainCnt) {
+      FlushTimeTables(&connection, &pending_vector, stats);
     }
   }
-  LOG(INFO) << "update time table success, whole_success:" << whole_success;
-  return whole_success;
+  FlushTimeTables(&connection, &pending_vector, stats);
 }
 
 QueryStatus BaseTimeTableDumper::QueryTimeTable(
+    const string& train_no,
+    const string& depart_station,
+    vector<TimeTable>* time_table_vector) {
+  std::shared_ptr<const TimeTableIndex> index =
+      Singleton<TimeTableIndexHolder>::get()->Get();
+  if (index) {
+    return index->Query(train_no, depart_station, time_table_vector);
+  }
+  return QueryTimeTableFromDb(train_no, depart_station, time_table_vector);
+}
+
+QueryStatus BaseTimeTableDumper::QueryTimeTableFromDb(
     const string& train_no,
     const string& depart_station, 
     vector<TimeTable>* time_table_vector) {
@@ -156,6 +325,7 @@ bool BaseTimeTableDumper::FetchAndDumpTimeTable(
   if (!DumpResultIntoDb(time_table_vector)) {
     return false;
   }
+  RefreshTimeTableIndex(train_no_vector);
   LOG(INFO) << "fetch and dump time table success, count:" 
             << train_no_vector.size();
   return true;
@@ -210,72 +380,250 @@ void BaseTimeTableDumper::FetchTimeTable(
 
 bool BaseTimeTableDumper::DumpResultIntoDb(
     const vector<TimeTable>& time_table_vector) {
-  string table = "train_time_table"; 
-  string query_format = (
-      "SELECT train_no,station_no,station_name,get_in_time,"
-      "depart_time,stay_time FROM %s "
-      "WHERE train_no='%s' AND station_no='%d';"
+  map<string, vector<TimeTable>> train_station_map;
+  for (auto& time_table : time_table_vector) {
+    train_station_map[time_table.train_no()].push_back(time_table);
+  }
+  TimeTableRefreshStats stats;
+  TimeTableContent content;
+  vector<string> unknown_vector;
+  for (auto& train_station : train_station_map) {
+    if (!content_holder_->Get(train_station.first, &content)) {
+      unknown_vector.push_back(train_station.first);
+    }
+  }
+  if (!unknown_vector.empty() && !LoadContent(unknown_vector, &stats)) {
+    LOG(WARNING) << "load content failed, every train will be written";
+  }
+  std::unique_ptr<sql::Connection> connection;
+  vector<vector<TimeTable>> pending_vector;
+  for (auto& train_station : train_station_map) {
+    vector<TimeTable>& station_vector = train_station.second;
+    std::sort(station_vector.begin(), station_vector.end(), StationNoLess);
+    if (content_holder_->Get(train_station.first, &content) &&
+        content.content_hash == ContentHash(station_vector)) {
+      continue;
+    }
+    pending_vector.push_back(station_vector);
+    if (pending_vector.size() >= kWriteBatchTrainCnt) {
+      FlushTimeTables(&connection, &pending_vector, &stats);
+    }
+  }
+  FlushTimeTables(&connection, &pending_vector, &stats);
+  if (stats.write_fail_cnt > 0) {
+    LOG(ERROR) << "failed to update to db, train count:"
+               << stats.write_fail_cnt;
+    return false;
+  }
+  LOG(INFO) << "succeed in updating to db";
+  return true;
+}
+
+bool BaseTimeTableDumper::LoadContent(const vector<string>& train_no_vector,
+                                      TimeTableRefreshStats* stats) {
+  string query_sql = (
+      "SELECT train_no,station_no,station_name,get_in_time,depart_time,"
+      "stay_time FROM train_time_table"
   );
-  string insert_format = (
+  if (!train_no_vector.empty()) {
+    query_sql += " WHERE train_no IN (" + QuoteTrainNoList(train_no_vector) +
+                 ")";
+  }
+  query_sql += ";";
+  vector<TimeTable> time_table_vector;
+  ++stats->db_round_trip_cnt;
+  if (!QueryTimeTableRows(query_sql, &time_table_vector)) {
+    return false;
+  }
+  map<string, vector<TimeTable>> train_station_map;
+  for (auto& time_table : time_table_vector) {
+    train_station_map[time_table.train_no()].push_back(time_table);
+  }
+  std::unordered_map<string, TimeTableContent> content_map;
+  for (auto& train_station : train_station_map) {
+    vector<TimeTable>& station_vector = train_station.second;
+    std::sort(station_vector.begin(), station_vector.end(), StationNoLess);
+    content_map[train_station.first] = MakeContent(station_vector);
+  }
+  size_t train_cnt = content_map.size();
+  if (train_no_vector.empty()) {
+    content_holder_->Reset(&content_map);
+  } else {
+    // a train without stations in db is known to need no delete
+    for (auto& train_no : train_no_vector) {
+      content_holder_->Set(train_no, content_map[train_no]);
+    }
+  }
+  LOG(INFO) << "load content success, train count:" << train_cnt;
+  return true;
+}
+
+sql::Connection* BaseTimeTableDumper::Connect(TimeTableRefreshStats* stats) {
+  try {
+    sql::Driver * driver = sql::mysql::get_driver_instance();
+    std::unique_ptr<sql::Connection> connection(
+        driver->connect(mysql_server_->host(), 
+                        mysql_server_->user(), 
+                        mysql_server_->password()));
+    connection->setSchema(mysql_server_->database());
+    connection->setAutoCommit(false);
+    stats->db_round_trip_cnt += 3;
+    return connection.release();
+  } catch (const sql::SQLException &e) {
+    LOG(ERROR) << "# ERR: " << e.what()
+               << " (MySQL error code: " << e.getErrorCode()
+               << ", SQLState: " << e.getSQLState() << ")"; 
+  } catch (const std::runtime_error &e) {
+    LOG(ERROR) << "runtime error:" << e.what();
+  }
+  return NULL;
+}
+
+bool BaseTimeTableDumper::WriteTimeTables(
+    sql::Connection* connection,
+    const vector<vector<TimeTable>>& train_vector,
+    TimeTableRefreshStats* stats) {
+  string table = "train_time_table";
+  vector<string> value_vector;
+  vector<string> delete_vector;
+  TimeTableContent content;
+  for (auto& station_vector : train_vector) {
+    for (auto& station : station_vector) {
+      value_vector.push_back(StringPrintf(
+          "('%s','%d','%s','%s','%s','%s')",
+          EscapeSqlString(station.train_no()).c_str(),
+          station.station_no(),
+          EscapeSqlString(station.station_name()).c_str(),
+          EscapeSqlString(station.get_in_time()).c_str(),
+          EscapeSqlString(station.depart_time()).c_str(),
+          EscapeSqlString(station.stay_time()).c_str()));
+    }
+    const string& train_no = station_vector.front().train_no();
+    int last_station_no = station_vector.back().station_no();
+    if (!content_holder_->Get(train_no, &content) ||
+        content.last_station_no > last_station_no) {
+      delete_vector.push_back(StringPrintf(
+          "(train_no='%s' AND station_no>%d)",
+          EscapeSqlString(train_no).c_str(), last_station_no));
+    }
+  }
+  string upsert_sql = StringPrintf(
       "INSERT INTO %s (train_no,station_no,station_name,"
-      "get_in_time,depart_time,stay_time) "
-      "VALUES('%s','%d','%s','%s','%s','%s');"
-  );
-  string update_format = (
-      "UPDATE %s SET "
-      "station_name='%s',get_in_time='%s',depart_time='%s',"
-      "stay_time='%s' WHERE train_no='%s' AND station_no='%d';"
+      "get_in_time,depart_time,stay_time) VALUES %s "
+      "ON DUPLICATE KEY UPDATE station_name=VALUES(station_name),"
+      "get_in_time=VALUES(get_in_time),depart_time=VALUES(depart_time),"
+      "stay_time=VALUES(stay_time);",
+      table.c_str(), JoinString(value_vector, ',').c_str());
+  try {
+    std::unique_ptr<sql::Statement> statement(connection->createStatement());
+    statement->executeUpdate(upsert_sql);
+    ++stats->db_round_trip_cnt;
+    if (!delete_vector.empty()) {
+      string delete_sql = StringPrintf(
+          "DELETE FROM %s WHERE %s;", table.c_str(),
+          JoinString(delete_vector, " OR ").c_str());
+      statement->executeUpdate(delete_sql);
+      ++stats->db_round_trip_cnt;
+    }
+    connection->commit();
+    ++stats->db_round_trip_cnt;
+    for (auto& station_vector : train_vector) {
+      content_holder_->Set(station_vector.front().train_no(),
+                           MakeContent(station_vector));
+    }
+    return true;
+  } catch (const sql::SQLException &e) {
+    LOG(ERROR) << "write time table failed, trains:" << train_vector.size()
+               << ", # ERR: " << e.what()
+               << " (MySQL error code: " << e.getErrorCode()
+               << ", SQLState: " << e.getSQLState() << ")"; 
+  } catch (const std::runtime_error &e) {
+    LOG(ERROR) << "runtime error:" << e.what();
+  }
+  try {
+    connection->rollback();
+  } catch (const sql::SQLException &e) {
+    LOG(ERROR) << "rollback failed:" << e.what();
+  }
+  return false;
+}
+
+void BaseTimeTableDumper::FlushTimeTables(
+    std::unique_ptr<sql::Connection>* connection,
+    vector<vector<TimeTable>>* pending_vector,
+    TimeTableRefreshStats* stats) {
+  if (pending_vector->empty()) {
+    return;
+  }
+  if (!*connection) {
+    connection->reset(Connect(stats));
+  }
+  if (!*connection ||
+      !WriteTimeTables(connection->get(), *pending_vector, stats)) {
+    stats->write_fail_cnt += pending_vector->size();
+    // reconnect for the next batch
+    connection->reset();
+  }
+  pending_vector->clear();
+}
+
+bool BaseTimeTableDumper::LoadTimeTableIndex() {
+  string query_sql = (
+      "SELECT train_no,station_no,station_name,get_in_time,depart_time,"
+      "stay_time FROM train_time_table;"
   );
+  vector<TimeTable> time_table_vector;
+  if (!QueryTimeTableRows(query_sql, &time_table_vector)) {
+    return false;
+  }
+  Singleton<TimeTableIndexHolder>::get()->Reset(time_table_vector);
+  LOG(INFO) << "load time table index success, record count:"
+            << time_table_vector.size();
+  return true;
+}
+
+void BaseTimeTableDumper::RefreshTimeTableIndex(
+    const vector<string>& train_no_vector) {
+  TimeTableIndexHolder* index_holder = Singleton<TimeTableIndexHolder>::get();
+  if (!index_holder->is_loaded() || train_no_vector.empty()) {
+    return;
+  }
+  string query_sql = StringPrintf(
+      "SELECT train_no,station_no,station_name,get_in_time,depart_time,"
+      "stay_time FROM train_time_table WHERE train_no IN (%s);",
+      QuoteTrainNoList(train_no_vector).c_str());
+  vector<TimeTable> time_table_vector;
+  if (!QueryTimeTableRows(query_sql, &time_table_vector)) {
+    LOG(ERROR) << "refresh time table index failed, count:"
+               << train_no_vector.size();
+    return;
+  }
+  index_holder->Merge(train_no_vector, time_table_vector);
+}
+
+bool BaseTimeTableDumper::QueryTimeTableRows(
+    const string& query_sql, vector<TimeTable>* time_table_vector) {
   try {
     sql::Driver * driver = sql::mysql::get_driver_instance();
     std::shared_ptr<sql::Connection> connection(
-      driver->connect(mysql_server_->host(), 
-                      mysql_server_->user(), 
-                      mysql_server_->password()));
+        driver->connect(mysql_server_->host(), 
+                        mysql_server_->user(), 
+                        mysql_server_->password()));
     connection->setSchema(mysql_server_->database());
     std::shared_ptr<sql::Statement> statement(connection->createStatement());
-    string query_sql, insert_sql, update_sql;
-    for (auto it = time_table_vector.begin();
-        it != time_table_vector.end(); ++it) {
-      try {
-        query_sql = StringPrintf(query_format.c_str(),
-                                 table.c_str(),
-                                 it->train_no().c_str(),
-                                 it->station_no());
-        std::shared_ptr<sql::ResultSet> result_set(
-          statement->executeQuery(query_sql));
-        if (result_set->rowsCount() > 0) {
-          update_sql = StringPrintf(update_format.c_str(),
-                                    table.c_str(),
-                                    it->station_name().c_str(),
-                                    it->get_in_time().c_str(),
-                                    it->depart_time().c_str(),
-                                    it->stay_time().c_str(),
-                                    it->train_no().c_str(),
-                                    it->station_no());
-          statement->executeUpdate(update_sql); 
-        } else {
-          insert_sql = StringPrintf(insert_format.c_str(),
-                                    table.c_str(),
-                                    it->train_no().c_str(),
-                                    it->station_no(),
-                                    it->station_name().c_str(),
-                                    it->get_in_time().c_str(),
-                                    it->depart_time().c_str(),
-                                    it->stay_time().c_str());
-          statement->executeUpdate(insert_sql); 
-        }
-        continue;
-      } catch (const sql::SQLException &e) {
-        LOG(ERROR) << "# ERR: " << e.what()
-                   << " (MySQL error code: " << e.getErrorCode()
-                   << ", SQLState: " << e.getSQLState() << ")"; 
-        continue;
-      } catch (const std::runtime_error &e) {
-        LOG(ERROR) << "runtime error:" << e.what();
-        continue;
-      }
-    } 
+    std::shared_ptr<sql::ResultSet> result_set(
+      statement->executeQuery(query_sql));
+    while (result_set->next()) {
+      TimeTable time_table;
+      time_table.set_train_no(result_set->getString("train_no"));
+      time_table.set_station_no(
+          atoi(result_set->getString("station_no").c_str()));
+      time_table.set_station_name(result_set->getString("station_name"));
+      time_table.set_get_in_time(result_set->getString("get_in_time"));
+      time_table.set_depart_time(result_set->getString("depart_time"));
+      time_table.set_stay_time(result_set->getString("stay_time"));
+      time_table_vector->push_back(time_table);
+    }
   } catch (const sql::SQLException &e) {
     LOG(ERROR) << "# ERR: " << e.what()
                << " (MySQL error code: " << e.getErrorCode()
@@ -285,11 +633,11 @@ bool BaseTimeTableDumper::DumpResultIntoDb(
     LOG(ERROR) << "runtime error:" << e.what();
     return false;
   }
-  LOG(INFO) << "succeed in updating to db";
   return true;
 }
 
-CtripTimeTableDumper::CtripTimeTableDumper() {
+CtripTimeTableDumper::CtripTimeTableDumper()
+  : BaseTimeTableDumper(kSourceCtrip) {
   LOG(INFO) << "Construct CtripTimeTableDumper";
 }
 
@@ -347,7 +695,8 @@ bool CtripTimeTableDumper::FetchTimeTableByTrainNo(
 }
 
 
-BaiduTimeTableDumper::BaiduTimeTableDumper() {
+BaiduTimeTableDumper::BaiduTimeTableDumper()
+  : BaseTimeTableDumper(kSourceBaidu) {
   LOG(INFO) << "Construct BaiduTimeTableDumper";
 }
 
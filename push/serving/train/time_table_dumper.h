@@ -4,23 +4,77 @@
 #ifndef PUSH_SERVING_TRAIN_TIME_TABLE_DUMPER_H_
 #define PUSH_SERVING_TRAIN_TIME_TABLE_DUMPER_H_
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include "base/basictypes.h"
 #include "base/compat.h"
+#include "base/singleton.h"
 #include "proto/mysql_config.pb.h"
+#include "third_party/jsoncpp/json.h"
 
 #include "push/proto/train_meta.pb.h"
 #include "push/serving/train/train_data_fetcher.h"
 
+namespace sql {
+class Connection;
+}
+
 namespace train {
 
+struct TimeTableRefreshStats {
+  int train_cnt;
+  int fetch_fail_cnt;
+  int changed_cnt;
+  int write_fail_cnt;
+  int db_round_trip_cnt;
+  int64 elapsed_ms;
+  TimeTableRefreshStats()
+    : train_cnt(0), fetch_fail_cnt(0), changed_cnt(0), write_fail_cnt(0),
+      db_round_trip_cnt(0), elapsed_ms(0) {}
+  void Merge(const TimeTableRefreshStats& other);
+  void ToJson(Json::Value* value) const;
+};
+
+// What a train looks like in train_time_table, as last written or read.
+struct TimeTableContent {
+  uint64 content_hash;
+  int last_station_no;
+  TimeTableContent() : content_hash(0), last_station_no(0) {}
+};
+
+// Contents of the trains in train_time_table, shared by the dumpers of the
+// process so the bulk refresh and the per-train updates skip the same
+// unchanged trains.
+class TimeTableContentHolder {
+ public:
+  ~TimeTableContentHolder();
+  // Returns false if the train has not been loaded or written yet.
+  bool Get(const string& train_no, TimeTableContent* content);
+  void Set(const string& train_no, const TimeTableContent& content);
+  void Reset(std::unordered_map<string, TimeTableContent>* content_map);
+
+ private:
+  friend struct DefaultSingletonTraits<TimeTableContentHolder>;
+  TimeTableContentHolder();
+
+  std::mutex mutex_;
+  std::unordered_map<string, TimeTableContent> content_map_;
+  DISALLOW_COPY_AND_ASSIGN(TimeTableContentHolder);
+};
+
 class BaseTimeTableDumper {
  public:
-  BaseTimeTableDumper();
+  // data_source keys the crawl qps cap of TrainUpdateQueue.
+  explicit BaseTimeTableDumper(int data_source);
   ~BaseTimeTableDumper();
   void Init();
   bool UpdateTimeTable();
+  // Crawls every train with --time_table_refresh_thread_num workers and
+  // writes only the trains whose content changed.
+  bool UpdateTimeTable(TimeTableRefreshStats* stats);
   QueryStatus QueryTimeTable(const string& train_no, 
                              const string& depart_station,
                              vector<TimeTable>* time_table_vector);
@@ -28,7 +82,10 @@ class BaseTimeTableDumper {
   bool QueryAllTrainNo(vector<string>* result_vector);
   void FetchTimeTable(const vector<string>& result_vector,
                       vector<TimeTable>* time_table_vector);
+  // Writes the changed trains in time_table_vector in batched upserts.
   bool DumpResultIntoDb(const vector<TimeTable>& time_table_vector);
+  // Loads the whole train_time_table into the in-memory index.
+  bool LoadTimeTableIndex();
   virtual bool FetchTimeTableByTrainNo(
       const string& train_no, vector<TimeTable>* time_table_vector) = 0;
 
@@ -36,7 +93,37 @@ class BaseTimeTableDumper {
   std::unique_ptr<TrainDataFetcher> train_data_fetcher_;
 
  private:
+  QueryStatus QueryTimeTableFromDb(const string& train_no,
+                                   const string& depart_station,
+                                   vector<TimeTable>* time_table_vector);
+  bool QueryTimeTableRows(const string& query_sql,
+                          vector<TimeTable>* time_table_vector);
+  // Reloads the given trains from db into the index once it is loaded.
+  void RefreshTimeTableIndex(const vector<string>& train_no_vector);
+  void RefreshWorker(const vector<string>& trainno_vector,
+                     std::atomic<size_t>* next_index,
+                     TimeTableRefreshStats* stats);
+  // Loads the contents of the given trains from db into
+  // TimeTableContentHolder, all the trains if train_no_vector is empty.
+  bool LoadContent(const vector<string>& train_no_vector,
+                   TimeTableRefreshStats* stats);
+  sql::Connection* Connect(TimeTableRefreshStats* stats);
+  // Writes the changed trains in one transaction: one multi-row upsert
+  // on (train_no, station_no), then a delete of the stations beyond the
+  // new terminal of the trains whose route got shorter. The stations of
+  // every train are expected sorted by station_no.
+  bool WriteTimeTables(sql::Connection* connection,
+                       const vector<vector<TimeTable>>& train_vector,
+                       TimeTableRefreshStats* stats);
+  // Writes pending_vector if not empty and clears it, counting the
+  // failed trains in stats.
+  void FlushTimeTables(std::unique_ptr<sql::Connection>* connection,
+                       vector<vector<TimeTable>>* pending_vector,
+                       TimeTableRefreshStats* stats);
+
+  int data_source_;
   std::unique_ptr<MysqlServer> mysql_server_;
+  TimeTableContentHolder* content_holder_;
   DISALLOW_COPY_AND_ASSIGN(BaseTimeTableDumper);
 };
 
@@ -0,0 +1,214 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/serving/train/time_table_index.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "base/log.h"
+
+namespace {
+
+struct StationLess {
+  bool operator()(const train::TimeTable& left,
+                  const train::TimeTable& right) const {
+    if (left.train_no() != right.train_no()) {
+      return left.train_no() < right.train_no();
+    }
+    return left.station_no() < right.station_no();
+  }
+};
+
+}  // namespace
+
+namespace train {
+
+TimeTableShard::TimeTableShard(const vector<TimeTable>& time_table_vector)
+  : stations_(time_table_vector) {
+  std::stable_sort(stations_.begin(), stations_.end(), StationLess());
+  size_t begin = 0;
+  for (size_t i = 0; i < stations_.size(); ++i) {
+    const TimeTable& station = stations_[i];
+    if (i + 1 == stations_.size() ||
+        stations_[i + 1].train_no() != station.train_no()) {
+      train_range_map_[station.train_no()] = std::make_pair(begin, i + 1);
+      begin = i + 1;
+    }
+    // the first stop wins if a train passes a station twice
+    station_offset_map_.insert(std::make_pair(
+        StationKey(station.train_no(), station.station_name()), i));
+  }
+}
+
+TimeTableShard::~TimeTableShard() {}
+
+QueryStatus TimeTableShard::Query(const string& train_no,
+                                  const string& depart_station,
+                                  vector<TimeTable>* time_table_vector) const {
+  auto range_it = train_range_map_.find(train_no);
+  if (range_it == train_range_map_.end()) {
+    VLOG(1) << "Not found train in index. train_no:" << train_no;
+    return kNotFound;
+  }
+  auto offset_it = station_offset_map_.find(
+      StationKey(train_no, depart_station));
+  if (offset_it == station_offset_map_.end()) {
+    VLOG(1) << "Not found station in index. train_no:" << train_no
+            << ",station:" << depart_station;
+    return kNotFound;
+  }
+  time_table_vector->insert(time_table_vector->end(),
+                            stations_.begin() + offset_it->second,
+                            stations_.begin() + range_it->second.second);
+  return kSuccess;
+}
+
+void TimeTableShard::CopyExcept(const set<string>& train_no_set,
+                                vector<TimeTable>* time_table_vector) const {
+  for (auto& station : stations_) {
+    if (train_no_set.find(station.train_no()) == train_no_set.end()) {
+      time_table_vector->push_back(station);
+    }
+  }
+}
+
+string TimeTableShard::StationKey(const string& train_no,
+                                  const string& station_name) {
+  return train_no + "&" + station_name;
+}
+
+TimeTableIndex::TimeTableIndex()
+  : shards_(kShardNum), train_cnt_(0), station_cnt_(0) {}
+
+TimeTableIndex::TimeTableIndex(const vector<TimeTable>& time_table_vector)
+  : shards_(kShardNum), train_cnt_(0), station_cnt_(0) {
+  vector<vector<TimeTable>> shard_vectors(kShardNum);
+  for (auto& station : time_table_vector) {
+    shard_vectors[ShardIndex(station.train_no())].push_back(station);
+  }
+  for (size_t i = 0; i < kShardNum; ++i) {
+    shards_[i].reset(new TimeTableShard(shard_vectors[i]));
+  }
+  CountShards();
+}
+
+TimeTableIndex::~TimeTableIndex() {}
+
+QueryStatus TimeTableIndex::Query(const string& train_no,
+                                  const string& depart_station,
+                                  vector<TimeTable>* time_table_vector) const {
+  return shard(train_no)->Query(train_no, depart_station, time_table_vector);
+}
+
+std::shared_ptr<const TimeTableIndex> TimeTableIndex::Merge(
+    const vector<string>& train_no_vector,
+    const vector<TimeTable>& time_table_vector) const {
+  vector<set<string>> shard_train_sets(kShardNum);
+  vector<vector<TimeTable>> shard_vectors(kShardNum);
+  for (auto& train_no : train_no_vector) {
+    shard_train_sets[ShardIndex(train_no)].insert(train_no);
+  }
+  for (auto& station : time_table_vector) {
+    size_t shard_index = ShardIndex(station.train_no());
+    shard_train_sets[shard_index].insert(station.train_no());
+    shard_vectors[shard_index].push_back(station);
+  }
+  std::shared_ptr<TimeTableIndex> index(new TimeTableIndex());
+  size_t rebuilt_cnt = 0;
+  for (size_t i = 0; i < kShardNum; ++i) {
+    if (shard_train_sets[i].empty()) {
+      index->shards_[i] = shards_[i];
+      continue;
+    }
+    vector<TimeTable> merged_vector;
+    shards_[i]->CopyExcept(shard_train_sets[i], &merged_vector);
+    merged_vector.insert(merged_vector.end(), shard_vectors[i].begin(),
+                         shard_vectors[i].end());
+    index->shards_[i].reset(new TimeTableShard(merged_vector));
+    ++rebuilt_cnt;
+  }
+  index->CountShards();
+  VLOG(1) << "merge time table index, trains:" << train_no_vector.size()
+          << ", rebuilt shards:" << rebuilt_cnt;
+  return index;
+}
+
+size_t TimeTableIndex::ShardIndex(const string& train_no) {
+  return std::hash<string>()(train_no) % kShardNum;
+}
+
+void TimeTableIndex::CountShards() {
+  train_cnt_ = 0;
+  station_cnt_ = 0;
+  for (auto& shard : shards_) {
+    train_cnt_ += shard->train_count();
+    station_cnt_ += shard->station_count();
+  }
+}
+
+TimeTableIndexHolder::TimeTableIndexHolder()
+  : last_full_load_time_(0), last_update_time_(0), swap_cnt_(0) {
+  LOG(INFO) << "Construct TimeTableIndexHolder";
+}
+
+TimeTableIndexHolder::~TimeTableIndexHolder() {}
+
+std::shared_ptr<const TimeTableIndex> TimeTableIndexHolder::Get() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return index_;
+}
+
+void TimeTableIndexHolder::Reset(const vector<TimeTable>& time_table_vector) {
+  std::lock_guard<std::mutex> update_lock(update_mutex_);
+  std::shared_ptr<const TimeTableIndex> index(
+      new TimeTableIndex(time_table_vector));
+  Swap(index, true);
+}
+
+void TimeTableIndexHolder::Merge(const vector<string>& train_no_vector,
+                                 const vector<TimeTable>& time_table_vector) {
+  std::lock_guard<std::mutex> update_lock(update_mutex_);
+  std::shared_ptr<const TimeTableIndex> old_index = Get();
+  std::shared_ptr<const TimeTableIndex> index;
+  if (old_index) {
+    index = old_index->Merge(train_no_vector, time_table_vector);
+  } else {
+    index.reset(new TimeTableIndex(time_table_vector));
+  }
+  Swap(index, false);
+}
+
+bool TimeTableIndexHolder::is_loaded() {
+  return Get() != nullptr;
+}
+
+void TimeTableIndexHolder::GetStats(Json::Value* stats) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  (*stats)["loaded"] = index_ != nullptr;
+  (*stats)["train_cnt"] = static_cast<Json::UInt64>(
+      index_ ? index_->train_count() : 0);
+  (*stats)["station_cnt"] = static_cast<Json::UInt64>(
+      index_ ? index_->station_count() : 0);
+  (*stats)["last_full_load_time"] =
+      static_cast<Json::Int64>(last_full_load_time_);
+  (*stats)["last_update_time"] = static_cast<Json::Int64>(last_update_time_);
+  (*stats)["swap_cnt"] = static_cast<Json::UInt64>(swap_cnt_);
+}
+
+void TimeTableIndexHolder::Swap(std::shared_ptr<const TimeTableIndex> index,
+                                bool is_full) {
+  time_t now = time(NULL);
+  LOG(INFO) << "swap time table index, full:" << is_full
+            << ", train count:" << index->train_count()
+            << ", station count:" << index->station_count();
+  std::lock_guard<std::mutex> lock(mutex_);
+  index_.swap(index);
+  if (is_full) {
+    last_full_load_time_ = now;
+  }
+  last_update_time_ = now;
+  ++swap_cnt_;
+}
+
+}  // namespace train
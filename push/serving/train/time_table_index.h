@@ -0,0 +1,122 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#ifndef PUSH_SERVING_TRAIN_TIME_TABLE_INDEX_H_
+#define PUSH_SERVING_TRAIN_TIME_TABLE_INDEX_H_
+
+#include <time.h>
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "base/basictypes.h"
+#include "base/compat.h"
+#include "base/singleton.h"
+#include "third_party/jsoncpp/json.h"
+
+#include "push/proto/train_meta.pb.h"
+
+namespace train {
+
+// Stations of the trains hashed into one shard of TimeTableIndex. The
+// stations of every train are stored contiguously ordered by station_no,
+// so a query is two hash lookups and a copy of the remaining stations.
+class TimeTableShard {
+ public:
+  explicit TimeTableShard(const vector<TimeTable>& time_table_vector);
+  ~TimeTableShard();
+  // Stations from depart_station to the terminal, same as the db query.
+  QueryStatus Query(const string& train_no, const string& depart_station,
+                    vector<TimeTable>* time_table_vector) const;
+  // Appends the stations of every train not in train_no_set.
+  void CopyExcept(const set<string>& train_no_set,
+                  vector<TimeTable>* time_table_vector) const;
+  size_t train_count() const {
+    return train_range_map_.size();
+  }
+  size_t station_count() const {
+    return stations_.size();
+  }
+
+ private:
+  static string StationKey(const string& train_no,
+                           const string& station_name);
+
+  vector<TimeTable> stations_;
+  // train_no -> [begin, end) in stations_
+  std::unordered_map<string, std::pair<size_t, size_t>> train_range_map_;
+  // train_no&station_name -> offset in stations_
+  std::unordered_map<string, size_t> station_offset_map_;
+  DISALLOW_COPY_AND_ASSIGN(TimeTableShard);
+};
+
+// Read-only snapshot of train_time_table, the trains are hashed into
+// kShardNum shards. An update rebuilds only the shards of the changed
+// trains, the others are shared with the previous snapshot.
+class TimeTableIndex {
+ public:
+  static const size_t kShardNum = 64;
+
+  explicit TimeTableIndex(const vector<TimeTable>& time_table_vector);
+  ~TimeTableIndex();
+  QueryStatus Query(const string& train_no, const string& depart_station,
+                    vector<TimeTable>* time_table_vector) const;
+  // A new snapshot with the stations of the given trains replaced.
+  std::shared_ptr<const TimeTableIndex> Merge(
+      const vector<string>& train_no_vector,
+      const vector<TimeTable>& time_table_vector) const;
+  // The shard holding train_no, shared by the snapshots it did not change.
+  const TimeTableShard* shard(const string& train_no) const {
+    return shards_[ShardIndex(train_no)].get();
+  }
+  size_t train_count() const {
+    return train_cnt_;
+  }
+  size_t station_count() const {
+    return station_cnt_;
+  }
+
+ private:
+  TimeTableIndex();
+  static size_t ShardIndex(const string& train_no);
+  void CountShards();
+
+  vector<std::shared_ptr<const TimeTableShard>> shards_;
+  size_t train_cnt_;
+  size_t station_cnt_;
+  DISALLOW_COPY_AND_ASSIGN(TimeTableIndex);
+};
+
+// Holds the current index of the process. Readers take a reference to the
+// snapshot and never block the writer, which swaps in a rebuilt index
+// after the timetable in db has been updated.
+class TimeTableIndexHolder {
+ public:
+  ~TimeTableIndexHolder();
+  std::shared_ptr<const TimeTableIndex> Get();
+  // Replaces the whole index.
+  void Reset(const vector<TimeTable>& time_table_vector);
+  // Replaces the stations of the given trains, keeping the others.
+  void Merge(const vector<string>& train_no_vector,
+             const vector<TimeTable>& time_table_vector);
+  bool is_loaded();
+  void GetStats(Json::Value* stats);
+
+ private:
+  friend struct DefaultSingletonTraits<TimeTableIndexHolder>;
+  TimeTableIndexHolder();
+  void Swap(std::shared_ptr<const TimeTableIndex> index, bool is_full);
+
+  std::mutex mutex_;
+  std::mutex update_mutex_;  // serializes Reset and Merge
+  std::shared_ptr<const TimeTableIndex> index_;
+  time_t last_full_load_time_;
+  time_t last_update_time_;
+  uint64 swap_cnt_;
+  DISALLOW_COPY_AND_ASSIGN(TimeTableIndexHolder);
+};
+
+}  // namespace train
+
+#endif  // PUSH_SERVING_TRAIN_TIME_TABLE_INDEX_H_
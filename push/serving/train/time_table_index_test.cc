@@ -0,0 +1,73 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "third_party/gtest/gtest.h"
+#include "push/serving/train/time_table_index.h"
+
+using namespace train;
+
+namespace {
+
+TimeTable MakeStation(const string& train_no, int station_no,
+                      const string& station_name) {
+  TimeTable time_table;
+  time_table.set_train_no(train_no);
+  time_table.set_station_no(station_no);
+  time_table.set_station_name(station_name);
+  return time_table;
+}
+
+}  // namespace
+
+TEST(TimeTableIndexTest, QueryFromDepartStation) {
+  vector<TimeTable> time_table_vector;
+  time_table_vector.push_back(MakeStation("G1", 3, "nanjing"));
+  time_table_vector.push_back(MakeStation("D5", 1, "shanghai"));
+  time_table_vector.push_back(MakeStation("G1", 1, "beijing"));
+  time_table_vector.push_back(MakeStation("G1", 2, "jinan"));
+  TimeTableIndex index(time_table_vector);
+  EXPECT_EQ(2u, index.train_count());
+  EXPECT_EQ(4u, index.station_count());
+
+  vector<TimeTable> result;
+  EXPECT_EQ(kSuccess, index.Query("G1", "jinan", &result));
+  ASSERT_EQ(2u, result.size());
+  EXPECT_EQ("jinan", result[0].station_name());
+  EXPECT_EQ("nanjing", result[1].station_name());
+
+  result.clear();
+  EXPECT_EQ(kNotFound, index.Query("G1", "shanghai", &result));
+  EXPECT_EQ(kNotFound, index.Query("G2", "beijing", &result));
+  EXPECT_TRUE(result.empty());
+}
+
+TEST(TimeTableIndexHolderTest, MergeReplacesTrains) {
+  TimeTableIndexHolder* holder = Singleton<TimeTableIndexHolder>::get();
+  vector<TimeTable> time_table_vector;
+  time_table_vector.push_back(MakeStation("G1", 1, "beijing"));
+  time_table_vector.push_back(MakeStation("G1", 2, "jinan"));
+  time_table_vector.push_back(MakeStation("D5", 1, "shanghai"));
+  holder->Reset(time_table_vector);
+  std::shared_ptr<const TimeTableIndex> old_index = holder->Get();
+
+  vector<TimeTable> update_vector;
+  update_vector.push_back(MakeStation("G1", 1, "tianjin"));
+  update_vector.push_back(MakeStation("K9", 1, "wuhan"));
+  holder->Merge({"G1", "K9"}, update_vector);
+
+  vector<TimeTable> result;
+  std::shared_ptr<const TimeTableIndex> index = holder->Get();
+  EXPECT_EQ(kNotFound, index->Query("G1", "beijing", &result));
+  EXPECT_EQ(kSuccess, index->Query("G1", "tianjin", &result));
+  EXPECT_EQ(kSuccess, index->Query("D5", "shanghai", &result));
+  EXPECT_EQ(kSuccess, index->Query("K9", "wuhan", &result));
+  // readers holding the old snapshot are not affected by the swap
+  EXPECT_EQ(kSuccess, old_index->Query("G1", "beijing", &result));
+  // only the shards of the merged trains are rebuilt
+  EXPECT_NE(old_index->shard("G1"), index->shard("G1"));
+  if (index->shard("D5") != index->shard("G1") &&
+      index->shard("D5") != index->shard("K9")) {
+    EXPECT_EQ(old_index->shard("D5"), index->shard("D5"));
+  }
+  EXPECT_EQ(3u, index->train_count());
+}
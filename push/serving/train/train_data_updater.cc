@@ -3,17 +3,17 @@
 
 #include "push/serving/train/train_data_updater.h"
 
+#include <chrono>
+
 #include "base/log.h"
 
 DECLARE_int32(data_source);
 
 namespace train {
 
-TrainDataUpdater::TrainDataUpdater(
-    std::shared_ptr<ConcurrentQueue<string>> queue) 
-  : Thread(false) {
+TrainDataUpdater::TrainDataUpdater(TrainUpdateQueue* queue)
+  : Thread(false), train_update_queue_(queue) {
   LOG(INFO) << "construct TrainDataUpdater";
-  train_no_queue_ = queue;
   if (FLAGS_data_source == kSourceCtrip) {
     time_table_dumper_.reset(new CtripTimeTableDumper());
   } else {
@@ -25,16 +25,23 @@ TrainDataUpdater::~TrainDataUpdater() {}
 
 void TrainDataUpdater::Run() {
   LOG(INFO) << "start thread TrainDataUpdater";
-  while (true) {
-    string train_no;
-    train_no_queue_->Pop(train_no);
-    if (!UpdateTrainInfoByTrainNo(train_no)) {
+  string train_no;
+  while (train_update_queue_->Pop(&train_no)) {
+    train_update_queue_->AcquireFetchQuota(FLAGS_data_source);
+    auto start = std::chrono::steady_clock::now();
+    bool success = UpdateTrainInfoByTrainNo(train_no);
+    int64 latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    if (!success) {
       LOG(ERROR) << "update train info by train_no failed, train_no:"
                   << train_no;
     } else {
-      LOG(INFO) << "update train info success, train_no:" << train_no;
+      LOG(INFO) << "update train info success, train_no:" << train_no
+                << ", latency_ms:" << latency_ms;
     }
+    train_update_queue_->Done(train_no, success, latency_ms);
   }
+  LOG(INFO) << "stop thread TrainDataUpdater";
 }
 
 bool TrainDataUpdater::UpdateTrainInfoByTrainNo(const string& train_no) {
@@ -6,17 +6,19 @@
 
 #include "base/compat.h"
 #include "base/thread.h"
-#include "base/concurrent_queue.h"
 
 #include "push/serving/train/time_table_dumper.h"
+#include "push/serving/train/train_update_queue.h"
 
 namespace train {
 
 using namespace mobvoi;
 
+// One crawler worker, --train_update_thread_num of them share the
+// TrainUpdateQueue.
 class TrainDataUpdater : public Thread {
  public:
-  TrainDataUpdater(std::shared_ptr<ConcurrentQueue<string>> queue);
+  explicit TrainDataUpdater(TrainUpdateQueue* queue);
   virtual ~TrainDataUpdater();
   virtual void Run();
 
@@ -24,7 +26,7 @@ class TrainDataUpdater : public Thread {
   bool UpdateTrainInfoByTrainNo(const string& train_no);
   
   std::unique_ptr<BaseTimeTableDumper> time_table_dumper_;
-  std::shared_ptr<ConcurrentQueue<string>> train_no_queue_;
+  TrainUpdateQueue* train_update_queue_;
   DISALLOW_COPY_AND_ASSIGN(TrainDataUpdater);
 };
 
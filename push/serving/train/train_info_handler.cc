@@ -8,9 +8,12 @@
 #include "third_party/jsoncpp/json.h"
 #include "util/net/util.h"
 
+#include "push/serving/train/time_table_index.h"
+#include "push/serving/train/train_update_queue.h"
 #include "push/util/common_util.h"
 
 DECLARE_int32(data_source);
+DECLARE_int32(train_update_thread_num);
 DECLARE_string(trainno_template_format);
 
 namespace {
@@ -35,9 +38,15 @@ TimeTableQueryHandler::TimeTableQueryHandler() {
   } else {
     time_table_dumper_.reset(new BaiduTimeTableDumper());
   }
-  train_no_queue_ = std::make_shared<ConcurrentQueue<string>>();
-  train_data_updater_.reset(new TrainDataUpdater(train_no_queue_));
-  train_data_updater_->Start();
+  if (!time_table_dumper_->LoadTimeTableIndex()) {
+    LOG(ERROR) << "load time table index failed, query from db instead";
+  }
+  train_update_queue_ = Singleton<TrainUpdateQueue>::get();
+  for (int i = 0; i < FLAGS_train_update_thread_num; ++i) {
+    train_data_updaters_.emplace_back(
+        new TrainDataUpdater(train_update_queue_));
+    train_data_updaters_.back()->Start();
+  }
 }
 
 TimeTableQueryHandler::~TimeTableQueryHandler() {}
@@ -67,7 +76,7 @@ bool TimeTableQueryHandler::HandleRequest(util::HttpRequest* request,
     } else if (status == kNotFound) {
       LOG(ERROR) << "not found, train_no:" << train_no 
                  << ",depart_station:" << depart_station;
-      train_no_queue_->Push(train_no);
+      train_update_queue_->Push(train_no);
     } else {
       LOG(ERROR) << "err occurred, train_no:" << train_no 
                  << ",depart_station:" << depart_station;
@@ -128,9 +137,11 @@ TimeTableUpdateHandler::~TimeTableUpdateHandler() {}
 bool TimeTableUpdateHandler::HandleRequest(util::HttpRequest* request,
                                            util::HttpResponse* response) {
   LOG(INFO)<< "Receive TimeTableUpdateHandler request";
-  bool success = time_table_dumper_->UpdateTimeTable();
+  TimeTableRefreshStats stats;
+  bool success = time_table_dumper_->UpdateTimeTable(&stats);
   response->SetJsonContentType();
   Json::Value value;
+  stats.ToJson(&value["stats"]);
   LOG(INFO)<< "TimeTableUpdateHandler update finished";
   if (success) {
     value["status"] = kSuccessText;
@@ -196,6 +207,10 @@ bool StatusHandler::HandleRequest(util::HttpRequest* request,
   result["status"] = kOkText;
   result["host"] = util::GetLocalHostName();
   result["service"] = kServiceName;
+  Singleton<TimeTableIndexHolder>::get()->GetStats(
+      &result["time_table_index"]);
+  Singleton<TrainUpdateQueue>::get()->GetStats(
+      &result["train_update_queue"]);
   response->AppendBuffer(result.toStyledString());
   return true;
 }
@@ -5,7 +5,6 @@
 #define PUSH_SERVING_TRAIN_TRAIN_INFO_HANDLER_H_
 
 #include "base/compat.h"
-#include "base/concurrent_queue.h"
 #include "onebox/http_handler.h"
 #include "util/net/http_server/http_request.h"
 #include "util/net/http_server/http_response.h"
@@ -31,8 +30,8 @@ class TimeTableQueryHandler : public HttpRequestHandler {
   string ResponseInfo(const vector<TimeTable>& time_table_vector);
  
   std::unique_ptr<BaseTimeTableDumper> time_table_dumper_;
-  std::unique_ptr<TrainDataUpdater> train_data_updater_;
-  std::shared_ptr<ConcurrentQueue<string>> train_no_queue_;
+  vector<std::unique_ptr<TrainDataUpdater>> train_data_updaters_;
+  TrainUpdateQueue* train_update_queue_;
   DISALLOW_COPY_AND_ASSIGN(TimeTableQueryHandler);
 };
 
@@ -13,6 +13,12 @@
 DEFINE_int32(listen_port, 9039, "");
 DEFINE_int32(http_server_thread_num, 8, "");
 DEFINE_int32(data_source, 1, "time table data source, 1:ctrip, 2:baidu");
+DEFINE_int32(time_table_refresh_thread_num, 8,
+  "time table bulk refresh crawler thread number");
+DEFINE_int32(train_update_thread_num, 4, "time table crawler thread number");
+DEFINE_int32(train_crawl_qps, 2, "time table crawl qps cap per data source");
+DEFINE_int32(train_refresh_window, 600,
+  "seconds a crawled train is not crawled again");
 
 DEFINE_string(mysql_config,
   "config/push/train/mysql_server.conf", "");
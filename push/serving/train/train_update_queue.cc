@@ -0,0 +1,141 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/serving/train/train_update_queue.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "base/log.h"
+#include "third_party/gflags/gflags.h"
+
+DECLARE_int32(train_crawl_qps);
+DECLARE_int32(train_refresh_window);
+
+namespace train {
+
+TrainUpdateQueue::TrainUpdateQueue()
+  : shut_down_(false),
+    in_flight_cnt_(0),
+    push_cnt_(0),
+    dedup_cnt_(0),
+    suppressed_cnt_(0),
+    crawl_cnt_(0),
+    crawl_fail_cnt_(0),
+    total_latency_ms_(0),
+    max_latency_ms_(0),
+    last_latency_ms_(0) {
+  LOG(INFO) << "Construct TrainUpdateQueue";
+}
+
+TrainUpdateQueue::~TrainUpdateQueue() {}
+
+bool TrainUpdateQueue::Push(const string& train_no) {
+  time_t now = time(NULL);
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++push_cnt_;
+  if (queued_set_.find(train_no) != queued_set_.end()) {
+    ++dedup_cnt_;
+    VLOG(1) << "train already queued, train_no:" << train_no;
+    return false;
+  }
+  auto it = refreshed_map_.find(train_no);
+  if (it != refreshed_map_.end() &&
+      it->second + FLAGS_train_refresh_window > now) {
+    ++suppressed_cnt_;
+    VLOG(1) << "train refreshed recently, train_no:" << train_no;
+    return false;
+  }
+  queued_set_.insert(train_no);
+  pending_queue_.push_back(train_no);
+  cond_.notify_one();
+  return true;
+}
+
+bool TrainUpdateQueue::Pop(string* train_no) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait(lock, [this] { return shut_down_ || !pending_queue_.empty(); });
+  if (shut_down_) {
+    return false;
+  }
+  *train_no = pending_queue_.front();
+  pending_queue_.pop_front();
+  ++in_flight_cnt_;
+  return true;
+}
+
+void TrainUpdateQueue::Done(const string& train_no, bool success,
+                            int64 latency_ms) {
+  time_t now = time(NULL);
+  std::lock_guard<std::mutex> lock(mutex_);
+  queued_set_.erase(train_no);
+  --in_flight_cnt_;
+  // failed crawls are suppressed as well, the source is unlikely to
+  // have the train a moment later
+  refreshed_map_[train_no] = now;
+  ++crawl_cnt_;
+  if (!success) {
+    ++crawl_fail_cnt_;
+  }
+  total_latency_ms_ += latency_ms;
+  max_latency_ms_ = std::max(max_latency_ms_, latency_ms);
+  last_latency_ms_ = latency_ms;
+  PruneRefreshedLocked(now);
+}
+
+void TrainUpdateQueue::AcquireFetchQuota(int data_source) {
+  if (FLAGS_train_crawl_qps <= 0) {
+    return;
+  }
+  std::chrono::steady_clock::time_point fetch_slot;
+  {
+    std::lock_guard<std::mutex> lock(quota_mutex_);
+    auto now = std::chrono::steady_clock::now();
+    auto it = next_fetch_slot_map_.find(data_source);
+    if (it == next_fetch_slot_map_.end() || it->second < now) {
+      next_fetch_slot_map_[data_source] = now;
+    }
+    fetch_slot = next_fetch_slot_map_[data_source];
+    next_fetch_slot_map_[data_source] += std::chrono::microseconds(
+        1000000 / FLAGS_train_crawl_qps);
+  }
+  std::this_thread::sleep_until(fetch_slot);
+}
+
+void TrainUpdateQueue::ShutDown() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  shut_down_ = true;
+  cond_.notify_all();
+}
+
+void TrainUpdateQueue::GetStats(Json::Value* stats) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  (*stats)["pending_cnt"] = static_cast<Json::UInt64>(pending_queue_.size());
+  (*stats)["in_flight_cnt"] = static_cast<Json::UInt64>(in_flight_cnt_);
+  (*stats)["push_cnt"] = static_cast<Json::UInt64>(push_cnt_);
+  (*stats)["dedup_cnt"] = static_cast<Json::UInt64>(dedup_cnt_);
+  (*stats)["suppressed_cnt"] = static_cast<Json::UInt64>(suppressed_cnt_);
+  (*stats)["crawl_cnt"] = static_cast<Json::UInt64>(crawl_cnt_);
+  (*stats)["crawl_fail_cnt"] = static_cast<Json::UInt64>(crawl_fail_cnt_);
+  (*stats)["crawl_avg_latency_ms"] = static_cast<Json::Int64>(
+      crawl_cnt_ > 0 ? total_latency_ms_ / static_cast<int64>(crawl_cnt_) : 0);
+  (*stats)["crawl_max_latency_ms"] = static_cast<Json::Int64>(max_latency_ms_);
+  (*stats)["crawl_last_latency_ms"] =
+      static_cast<Json::Int64>(last_latency_ms_);
+}
+
+void TrainUpdateQueue::PruneRefreshedLocked(time_t now) {
+  static const size_t kPruneThreshold = 10000;
+  if (refreshed_map_.size() < kPruneThreshold) {
+    return;
+  }
+  for (auto it = refreshed_map_.begin(); it != refreshed_map_.end();) {
+    if (it->second + FLAGS_train_refresh_window <= now) {
+      it = refreshed_map_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+}  // namespace train
@@ -0,0 +1,71 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#ifndef PUSH_SERVING_TRAIN_TRAIN_UPDATE_QUEUE_H_
+#define PUSH_SERVING_TRAIN_TRAIN_UPDATE_QUEUE_H_
+
+#include <time.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "base/basictypes.h"
+#include "base/compat.h"
+#include "base/singleton.h"
+#include "third_party/jsoncpp/json.h"
+
+namespace train {
+
+// Deduplicating set of train numbers waiting to be crawled. A train_no is
+// held at most once while pending or in flight, and is not queued again
+// within --train_refresh_window seconds after its last crawl.
+class TrainUpdateQueue {
+ public:
+  ~TrainUpdateQueue();
+  // Returns false if the train is already queued or recently refreshed.
+  bool Push(const string& train_no);
+  // Blocks until a train is pending, returns false after ShutDown.
+  bool Pop(string* train_no);
+  // Marks the crawl of a popped train as finished.
+  void Done(const string& train_no, bool success, int64 latency_ms);
+  // Blocks until the qps cap of the data source allows one more crawl.
+  void AcquireFetchQuota(int data_source);
+  void ShutDown();
+  void GetStats(Json::Value* stats);
+
+ private:
+  friend struct DefaultSingletonTraits<TrainUpdateQueue>;
+  TrainUpdateQueue();
+  void PruneRefreshedLocked(time_t now);
+
+  bool shut_down_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<string> pending_queue_;
+  // pending or in flight
+  std::unordered_set<string> queued_set_;
+  size_t in_flight_cnt_;
+  // train_no -> time of its last finished crawl
+  std::unordered_map<string, time_t> refreshed_map_;
+  uint64 push_cnt_;
+  uint64 dedup_cnt_;
+  uint64 suppressed_cnt_;
+  uint64 crawl_cnt_;
+  uint64 crawl_fail_cnt_;
+  int64 total_latency_ms_;
+  int64 max_latency_ms_;
+  int64 last_latency_ms_;
+
+  std::mutex quota_mutex_;
+  // data source -> earliest time of its next crawl
+  map<int, std::chrono::steady_clock::time_point> next_fetch_slot_map_;
+  DISALLOW_COPY_AND_ASSIGN(TrainUpdateQueue);
+};
+
+}  // namespace train
+
+#endif  // PUSH_SERVING_TRAIN_TRAIN_UPDATE_QUEUE_H_
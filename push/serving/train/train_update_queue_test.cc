@@ -0,0 +1,43 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/serving/train/train_update_queue.h"
+#include "third_party/gtest/gtest.h"
+#include "third_party/gflags/gflags.h"
+
+DEFINE_int32(train_crawl_qps, 0, "time table crawl qps cap per data source");
+DEFINE_int32(train_refresh_window, 600,
+  "seconds a crawled train is not crawled again");
+
+using namespace train;
+
+TEST(TrainUpdateQueueTest, DedupAndSuppressRecentlyRefreshed) {
+  TrainUpdateQueue* queue = Singleton<TrainUpdateQueue>::get();
+  EXPECT_TRUE(queue->Push("G1"));
+  EXPECT_FALSE(queue->Push("G1"));
+  EXPECT_TRUE(queue->Push("D5"));
+
+  string train_no;
+  ASSERT_TRUE(queue->Pop(&train_no));
+  EXPECT_EQ("G1", train_no);
+  // still in flight
+  EXPECT_FALSE(queue->Push("G1"));
+  queue->Done(train_no, true, 10);
+  // refreshed within the window
+  EXPECT_FALSE(queue->Push("G1"));
+
+  ASSERT_TRUE(queue->Pop(&train_no));
+  EXPECT_EQ("D5", train_no);
+  queue->Done(train_no, false, 30);
+
+  Json::Value stats;
+  queue->GetStats(&stats);
+  EXPECT_EQ(0u, stats["pending_cnt"].asUInt64());
+  EXPECT_EQ(2u, stats["dedup_cnt"].asUInt64());
+  EXPECT_EQ(1u, stats["suppressed_cnt"].asUInt64());
+  EXPECT_EQ(1u, stats["crawl_fail_cnt"].asUInt64());
+  EXPECT_EQ(30, stats["crawl_max_latency_ms"].asInt64());
+
+  queue->ShutDown();
+  EXPECT_FALSE(queue->Pop(&train_no));
+}
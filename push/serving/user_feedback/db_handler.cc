@@ -3,12 +3,9 @@
 
 #include "push/serving/user_feedback/db_handler.h"
 
-#include <sstream>
-#include <string>
-#include <vector>
-#include <memory>
+#include <algorithm>
+#include <functional>
 
-#include "base/compat.h"
 #include "base/file/proto_util.h"
 #include "base/log.h"
 #include "base/string_util.h"
@@ -21,191 +18,310 @@
 #include "third_party/mysql_client_cpp/include/cppconn/statement.h"
 
 #include "push/proto/user_feedback_meta.pb.h"
+#include "push/util/common_util.h"
 
 DECLARE_string(mysql_config);
 
 namespace {
 
 static const char kTable[] = "user_feedback";
-static const char kQueryFormat[] = (
-    "SELECT user_feedback_status FROM %s "
-    "WHERE user_id='%s' AND business_type='%d';"
-);
-static const char kInsertFormat[] = (
+// one round trip for all the business types of a task, the primary key
+// is (user_id, business_type)
+static const char kUpsertFormat[] = (
     "INSERT INTO %s (user_id,business_type,user_feedback_status) "
-    "VALUES('%s','%d','%d');"
-);
-static const char kUpdateFormat[] = (
-    "UPDATE %s SET user_feedback_status='%d' "
-    "WHERE user_id='%s' AND business_type='%d';"
+    "VALUES %s ON DUPLICATE KEY UPDATE "
+    "user_feedback_status=VALUES(user_feedback_status);"
 );
-static const char kQueryFeedbackFormat[] = (
-    "SELECT business_type,user_feedback_status FROM %s "
-    "WHERE user_id='%s';"
+static const char kValueFormat[] = "('%s','%d','%d')";
+static const char kLoadFormat[] = (
+    "SELECT user_id,business_type,user_feedback_status FROM %s;"
 );
+static const int kShardNum = 64;
+static const int kMaxRetrySleepSeconds = 32;
+static const int kParseErrorCode = 1064;  // ER_PARSE_ERROR
+
+using push_controller::EscapeSqlString;
+
+// Data exceptions (22xxx), constraint violations (23xxx) and syntax errors
+// come from the statement itself, retrying them can never succeed.
+bool IsRetryableError(const sql::SQLException& e) {
+  const string& state = e.getSQLState();
+  return e.getErrorCode() != kParseErrorCode &&
+         state.compare(0, 2, "22") != 0 && state.compare(0, 2, "23") != 0;
+}
 
 }
 
 namespace feedback {
 
-DbHandler::DbHandler() {
-  LOG(INFO) << "Construct DbHandler";
-  Init();
-}
+UserFeedbackWriter::UserFeedbackWriter(
+    const MysqlServer& mysql_server,
+    mobvoi::ConcurrentQueue<UserFeedbackWriteTask>* queue)
+  : Thread(false),
+    mysql_server_(mysql_server),
+    write_queue_(queue),
+    write_cnt_(0),
+    write_fail_cnt_(0),
+    write_drop_cnt_(0) {}
 
-DbHandler::~DbHandler() {}
+UserFeedbackWriter::~UserFeedbackWriter() {}
 
-void DbHandler::Init() {
-  mysql_server_.reset(new MysqlServer());
-  CHECK(file::ReadProtoFromTextFile(FLAGS_mysql_config, mysql_server_.get()));
-  LOG(INFO) << "init mysql config from file:" << FLAGS_mysql_config;
+void UserFeedbackWriter::Run() {
+  LOG(INFO) << "start thread UserFeedbackWriter";
+  while (true) {
+    UserFeedbackWriteTask task;
+    write_queue_->Pop(task);
+    // the memory is already updated and acknowledged, so a task is only
+    // dropped when db rejects its content: otherwise it is retried until
+    // db takes it, and the later tasks wait behind it to keep the writes
+    // in order
+    int sleep_seconds = 1;
+    bool is_retryable = true;
+    while (!Write(task, &is_retryable)) {
+      ++write_fail_cnt_;
+      if (!is_retryable) {
+        break;
+      }
+      LOG(ERROR) << "write user feedback to db failed, user_id:"
+                 << task.user_id << ", retry in " << sleep_seconds << "s";
+      mobvoi::Sleep(sleep_seconds);
+      sleep_seconds = std::min(sleep_seconds * 2, kMaxRetrySleepSeconds);
+    }
+    if (!is_retryable) {
+      ++write_drop_cnt_;
+      LOG(ERROR) << "drop user feedback rejected by db, user_id:"
+                 << task.user_id << ", business type count:"
+                 << task.feedback_map.size();
+      continue;
+    }
+    ++write_cnt_;
+  }
 }
 
-bool DbHandler::InsertUserFeedback(UserFeedbackRequest *request,
-                                   UserFeedbackResponse *response) {
-  LOG(INFO) << "InsertUserFeedback";
+bool UserFeedbackWriter::Write(const UserFeedbackWriteTask& task,
+                               bool* is_retryable) {
+  *is_retryable = true;
   try {
-    sql::Driver* driver = sql::mysql::get_driver_instance();
-    std::shared_ptr< sql::Connection > connection(
-        driver->connect(mysql_server_->host(), 
-                        mysql_server_->user(), 
-                        mysql_server_->password()));
-    connection->setSchema(mysql_server_->database());
-    std::shared_ptr< sql::Statement > statement(connection->createStatement());
-   
-    const string& user_id = request->user_id();
-    for (int index = 0; index < request->data_list_size(); ++index) {
-      BusinessType business_type = request->data_list(index).business_type();
-      bool user_feedback_status = (
-          request->data_list(index).user_feedback_status());
-      string query_sql = StringPrintf(kQueryFormat, 
-                                      kTable, 
-                                      user_id.c_str(),
-                                      static_cast<int>(business_type));
-      string insert_sql = StringPrintf(kInsertFormat,
-                                       kTable,
-                                       user_id.c_str(),
-                                       business_type,
-                                       static_cast<int>(user_feedback_status));
-      string update_sql = StringPrintf(kUpdateFormat,
-                                       kTable,
-                                       static_cast<int>(user_feedback_status),
-                                       user_id.c_str(),
-                                       static_cast<int>(business_type));
-      LOG(INFO) << "query_sql:" << query_sql;
-      LOG(INFO) << "insert_sql:" << insert_sql;
-      LOG(INFO) << "update_sql:" << update_sql;
-      std::shared_ptr< sql::ResultSet > result_set(
-          statement->executeQuery(query_sql));
-      vector<string> result_vec; 
-      while (result_set->next()) {
-        string result = result_set->getString("user_feedback_status");
-        if (!result.empty()) {
-          result_vec.push_back(result);
-        }
-      }  
-      if (!result_vec.empty()) {
-        if (result_vec.size() == 1) {
-          statement->executeUpdate(update_sql);
-          LOG(INFO) << "do update (user_id: " << user_id 
-                    << ", business_type: " << business_type << ")";
-        } else {
-          LOG(ERROR) << "query result cnt should not exceed 1";
-          response->set_response_reason("too much result");
-          return false;
-        } 
-      } else {
-        statement->executeUpdate(insert_sql);
-        LOG(INFO) << "do insert (user_id: " << user_id 
-                  << ", business_type: " << business_type << ")";
-      }
-      UserFeedbackResponse_DataList* data_list = response->add_data_list();
-      data_list->set_business_type(business_type);
-      data_list->set_response_status(true);
+    if (!connection_ || connection_->isClosed()) {
+      sql::Driver* driver = sql::mysql::get_driver_instance();
+      connection_.reset(driver->connect(mysql_server_.host(),
+                                        mysql_server_.user(),
+                                        mysql_server_.password()));
+      connection_->setSchema(mysql_server_.database());
+    }
+    std::unique_ptr<sql::Statement> statement(connection_->createStatement());
+    const string& user_id = task.user_id;
+    string escaped_user_id = EscapeSqlString(user_id);
+    vector<string> value_vector;
+    for (auto& feedback : task.feedback_map) {
+      value_vector.push_back(StringPrintf(kValueFormat,
+                                          escaped_user_id.c_str(),
+                                          feedback.first,
+                                          static_cast<int>(feedback.second)));
     }
-    statement.reset();
+    statement->executeUpdate(StringPrintf(
+        kUpsertFormat, kTable, JoinString(value_vector, ',').c_str()));
+    VLOG(1) << "write user feedback, user_id:" << user_id
+            << ", business type count:" << value_vector.size();
   } catch (const sql::SQLException &e) {
     LOG(ERROR) << "# ERR: " << e.what()
                << " (MySQL error code: " << e.getErrorCode()
                << ", SQLState: " << e.getSQLState() << ")"; 
-    response->set_response_reason(e.what());
+    *is_retryable = IsRetryableError(e);
+    connection_.reset();
     return false;
   } catch (const std::runtime_error &e) {
     LOG(ERROR) << "# ERR: " << e.what();
-    response->set_response_reason(e.what());
+    connection_.reset();
     return false;
   }
-  response->set_user_id(request->user_id());
-  response->set_status(kSuccess);
-  response->set_err_msg("");
-  response->set_response_reason("update ok");
-  LOG(INFO) << "InsertUserFeedback update to db success";
   return true;
 }
 
-bool DbHandler::QueryUserFeedback(UserFeedbackQueryResquest *request,
-                                  UserFeedbackQueryResponse *response) {
-  LOG(INFO) << "QueryUserFeedback";
-  const string& user_id = request->user_id();
-  string query_sql = StringPrintf(kQueryFeedbackFormat,
-                                  kTable,
-                                  user_id.c_str());
-  LOG(INFO) << "query_sql:" << query_sql;
+UserFeedbackStore::UserFeedbackStore() : is_inited_(false) {
+  LOG(INFO) << "Construct UserFeedbackStore";
+  for (int i = 0; i < kShardNum; ++i) {
+    shards_.emplace_back(new Shard());
+  }
+}
+
+UserFeedbackStore::~UserFeedbackStore() {}
+
+bool UserFeedbackStore::Init(const MysqlServer& mysql_server) {
+  std::lock_guard<std::mutex> lock(init_mutex_);
+  if (is_inited_) {
+    return true;
+  }
+  if (!Load(mysql_server)) {
+    return false;
+  }
+  writer_.reset(new UserFeedbackWriter(mysql_server, &write_queue_));
+  writer_->Start();
+  is_inited_ = true;
+  return true;
+}
+
+void UserFeedbackStore::Update(const string& user_id,
+                               const map<int, bool>& feedback_map) {
+  UserFeedbackWriteTask task;
+  task.user_id = user_id;
+  task.feedback_map = feedback_map;
+  Shard& shard = GetShard(user_id);
+  // the task is queued under the shard lock, so writes of the same user
+  // reach db in the order they were applied in memory
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  map<int, bool>& user_feedback_map = shard.feedback_map[user_id];
+  for (auto& feedback : feedback_map) {
+    user_feedback_map[feedback.first] = feedback.second;
+  }
+  write_queue_.Push(task);
+}
+
+bool UserFeedbackStore::Query(const string& user_id,
+                              map<int, bool>* feedback_map) {
+  Shard& shard = GetShard(user_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.feedback_map.find(user_id);
+  if (it == shard.feedback_map.end()) {
+    return false;
+  }
+  *feedback_map = it->second;
+  return true;
+}
+
+void UserFeedbackStore::GetStats(Json::Value* stats) {
+  size_t user_cnt = 0;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    user_cnt += shard->feedback_map.size();
+  }
+  (*stats)["user_cnt"] = static_cast<Json::UInt64>(user_cnt);
+  (*stats)["pending_write_cnt"] =
+      static_cast<Json::UInt64>(write_queue_.Size());
+  if (writer_) {
+    (*stats)["write_cnt"] = static_cast<Json::UInt64>(writer_->write_count());
+    (*stats)["write_fail_cnt"] =
+        static_cast<Json::UInt64>(writer_->write_fail_count());
+    (*stats)["write_drop_cnt"] =
+        static_cast<Json::UInt64>(writer_->write_drop_count());
+  }
+}
+
+UserFeedbackStore::Shard& UserFeedbackStore::GetShard(const string& user_id) {
+  return *shards_[std::hash<string>()(user_id) % shards_.size()];
+}
+
+bool UserFeedbackStore::Load(const MysqlServer& mysql_server) {
+  size_t record_cnt = 0;
   try {
-    sql::Driver * driver = sql::mysql::get_driver_instance();
+    sql::Driver* driver = sql::mysql::get_driver_instance();
     std::shared_ptr< sql::Connection > connection(
-        driver->connect(mysql_server_->host(), 
-                        mysql_server_->user(), 
-                        mysql_server_->password()));
-    connection->setSchema(mysql_server_->database());
+        driver->connect(mysql_server.host(), 
+                        mysql_server.user(), 
+                        mysql_server.password()));
+    connection->setSchema(mysql_server.database());
     std::shared_ptr< sql::Statement > statement(connection->createStatement());
     std::shared_ptr< sql::ResultSet > result_set(
-        statement->executeQuery(query_sql));
-    
-    map<int, bool> result_map; 
+        statement->executeQuery(StringPrintf(kLoadFormat, kTable)));
     while (result_set->next()) {
-      try {
-        int type = result_set->getInt("business_type");
-        bool status = result_set->getBoolean("user_feedback_status");
-        result_map.insert(std::make_pair(type, status));
-      } catch (const std::exception& e) {
-        LOG(INFO) << "result_set parse failed:" << e.what();
-        continue;
-      }
-    } 
-    if (!result_map.empty()) {
-      for (const auto& result : result_map) {
-        BusinessType business_type = (BusinessType)(result.first);
-        bool status = result.second;
-        UserFeedbackQueryResponse_DataList* data_list = (
-          response->add_data_list());
-        data_list->set_business_type(business_type);
-        data_list->set_user_feedback_status(status);
-        data_list->set_response_status(true);
-      }
-    } else {
-      LOG(INFO) << "no record user_id: " << user_id;
-      response->set_user_id(user_id);
-      response->set_response_reason("no record");
-      return false;
+      string user_id = result_set->getString("user_id");
+      int type = result_set->getInt("business_type");
+      bool status = result_set->getBoolean("user_feedback_status");
+      Shard& shard = GetShard(user_id);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.feedback_map[user_id].insert(std::make_pair(type, status));
+      ++record_cnt;
     }
-    statement.reset(); /* free the object inside  */
   } catch (const sql::SQLException &e) {
     LOG(ERROR) << "# ERR: " << e.what()
                << " (MySQL error code: " << e.getErrorCode()
                << ", SQLState: " << e.getSQLState() << ")"; 
-    response->set_response_reason(e.what());
     return false;
   } catch (const std::runtime_error &e) {
     LOG(ERROR) << "# ERR: " << e.what();
-    response->set_response_reason(e.what());
     return false;
   }
+  LOG(INFO) << "load user feedback success, record count:" << record_cnt;
+  return true;
+}
+
+DbHandler::DbHandler() {
+  LOG(INFO) << "Construct DbHandler";
+  Init();
+}
+
+DbHandler::~DbHandler() {}
+
+void DbHandler::Init() {
+  mysql_server_.reset(new MysqlServer());
+  CHECK(file::ReadProtoFromTextFile(FLAGS_mysql_config, mysql_server_.get()));
+  LOG(INFO) << "init mysql config from file:" << FLAGS_mysql_config;
+  user_feedback_store_ = Singleton<UserFeedbackStore>::get();
+  CHECK(user_feedback_store_->Init(*mysql_server_))
+      << "load user feedback from db failed";
+}
+
+bool DbHandler::InsertUserFeedback(UserFeedbackRequest *request,
+                                   UserFeedbackResponse *response) {
+  const string& user_id = request->user_id();
+  map<int, bool> feedback_map;
+  for (int index = 0; index < request->data_list_size(); ++index) {
+    BusinessType business_type = request->data_list(index).business_type();
+    feedback_map[static_cast<int>(business_type)] =
+        request->data_list(index).user_feedback_status();
+    UserFeedbackResponse_DataList* data_list = response->add_data_list();
+    data_list->set_business_type(business_type);
+    data_list->set_response_status(true);
+  }
+  if (!feedback_map.empty()) {
+    user_feedback_store_->Update(user_id, feedback_map);
+  }
+  response->set_user_id(user_id);
+  response->set_status(kSuccess);
+  response->set_err_msg("");
+  response->set_response_reason("update ok");
+  VLOG(1) << "InsertUserFeedback success, user_id:" << user_id;
+  return true;
+}
+
+bool DbHandler::QueryUserFeedback(UserFeedbackQueryResquest *request,
+                                  UserFeedbackQueryResponse *response) {
+  const string& user_id = request->user_id();
+  map<int, bool> result_map;
+  if (!user_feedback_store_->Query(user_id, &result_map) ||
+      result_map.empty()) {
+    VLOG(1) << "no record user_id: " << user_id;
+    response->set_user_id(user_id);
+    response->set_response_reason("no record");
+    return false;
+  }
+  for (const auto& result : result_map) {
+    UserFeedbackQueryResponse_DataList* data_list = (
+      response->add_data_list());
+    data_list->set_business_type(static_cast<BusinessType>(result.first));
+    data_list->set_user_feedback_status(result.second);
+    data_list->set_response_status(true);
+  }
   response->set_user_id(user_id);
   response->set_status(kSuccess);
   response->set_err_msg("");
   response->set_response_reason("query ok");
-  LOG(INFO) << "QueryUserFeedback update to db success";
+  return true;
+}
+
+bool DbHandler::BatchQueryUserFeedback(
+    UserFeedbackBatchQueryRequest *request,
+    UserFeedbackBatchQueryResponse *response) {
+  UserFeedbackQueryResquest user_request;
+  for (int index = 0; index < request->user_id_size(); ++index) {
+    user_request.set_user_id(request->user_id(index));
+    UserFeedbackQueryResponse* user_response = response->add_user_list();
+    if (!QueryUserFeedback(&user_request, user_response)) {
+      user_response->set_status(kFailed);
+    }
+  }
+  response->set_status(kSuccess);
+  response->set_err_msg("");
   return true;
 }
 
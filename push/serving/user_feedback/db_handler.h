@@ -4,15 +4,96 @@
 #ifndef PUSH_SERVING_USER_FEEDBACK_DB_HANDLER_H_
 #define PUSH_SERVING_USER_FEEDBACK_DB_HANDLER_H_
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 
 #include "base/basictypes.h"
+#include "base/compat.h"
+#include "base/concurrent_queue.h"
+#include "base/singleton.h"
+#include "base/thread.h"
 #include "proto/mysql_config.pb.h"
+#include "third_party/jsoncpp/json.h"
 
 #include "push/proto/user_feedback_meta.pb.h"
 
+namespace sql {
+class Connection;
+}
+
 namespace feedback {
 
+struct UserFeedbackWriteTask {
+  string user_id;
+  map<int, bool> feedback_map;  // business_type -> user_feedback_status
+};
+
+// Persists feedback writes to db in the order they were accepted. A failed
+// write is retried with backoff until it succeeds, the writes behind it
+// wait in the queue meanwhile. A write db rejects for its content would
+// fail forever, so it is logged and dropped instead.
+class UserFeedbackWriter : public mobvoi::Thread {
+ public:
+  UserFeedbackWriter(const MysqlServer& mysql_server,
+                     mobvoi::ConcurrentQueue<UserFeedbackWriteTask>* queue);
+  virtual ~UserFeedbackWriter();
+  virtual void Run();
+  uint64 write_count() const {
+    return write_cnt_;
+  }
+  // failed attempts, each one is retried
+  uint64 write_fail_count() const {
+    return write_fail_cnt_;
+  }
+  uint64 write_drop_count() const {
+    return write_drop_cnt_;
+  }
+
+ private:
+  // is_retryable is false when db rejected the statement itself.
+  bool Write(const UserFeedbackWriteTask& task, bool* is_retryable);
+
+  MysqlServer mysql_server_;
+  std::unique_ptr<sql::Connection> connection_;
+  mobvoi::ConcurrentQueue<UserFeedbackWriteTask>* write_queue_;
+  std::atomic<uint64> write_cnt_;
+  std::atomic<uint64> write_fail_cnt_;
+  std::atomic<uint64> write_drop_cnt_;
+  DISALLOW_COPY_AND_ASSIGN(UserFeedbackWriter);
+};
+
+// The whole user_feedback table kept in memory, sharded by user_id. Reads
+// never touch db, writes update memory and are queued to the writer.
+class UserFeedbackStore {
+ public:
+  ~UserFeedbackStore();
+  // Loads the table and starts the writer, later calls are no-op.
+  bool Init(const MysqlServer& mysql_server);
+  void Update(const string& user_id, const map<int, bool>& feedback_map);
+  bool Query(const string& user_id, map<int, bool>* feedback_map);
+  void GetStats(Json::Value* stats);
+
+ private:
+  friend struct DefaultSingletonTraits<UserFeedbackStore>;
+  UserFeedbackStore();
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<string, map<int, bool>> feedback_map;
+  };
+  Shard& GetShard(const string& user_id);
+  bool Load(const MysqlServer& mysql_server);
+
+  std::mutex init_mutex_;
+  bool is_inited_;
+  vector<std::unique_ptr<Shard>> shards_;
+  mobvoi::ConcurrentQueue<UserFeedbackWriteTask> write_queue_;
+  std::unique_ptr<UserFeedbackWriter> writer_;
+  DISALLOW_COPY_AND_ASSIGN(UserFeedbackStore);
+};
+
 class DbHandler {
  public:
   DbHandler();
@@ -22,10 +103,15 @@ class DbHandler {
                                   UserFeedbackResponse *response);
   virtual bool QueryUserFeedback(UserFeedbackQueryResquest *request,
                                  UserFeedbackQueryResponse *response);
+  // Every user gets an entry in user_list, users without record have
+  // status kFailed.
+  virtual bool BatchQueryUserFeedback(UserFeedbackBatchQueryRequest *request,
+                                      UserFeedbackBatchQueryResponse *response);
 
  private:
   std::unique_ptr<MysqlServer> mysql_server_;
-  
+  UserFeedbackStore* user_feedback_store_;
+
   DISALLOW_COPY_AND_ASSIGN(DbHandler);
 };
 
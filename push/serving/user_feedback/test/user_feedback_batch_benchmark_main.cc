@@ -0,0 +1,87 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include <algorithm>
+#include <chrono>
+
+#include "base/at_exit.h"
+#include "base/log.h"
+#include "base/string_util.h"
+#include "third_party/gflags/gflags.h"
+#include "third_party/jsoncpp/json.h"
+#include "util/net/http_client/http_client.h"
+
+DEFINE_int32(benchmark_request_cnt, 200, "requests per batch size");
+DEFINE_string(batch_query_url,
+    "http://user-feedback-service/batch_query_feedback", "batch query url");
+DEFINE_string(benchmark_batch_sizes, "1,100,1000", "batch sizes to run");
+DEFINE_string(benchmark_user_prefix, "benchmark_user_",
+    "prefix of the queried user ids");
+
+namespace {
+
+// Issues FLAGS_benchmark_request_cnt batch queries of batch_size users and
+// reports the request latency percentiles and the users per second.
+void BenchmarkBatchSize(int batch_size) {
+  Json::Value request;
+  Json::Value user_ids(Json::arrayValue);
+  for (int i = 0; i < batch_size; ++i) {
+    user_ids.append(FLAGS_benchmark_user_prefix + IntToString(i));
+  }
+  request["user_ids"] = user_ids;
+  Json::FastWriter writer;
+  string post_data = writer.write(request);
+
+  util::HttpClient http_client;
+  vector<double> latency_vector;
+  int success_cnt = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < FLAGS_benchmark_request_cnt; ++i) {
+    auto request_start = std::chrono::steady_clock::now();
+    http_client.Reset();
+    http_client.SetHttpMethod(util::HttpMethod::kPost);
+    http_client.SetPostData(post_data);
+    http_client.AddHeader("Content-Type", "application/json; charset=utf-8");
+    if (http_client.FetchUrl(FLAGS_batch_query_url) &&
+        http_client.response_code() == 200) {
+      ++success_cnt;
+    }
+    latency_vector.push_back(std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - request_start).count());
+  }
+  double elapsed_ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+  std::sort(latency_vector.begin(), latency_vector.end());
+  auto percentile = [&latency_vector](double p) {
+    size_t index = static_cast<size_t>(p * (latency_vector.size() - 1));
+    return latency_vector[index];
+  };
+  LOG(INFO) << "batch_size=" << batch_size
+            << ", requests=" << FLAGS_benchmark_request_cnt
+            << ", success=" << success_cnt
+            << ", p50_ms=" << percentile(0.5)
+            << ", p99_ms=" << percentile(0.99)
+            << ", max_ms=" << latency_vector.back()
+            << ", users_per_second="
+            << FLAGS_benchmark_request_cnt * batch_size * 1000.0 / elapsed_ms;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  base::AtExitManager at_exit;
+  google::ParseCommandLineFlags(&argc, &argv, false);
+  google::InitGoogleLogging(argv[0]);
+  CHECK(FLAGS_benchmark_request_cnt > 0);
+  vector<string> batch_size_vector;
+  SplitString(FLAGS_benchmark_batch_sizes, ',', &batch_size_vector);
+  for (auto& batch_size_string : batch_size_vector) {
+    int batch_size = 0;
+    if (!StringToInt(batch_size_string, &batch_size) || batch_size <= 0) {
+      LOG(ERROR) << "invalid batch size:" << batch_size_string;
+      continue;
+    }
+    BenchmarkBatchSize(batch_size);
+  }
+  return 0;
+}
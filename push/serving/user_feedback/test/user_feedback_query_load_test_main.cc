@@ -0,0 +1,96 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "base/at_exit.h"
+#include "base/compat.h"
+#include "base/log.h"
+#include "base/string_util.h"
+#include "third_party/gflags/gflags.h"
+#include "third_party/jsoncpp/json.h"
+#include "util/net/http_client/http_client.h"
+
+DEFINE_int32(benchmark_thread_num, 32,
+    "concurrent clients, like the push scheduler filtering a burst");
+DEFINE_int32(benchmark_request_cnt, 2000, "queries per client");
+DEFINE_int32(benchmark_user_cnt, 10000, "distinct users queried");
+DEFINE_string(query_url,
+    "http://user-feedback-service/query_feedback", "single query url");
+DEFINE_string(benchmark_user_prefix, "benchmark_user_",
+    "prefix of the queried user ids");
+
+namespace {
+
+// Sends FLAGS_benchmark_request_cnt queries back to back, the latencies
+// in ms are appended to latency_vector.
+void RunClient(int client_index, vector<double>* latency_vector,
+               int* success_cnt) {
+  util::HttpClient http_client;
+  Json::FastWriter writer;
+  for (int i = 0; i < FLAGS_benchmark_request_cnt; ++i) {
+    Json::Value request;
+    int user_index = (client_index * FLAGS_benchmark_request_cnt + i) %
+                     FLAGS_benchmark_user_cnt;
+    request["user_id"] =
+        FLAGS_benchmark_user_prefix + IntToString(user_index);
+    auto request_start = std::chrono::steady_clock::now();
+    http_client.Reset();
+    http_client.SetHttpMethod(util::HttpMethod::kPost);
+    http_client.SetPostData(writer.write(request));
+    http_client.AddHeader("Content-Type", "application/json; charset=utf-8");
+    if (http_client.FetchUrl(FLAGS_query_url) &&
+        http_client.response_code() == 200) {
+      ++*success_cnt;
+    }
+    latency_vector->push_back(std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - request_start).count());
+  }
+}
+
+}  // namespace
+
+// Bursts /query_feedback from concurrent clients and reports the latency
+// percentiles, the p99 is expected to stay under 1ms since queries are
+// answered from memory.
+int main(int argc, char** argv) {
+  base::AtExitManager at_exit;
+  google::ParseCommandLineFlags(&argc, &argv, false);
+  google::InitGoogleLogging(argv[0]);
+  CHECK(FLAGS_benchmark_thread_num > 0);
+  CHECK(FLAGS_benchmark_request_cnt > 0);
+  CHECK(FLAGS_benchmark_user_cnt > 0);
+  vector<vector<double>> latency_vectors(FLAGS_benchmark_thread_num);
+  vector<int> success_cnts(FLAGS_benchmark_thread_num, 0);
+  vector<std::thread> clients;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < FLAGS_benchmark_thread_num; ++i) {
+    clients.emplace_back(RunClient, i, &latency_vectors[i], &success_cnts[i]);
+  }
+  vector<double> latency_vector;
+  int success_cnt = 0;
+  for (int i = 0; i < FLAGS_benchmark_thread_num; ++i) {
+    clients[i].join();
+    latency_vector.insert(latency_vector.end(), latency_vectors[i].begin(),
+                          latency_vectors[i].end());
+    success_cnt += success_cnts[i];
+  }
+  double elapsed_ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+  std::sort(latency_vector.begin(), latency_vector.end());
+  auto percentile = [&latency_vector](double p) {
+    size_t index = static_cast<size_t>(p * (latency_vector.size() - 1));
+    return latency_vector[index];
+  };
+  LOG(INFO) << "clients=" << FLAGS_benchmark_thread_num
+            << ", requests=" << latency_vector.size()
+            << ", success=" << success_cnt
+            << ", p50_ms=" << percentile(0.5)
+            << ", p99_ms=" << percentile(0.99)
+            << ", p999_ms=" << percentile(0.999)
+            << ", max_ms=" << latency_vector.back()
+            << ", qps=" << latency_vector.size() * 1000.0 / elapsed_ms;
+  return 0;
+}
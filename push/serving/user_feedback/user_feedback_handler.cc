@@ -32,6 +32,39 @@ static const char kNameMovie[] = "movie";
 static const char kNameNews[] = "news";
 static const char kTextSuccess[] = "success";
 static const char kTextError[] = "errro";
+static const int kMaxBatchSize = 1000;
+
+// The business types a handler reads or writes, news is only written.
+void InitBusinessMaps(
+    bool has_news,
+    map<feedback::BusinessType, string>* business_type_name_map,
+    map<string, feedback::BusinessType>* business_name_type_map) {
+  *business_type_name_map = {
+    {feedback::kTotal, kNameTotal},
+    {feedback::kSchedule, kNameSchedule},
+    {feedback::kWeather, kNameWeather},
+    {feedback::kMovie, kNameMovie},
+  };
+  if (has_news) {
+    (*business_type_name_map)[feedback::kNews] = kNameNews;
+  }
+  business_name_type_map->clear();
+  for (auto& type_name : *business_type_name_map) {
+    (*business_name_type_map)[type_name.second] = type_name.first;
+  }
+}
+
+void InitStatusMaps(map<feedback::Status, string>* total_status_text_map,
+                    map<string, feedback::Status>* total_text_status_map) {
+  *total_status_text_map = {
+    {feedback::kSuccess, kTextSuccess},
+    {feedback::kFailed, kTextError},
+  };
+  total_text_status_map->clear();
+  for (auto& status_text : *total_status_text_map) {
+    (*total_text_status_map)[status_text.second] = status_text.first;
+  }
+}
 
 }
 
@@ -45,28 +78,8 @@ UserFeedbackHandler::UserFeedbackHandler() {
 UserFeedbackHandler::~UserFeedbackHandler() {}
 
 void UserFeedbackHandler::Init() {
-  business_type_name_map_ = {
-    {kTotal, kNameTotal},
-    {kSchedule, kNameSchedule},
-    {kWeather, kNameWeather},
-    {kMovie, kNameMovie},
-    {kNews, kNameNews},
-  };
-  business_name_type_map_ = {
-    {kNameTotal, kTotal},
-    {kNameSchedule, kSchedule},
-    {kNameWeather, kWeather},
-    {kNameMovie, kMovie},
-    {kNameNews, kNews},
-  };
-  total_status_text_map_ = {
-    {kSuccess, kTextSuccess},
-    {kFailed, kTextError},
-  };
-  total_text_status_map_ = {
-    {kTextSuccess, kSuccess},
-    {kTextError, kFailed},
-  };
+  InitBusinessMaps(true, &business_type_name_map_, &business_name_type_map_);
+  InitStatusMaps(&total_status_text_map_, &total_text_status_map_);
 }
 
 string UserFeedbackHandler::ErrorInfo(const UserFeedbackRequest& request, 
@@ -160,26 +173,8 @@ UserFeedbackQueryHandler::UserFeedbackQueryHandler() {
 UserFeedbackQueryHandler::~UserFeedbackQueryHandler() {}
 
 void UserFeedbackQueryHandler::Init() {
-  business_type_name_map_ = {
-    {kTotal, kNameTotal},
-    {kSchedule, kNameSchedule},
-    {kWeather, kNameWeather},
-    {kMovie, kNameMovie},
-  };
-  business_name_type_map_ = {
-    {kNameTotal, kTotal},
-    {kNameSchedule, kSchedule},
-    {kNameWeather, kWeather},
-    {kNameMovie, kMovie},
-  };
-  total_status_text_map_ = {
-    {kSuccess, kTextSuccess},
-    {kFailed, kTextError},
-  };
-  total_text_status_map_ = {
-    {kTextSuccess, kSuccess},
-    {kTextError, kFailed},
-  };
+  InitBusinessMaps(false, &business_type_name_map_, &business_name_type_map_);
+  InitStatusMaps(&total_status_text_map_, &total_text_status_map_);
 }
 
 string 
@@ -251,6 +246,103 @@ bool UserFeedbackQueryHandler::HandleRequest(util::HttpRequest* request,
   }
 }
 
+UserFeedbackBatchQueryHandler::UserFeedbackBatchQueryHandler() {
+  LOG(INFO) << "Construct UserFeedbackBatchQueryHandler";
+  Init();
+}
+
+UserFeedbackBatchQueryHandler::~UserFeedbackBatchQueryHandler() {}
+
+void UserFeedbackBatchQueryHandler::Init() {
+  // the same business types as UserFeedbackQueryHandler
+  map<string, BusinessType> business_name_type_map;
+  InitBusinessMaps(false, &business_type_name_map_, &business_name_type_map);
+  map<string, Status> total_text_status_map;
+  InitStatusMaps(&total_status_text_map_, &total_text_status_map);
+}
+
+string UserFeedbackBatchQueryHandler::ErrorInfo(
+    const std::string& error_info) {
+  Json::Value result;
+  result["status"] = "error";
+  result["err_msg"] = error_info;
+  result["data"] = Json::Value(Json::arrayValue);
+  string res = push_controller::JsonToString(result);
+  return res;
+}
+
+string UserFeedbackBatchQueryHandler::ResponseInfo(
+    const UserFeedbackBatchQueryResponse& response) {
+  Json::Value result;
+  Json::Value user_list(Json::arrayValue);
+  result["err_msg"] = response.err_msg();
+  for (int i = 0; i < response.user_list_size(); ++i) {
+    const UserFeedbackQueryResponse& user_response = response.user_list(i);
+    Json::Value user;
+    Json::Value data(Json::arrayValue);
+    user["user_id"] = user_response.user_id();
+    user["err_msg"] = user_response.response_reason();
+    for (int j = 0; j < user_response.data_list_size(); ++j) {
+      BusinessType type = user_response.data_list(j).business_type();
+      auto it = business_type_name_map_.find(type);
+      if (it == business_type_name_map_.end()) {
+        continue;
+      }
+      Json::Value element;
+      element["response_status"] = (
+          user_response.data_list(j).response_status());
+      element["user_feedback_status"] = (
+          user_response.data_list(j).user_feedback_status());
+      element["business_type"] = it->second;
+      data.append(element);
+    }
+    user["data"] = data;
+    user["status"] = total_status_text_map_[user_response.status()];
+    user_list.append(user);
+  }
+  result["data"] = user_list;
+  result["status"] = total_status_text_map_[response.status()];
+  return push_controller::JsonToString(result);
+}
+
+bool UserFeedbackBatchQueryHandler::HandleRequest(
+    util::HttpRequest* request, util::HttpResponse* response) {
+  UserFeedbackBatchQueryRequest batch_query_request;
+  UserFeedbackBatchQueryResponse batch_query_response;
+  try {
+    response->AppendHeader("Content-Type", "application/json;charset=UTF-8");
+    Json::Value req;
+    Json::Reader reader;
+    if (!reader.parse(request->GetRequestData(), req)) {
+      response->AppendBuffer(ErrorInfo("invalid json request"));
+      return false;
+    }
+    const Json::Value& user_ids = req["user_ids"];
+    if (!user_ids.isArray() || user_ids.size() >
+        static_cast<Json::ArrayIndex>(kMaxBatchSize)) {
+      response->AppendBuffer(ErrorInfo(StringPrintf(
+          "user_ids should be an array of at most %d", kMaxBatchSize)));
+      return false;
+    }
+    for (Json::ArrayIndex i = 0; i < user_ids.size(); ++i) {
+      batch_query_request.add_user_id(user_ids[i].asString());
+    }
+    LOG(INFO) << "Receive feedback batch query request, user count:"
+              << batch_query_request.user_id_size();
+    if (!db_handler_.BatchQueryUserFeedback(&batch_query_request,
+                                            &batch_query_response)) {
+      response->AppendBuffer(ErrorInfo(batch_query_response.err_msg()));
+      return false;
+    }
+    response->AppendBuffer(ResponseInfo(batch_query_response));
+    return true;
+  } catch (const std::exception &e) {
+    LOG(ERROR) << e.what();
+    response->AppendBuffer(ErrorInfo(e.what()));
+    return false;
+  }
+}
+
 StatusHandler::StatusHandler() {}
 
 StatusHandler::~StatusHandler() {}
@@ -263,6 +355,7 @@ bool StatusHandler::HandleRequest(util::HttpRequest* request,
   result["status"] = "ok";
   result["host"] = util::GetLocalHostName();
   result["service"] = "user_feedback_service";
+  Singleton<UserFeedbackStore>::get()->GetStats(&result["store"]);
   response->AppendBuffer(result.toStyledString());
   return true;
 }
@@ -61,6 +61,26 @@ class UserFeedbackQueryHandler : public HttpRequestHandler {
   DISALLOW_COPY_AND_ASSIGN(UserFeedbackQueryHandler);
 };
 
+// Queries many users in one request, at most kMaxBatchSize of them.
+class UserFeedbackBatchQueryHandler : public HttpRequestHandler {
+ public:
+  UserFeedbackBatchQueryHandler();
+  virtual void Init();
+  virtual ~UserFeedbackBatchQueryHandler();
+  virtual bool HandleRequest(util::HttpRequest* request,
+                             util::HttpResponse* response);
+
+ private:
+  string ErrorInfo(const std::string& error_info);
+  string ResponseInfo(const UserFeedbackBatchQueryResponse& response);
+
+  DbHandler db_handler_;
+  map<BusinessType, string> business_type_name_map_;
+  map<Status, string> total_status_text_map_;
+
+  DISALLOW_COPY_AND_ASSIGN(UserFeedbackBatchQueryHandler);
+};
+
 class StatusHandler : public HttpRequestHandler {
  public:
   StatusHandler();
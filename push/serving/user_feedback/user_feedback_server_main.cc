@@ -33,6 +33,7 @@ int main(int argc, char **argv) {
   
   serving::UserFeedbackHandler user_feedback_handler;
   serving::UserFeedbackQueryHandler user_feedback_query_handler;
+  serving::UserFeedbackBatchQueryHandler user_feedback_batch_query_handler;
   serving::StatusHandler status_handler;
   
   auto user_feedback_callback = std::bind(
@@ -45,6 +46,11 @@ int main(int argc, char **argv) {
       &user_feedback_query_handler, 
       std::placeholders::_1, 
       std::placeholders::_2);
+  auto user_feedback_batch_query_callback = std::bind(
+      &serving::UserFeedbackBatchQueryHandler::HandleRequest, 
+      &user_feedback_batch_query_handler, 
+      std::placeholders::_1, 
+      std::placeholders::_2);
   auto status_callback = std::bind(
       &serving::StatusHandler::HandleRequest, 
       &status_handler, 
@@ -54,12 +60,16 @@ int main(int argc, char **argv) {
   util::DefaultHttpHandler user_feedback_http_handler(user_feedback_callback);
   util::DefaultHttpHandler user_feedback_query_http_handler(
       user_feedback_query_callback);
+  util::DefaultHttpHandler user_feedback_batch_query_http_handler(
+      user_feedback_batch_query_callback);
   util::DefaultHttpHandler status_http_handler(status_callback);
 
   http_server.RegisterHttpHandler("/feedback", 
                                   &user_feedback_http_handler);
   http_server.RegisterHttpHandler("/query_feedback", 
                                   &user_feedback_query_http_handler);
+  http_server.RegisterHttpHandler("/batch_query_feedback", 
+                                  &user_feedback_batch_query_http_handler);
   http_server.RegisterHttpHandler("/status", 
                                   &status_http_handler);
 
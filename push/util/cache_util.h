@@ -0,0 +1,303 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#ifndef PUSH_UTIL_CACHE_UTIL_H_
+#define PUSH_UTIL_CACHE_UTIL_H_
+
+#include <time.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "base/basictypes.h"
+#include "base/compat.h"
+
+namespace recommendation {
+
+// Thread safe cache whose entries expire after a per entry ttl. When full
+// the expired entries are dropped first, then the one expiring soonest,
+// both found in O(log n) through an index ordered by expire time.
+template <typename Value>
+class ExpiringCache {
+ public:
+  explicit ExpiringCache(size_t max_size)
+    : max_size_(max_size), hit_cnt_(0), miss_cnt_(0) {}
+  ~ExpiringCache() {}
+
+  bool Get(const string& key, Value* value) {
+    time_t now = time(NULL);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end() || it->second.expire_time <= now) {
+      ++miss_cnt_;
+      return false;
+    }
+    *value = it->second.value;
+    ++hit_cnt_;
+    return true;
+  }
+
+  void Put(const string& key, const Value& value, int ttl_seconds) {
+    time_t now = time(NULL);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      expire_index_.erase(it->second.expire_it);
+    } else {
+      if (entries_.size() >= max_size_) {
+        EvictLocked(now);
+      }
+      it = entries_.insert(std::make_pair(key, Entry())).first;
+    }
+    Entry& entry = it->second;
+    entry.value = value;
+    entry.expire_time = now + ttl_seconds;
+    entry.expire_it = expire_index_.insert(
+        std::make_pair(entry.expire_time, key));
+  }
+
+  void Erase(const string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      expire_index_.erase(it->second.expire_it);
+      entries_.erase(it);
+    }
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+  }
+
+  uint64 hit_count() const {
+    return hit_cnt_;
+  }
+
+  uint64 miss_count() const {
+    return miss_cnt_;
+  }
+
+ private:
+  typedef std::multimap<time_t, string> ExpireIndex;
+  struct Entry {
+    Value value;
+    time_t expire_time;
+    typename ExpireIndex::iterator expire_it;
+  };
+
+  void EvictLocked(time_t now) {
+    while (!expire_index_.empty() &&
+           (expire_index_.begin()->first <= now ||
+            entries_.size() >= max_size_)) {
+      entries_.erase(expire_index_.begin()->second);
+      expire_index_.erase(expire_index_.begin());
+    }
+  }
+
+  size_t max_size_;
+  std::atomic<uint64> hit_cnt_;
+  std::atomic<uint64> miss_cnt_;
+  std::mutex mutex_;
+  std::unordered_map<string, Entry> entries_;
+  ExpireIndex expire_index_;
+  DISALLOW_COPY_AND_ASSIGN(ExpiringCache);
+};
+
+// Collapses concurrent loads of the same key into one call, the callers
+// arriving while it runs wait and share its result.
+template <typename Value>
+class SingleFlight {
+ public:
+  typedef std::function<bool(Value* value)> Loader;
+
+  SingleFlight() : shared_cnt_(0) {}
+  ~SingleFlight() {}
+
+  bool Do(const string& key, const Loader& loader, Value* value) {
+    std::shared_ptr<Call> call;
+    bool is_leader = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = calls_.find(key);
+      if (it != calls_.end()) {
+        call = it->second;
+      } else {
+        call = std::make_shared<Call>();
+        calls_[key] = call;
+        is_leader = true;
+      }
+    }
+    if (is_leader) {
+      // wakes the waiters even if the loader throws, they see a failure
+      LeaderGuard guard(this, key, call.get());
+      guard.success = loader(&call->value);
+    } else {
+      ++shared_cnt_;
+      std::unique_lock<std::mutex> lock(call->mutex);
+      call->cond.wait(lock, [&call] { return call->done; });
+    }
+    if (call->success) {
+      *value = call->value;
+    }
+    return call->success;
+  }
+
+  // number of calls which shared the result of another caller
+  uint64 shared_count() const {
+    return shared_cnt_;
+  }
+
+ private:
+  struct Call {
+    Call() : done(false), success(false) {}
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done;
+    bool success;
+    Value value;
+  };
+
+  struct LeaderGuard {
+    LeaderGuard(SingleFlight* owner, const string& key, Call* call)
+      : owner(owner), key(key), call(call), success(false) {}
+    ~LeaderGuard() {
+      {
+        std::lock_guard<std::mutex> lock(call->mutex);
+        call->success = success;
+        call->done = true;
+      }
+      call->cond.notify_all();
+      std::lock_guard<std::mutex> lock(owner->mutex_);
+      owner->calls_.erase(key);
+    }
+    SingleFlight* owner;
+    const string& key;
+    Call* call;
+    bool success;
+  };
+
+  std::atomic<uint64> shared_cnt_;
+  std::mutex mutex_;
+  std::unordered_map<string, std::shared_ptr<Call>> calls_;
+  DISALLOW_COPY_AND_ASSIGN(SingleFlight);
+};
+
+// Thread safe LRU cache with a per entry ttl. The keys are striped over
+// shard_num shards, each with its own lock and max_size / shard_num
+// entries, so concurrent callers rarely wait on each other.
+template <typename Value>
+class ShardedLruCache {
+ public:
+  ShardedLruCache(size_t max_size, size_t shard_num)
+    : shards_(shard_num > 0 ? shard_num : 1),
+      hit_cnt_(0),
+      miss_cnt_(0) {
+    size_t shard_size = max_size / shards_.size();
+    for (auto& shard : shards_) {
+      shard.max_size = shard_size > 0 ? shard_size : 1;
+    }
+  }
+  ~ShardedLruCache() {}
+
+  bool Get(const string& key, Value* value) {
+    time_t now = time(NULL);
+    Shard& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+      ++miss_cnt_;
+      return false;
+    }
+    if (it->second->expire_time <= now) {
+      shard.entries.erase(it->second);
+      shard.index.erase(it);
+      ++miss_cnt_;
+      return false;
+    }
+    // most recently used first
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    *value = it->second->value;
+    ++hit_cnt_;
+    return true;
+  }
+
+  void Put(const string& key, const Value& value, int ttl_seconds) {
+    time_t now = time(NULL);
+    Shard& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+      shard.entries.erase(it->second);
+      shard.index.erase(it);
+    } else if (shard.index.size() >= shard.max_size) {
+      shard.index.erase(shard.entries.back().key);
+      shard.entries.pop_back();
+    }
+    Entry entry;
+    entry.key = key;
+    entry.value = value;
+    entry.expire_time = now + ttl_seconds;
+    shard.entries.push_front(entry);
+    shard.index[key] = shard.entries.begin();
+  }
+
+  void Erase(const string& key) {
+    Shard& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+      shard.entries.erase(it->second);
+      shard.index.erase(it);
+    }
+  }
+
+  size_t size() {
+    size_t total = 0;
+    for (auto& shard : shards_) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      total += shard.index.size();
+    }
+    return total;
+  }
+
+  uint64 hit_count() const {
+    return hit_cnt_;
+  }
+
+  uint64 miss_count() const {
+    return miss_cnt_;
+  }
+
+ private:
+  struct Entry {
+    string key;
+    Value value;
+    time_t expire_time;
+  };
+  struct Shard {
+    std::mutex mutex;
+    size_t max_size;
+    std::list<Entry> entries;
+    std::unordered_map<string, typename std::list<Entry>::iterator> index;
+  };
+
+  Shard& GetShard(const string& key) {
+    return shards_[std::hash<string>()(key) % shards_.size()];
+  }
+
+  vector<Shard> shards_;
+  std::atomic<uint64> hit_cnt_;
+  std::atomic<uint64> miss_cnt_;
+  DISALLOW_COPY_AND_ASSIGN(ShardedLruCache);
+};
+
+}  // namespace recommendation
+
+#endif  // PUSH_UTIL_CACHE_UTIL_H_
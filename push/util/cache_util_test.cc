@@ -0,0 +1,140 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+#include "third_party/gtest/gtest.h"
+#include "push/util/cache_util.h"
+
+using namespace recommendation;
+
+TEST(ExpiringCacheTest, GetAndExpire) {
+  ExpiringCache<string> cache(10);
+  string value;
+  EXPECT_FALSE(cache.Get("key", &value));
+  cache.Put("key", "value", 60);
+  EXPECT_TRUE(cache.Get("key", &value));
+  EXPECT_EQ("value", value);
+  cache.Put("expired", "value", 0);
+  EXPECT_FALSE(cache.Get("expired", &value));
+  EXPECT_EQ(1u, cache.hit_count());
+  EXPECT_EQ(2u, cache.miss_count());
+}
+
+TEST(ExpiringCacheTest, EvictWhenFull) {
+  ExpiringCache<int> cache(2);
+  cache.Put("a", 1, 10);
+  cache.Put("b", 2, 100);
+  cache.Put("c", 3, 100);
+  int value = 0;
+  EXPECT_FALSE(cache.Get("a", &value));
+  EXPECT_TRUE(cache.Get("b", &value));
+  EXPECT_TRUE(cache.Get("c", &value));
+  EXPECT_EQ(2u, cache.size());
+}
+
+TEST(ExpiringCacheTest, EvictByUpdatedExpireTime) {
+  ExpiringCache<int> cache(2);
+  cache.Put("a", 1, 10);
+  cache.Put("b", 2, 100);
+  // a now expires after b, so b is the one evicted
+  cache.Put("a", 1, 1000);
+  cache.Put("c", 3, 100);
+  int value = 0;
+  EXPECT_TRUE(cache.Get("a", &value));
+  EXPECT_FALSE(cache.Get("b", &value));
+  cache.Erase("a");
+  cache.Put("d", 4, 100);
+  EXPECT_TRUE(cache.Get("c", &value));
+  EXPECT_TRUE(cache.Get("d", &value));
+  EXPECT_EQ(2u, cache.size());
+}
+
+TEST(SingleFlightTest, ConcurrentCallsShareOneLoad) {
+  SingleFlight<int> single_flight;
+  std::atomic<int> load_cnt(0);
+  auto loader = [&load_cnt, &single_flight](int* value) {
+    ++load_cnt;
+    // hold the load until the other callers joined it
+    while (single_flight.shared_count() < 3) {
+      std::this_thread::yield();
+    }
+    *value = 42;
+    return true;
+  };
+  vector<std::thread> threads;
+  vector<int> values(4, 0);
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&single_flight, &loader, &values, i] {
+      EXPECT_TRUE(single_flight.Do("key", loader, &values[i]));
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(1, load_cnt);
+  EXPECT_EQ(3u, single_flight.shared_count());
+  for (int value : values) {
+    EXPECT_EQ(42, value);
+  }
+}
+
+TEST(SingleFlightTest, ThrowingLoaderReleasesWaiters) {
+  SingleFlight<int> single_flight;
+  std::atomic<bool> is_loading(false);
+  auto loader = [&single_flight, &is_loading](int* value) -> bool {
+    is_loading = true;
+    while (single_flight.shared_count() < 1) {
+      std::this_thread::yield();
+    }
+    throw std::runtime_error("load failed");
+  };
+  std::thread leader([&single_flight, &loader] {
+    int value = 0;
+    EXPECT_THROW(single_flight.Do("key", loader, &value),
+                 std::runtime_error);
+  });
+  while (!is_loading) {
+    std::this_thread::yield();
+  }
+  int value = 0;
+  EXPECT_FALSE(single_flight.Do("key", loader, &value));
+  leader.join();
+  // the failed call is gone, the next caller loads again
+  EXPECT_TRUE(single_flight.Do("key", [](int* value) {
+    *value = 42;
+    return true;
+  }, &value));
+  EXPECT_EQ(42, value);
+}
+
+TEST(ShardedLruCacheTest, GetEraseAndExpire) {
+  ShardedLruCache<string> cache(100, 4);
+  string value;
+  EXPECT_FALSE(cache.Get("key", &value));
+  cache.Put("key", "value", 60);
+  EXPECT_TRUE(cache.Get("key", &value));
+  EXPECT_EQ("value", value);
+  cache.Erase("key");
+  EXPECT_FALSE(cache.Get("key", &value));
+  cache.Put("expired", "value", 0);
+  EXPECT_FALSE(cache.Get("expired", &value));
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_EQ(1u, cache.hit_count());
+  EXPECT_EQ(3u, cache.miss_count());
+}
+
+TEST(ShardedLruCacheTest, EvictLeastRecentlyUsed) {
+  ShardedLruCache<int> cache(2, 1);
+  cache.Put("a", 1, 100);
+  cache.Put("b", 2, 100);
+  int value = 0;
+  EXPECT_TRUE(cache.Get("a", &value));
+  cache.Put("c", 3, 100);
+  EXPECT_TRUE(cache.Get("a", &value));
+  EXPECT_FALSE(cache.Get("b", &value));
+  EXPECT_TRUE(cache.Get("c", &value));
+  EXPECT_EQ(2u, cache.size());
+}
@@ -122,4 +122,16 @@ bool ExtractMatchedGroupResults(const string& pattern,
   return true;
 }
 
+string EscapeSqlString(const string& value) {
+  string escaped;
+  escaped.reserve(value.size());
+  for (char c : value) {
+    if (c == '\\' || c == '\'') {
+      escaped.push_back('\\');
+    }
+    escaped.push_back(c);
+  }
+  return escaped;
+}
+
 }  // namespace push_controller
@@ -45,6 +45,9 @@ bool CheckChannelInternal(const string& version_channel);
 bool ExtractMatchedGroupResults(const string& pattern,
     const string& text, map<string, string>* group_value_map);
 
+// Escapes quotes and backslashes of a value put into a quoted sql literal.
+string EscapeSqlString(const string& value);
+
 }  // namespace push_controller
 
 #endif  // PUSH_UTIL_COMMON_UTIL_H_
@@ -90,6 +90,12 @@ TEST(CheckChannelInternalTest, case1) {
   EXPECT_FALSE(CheckChannelInternal(channel));
 }
 
+TEST(EscapeSqlStringTest, case1) {
+  EXPECT_EQ("G101", EscapeSqlString("G101"));
+  EXPECT_EQ("it\\'s", EscapeSqlString("it's"));
+  EXPECT_EQ("a\\\\b", EscapeSqlString("a\\b"));
+}
+
 TEST(ExtractMatchedGroupResultsTest, onecase) {
   string pattern = u8".*【出行易确认】尊敬的客户，您预订的(?P<MONTH>\\d{1,2})月(?P<DAY>\\d{1,2})日[^A-Za-z0-9]+?(?P<FLIGHTNUM>[A-Za-z0-9]{3,10})，(?P<DHour>\\d{1,2}):(?P<DMin>\\d{1,2})(?P<FromAirport>.+?)起飞，(?P<AHour>\\d{1,2}):(?P<AMin>\\d{1,2})抵达(?P<ToAirport>.+?)，乘客：.+?（票号：(?P<TICKETNO>[-0-9]+).*";
   string text = u8"{\"timestamp\":1472360912953,\"rule_id\":\"1\",\"app_key\":\"com.mobvoi.companion\",\"user_id\":\"2a016388b8f30cd9a1a3cd955d6312b3\",\"number\":\"1065795555\",\"msg\":\"【出行易确认】尊敬的客户，您预订的08月29日吉祥航空HO1007，08:35上海浦东国际机场T2起飞，11:20抵达西安咸阳国际机场T3，乘客：姜伟（票号：018-1032206524）已出票，我们将在航班起飞后为您邮寄行程单，请提前2小时到达机场办理登机手续。【近期诈骗电话较多，请您提高警惕。如后续您乘坐航班发生变化，我们将通过95555或出行易服务专线021-38834600与您取得联系。】您可登录\u201c掌上生活-发现-机酒火车-出行助手\u201d查看航班动态。如有疑问，请致电出行易4000666000。[招商银行]\"}";
@@ -9,17 +9,77 @@
 #include "util/net/http_client/http_client.h"
 
 DECLARE_string(location_service);
+DECLARE_string(city_boundary_file);
+DECLARE_double(city_grid_degrees);
+DECLARE_int32(location_geohash_precision);
+DECLARE_int32(location_cache_seconds);
+
+namespace {
+
+static const size_t kRemoteCacheSize = 100000;
+
+}
 
 namespace recommendation {
 
-LocationHelper::LocationHelper() {}
+LocationHelper::LocationHelper()
+  : remote_cache_(kRemoteCacheSize),
+    local_cnt_(0),
+    remote_cnt_(0) {
+  if (!FLAGS_city_boundary_file.empty()) {
+    reverse_geocoder_.reset(new ReverseGeocoder(FLAGS_city_grid_degrees));
+    if (!reverse_geocoder_->LoadFromFile(FLAGS_city_boundary_file)) {
+      LOG(WARNING) << "no city boundaries, all lookups go remote";
+      reverse_geocoder_.reset();
+    }
+  }
+}
 
 LocationHelper::~LocationHelper() {}
 
-
 bool LocationHelper::GetLocationInfo(const string& latitude,
                                      const string& longitude,
                                      LocationInfo* location_info) {
+  double lat = StringToDouble(latitude);
+  double lng = StringToDouble(longitude);
+  if (reverse_geocoder_ &&
+      reverse_geocoder_->Lookup(lat, lng, location_info)) {
+    ++local_cnt_;
+    return true;
+  }
+  string key = EncodeGeohash(lat, lng, FLAGS_location_geohash_precision);
+  if (remote_cache_.Get(key, location_info)) {
+    location_info->set_lat(lat);
+    location_info->set_lng(lng);
+    return true;
+  }
+  auto loader = [this, &latitude, &longitude](LocationInfo* loaded_info) {
+    return FetchLocationInfo(latitude, longitude, loaded_info);
+  };
+  if (!single_flight_.Do(key, loader, location_info)) {
+    return false;
+  }
+  remote_cache_.Put(key, *location_info, FLAGS_location_cache_seconds);
+  return true;
+}
+
+void LocationHelper::GetStats(Json::Value* stats) {
+  (*stats)["city_cnt"] = static_cast<Json::UInt64>(
+      reverse_geocoder_ ? reverse_geocoder_->city_size() : 0);
+  (*stats)["local_cnt"] = static_cast<Json::UInt64>(local_cnt_);
+  (*stats)["remote_cache_size"] =
+      static_cast<Json::UInt64>(remote_cache_.size());
+  (*stats)["remote_cache_hit_cnt"] =
+      static_cast<Json::UInt64>(remote_cache_.hit_count());
+  (*stats)["remote_cache_miss_cnt"] =
+      static_cast<Json::UInt64>(remote_cache_.miss_count());
+  (*stats)["remote_cnt"] = static_cast<Json::UInt64>(remote_cnt_);
+}
+
+bool LocationHelper::FetchLocationInfo(const string& latitude,
+                                       const string& longitude,
+                                       LocationInfo* location_info) {
+  ++remote_cnt_;
   string url = StringPrintf(FLAGS_location_service.c_str(),
                             latitude.c_str(), longitude.c_str());
   util::HttpClient http_client;
@@ -4,23 +4,42 @@
 #ifndef PUSH_UTIL_LOCATION_HELPER_H_
 #define PUSH_UTIL_LOCATION_HELPER_H_
 
+#include <atomic>
+#include <memory>
+
 #include "base/basictypes.h"
 #include "base/compat.h"
 #include "base/singleton.h"
+#include "third_party/jsoncpp/json.h"
 
 #include "push/proto/user_device_meta.pb.h"
+#include "push/util/cache_util.h"
+#include "push/util/reverse_geocoder.h"
 
 namespace recommendation {
 
 class LocationHelper {
  public:
   ~LocationHelper();
+  // Resolved from --city_boundary_file when it holds the point, the
+  // location service answers the rest by geohash prefix.
   bool GetLocationInfo(const string& latitude,
                        const string& longitude,
                        LocationInfo* location_info);
+  void GetStats(Json::Value* stats);
+
  private:
   friend struct DefaultSingletonTraits<LocationHelper>;
   LocationHelper();
+  bool FetchLocationInfo(const string& latitude,
+                         const string& longitude,
+                         LocationInfo* location_info);
+
+  std::unique_ptr<ReverseGeocoder> reverse_geocoder_;
+  ExpiringCache<LocationInfo> remote_cache_;
+  SingleFlight<LocationInfo> single_flight_;
+  std::atomic<uint64> local_cnt_;
+  std::atomic<uint64> remote_cnt_;
   DISALLOW_COPY_AND_ASSIGN(LocationHelper);
 };
 
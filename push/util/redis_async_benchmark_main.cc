@@ -0,0 +1,140 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include <chrono>
+
+#include "base/at_exit.h"
+#include "base/count_down_latch.h"
+#include "base/log.h"
+#include "base/singleton.h"
+#include "base/string_util.h"
+#include "third_party/gflags/gflags.h"
+
+#include "push/util/redis_async_client.h"
+#include "push/util/redis_util.h"
+
+DEFINE_int32(redis_expire_time, 48 * 60 * 60, "redis expire time internal");
+DEFINE_int32(redis_max_sleep, 128, "redis reconnect max sleep time");
+DEFINE_int32(benchmark_request_cnt, 10000, "set and get count per client");
+DEFINE_int32(benchmark_expire_seconds, 60, "expire of the benchmark keys");
+
+DEFINE_string(redis_conf,
+    "config/push/message_receiver/redis_test.conf", "redis config");
+DEFINE_string(redis_sub_topic, "push_controller", "redis subscribe topic");
+DEFINE_string(benchmark_key_prefix, "REDIS_BENCHMARK_", "benchmark key prefix");
+
+using namespace recommendation;
+
+namespace {
+
+double ElapsedMs(std::chrono::steady_clock::time_point start) {
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+void Report(const string& name, int request_cnt, int success_cnt,
+            double elapsed_ms) {
+  LOG(INFO) << name << ": requests=" << request_cnt
+            << ", success=" << success_cnt
+            << ", elapsed_ms=" << elapsed_ms
+            << ", qps=" << request_cnt * 1000.0 / elapsed_ms;
+}
+
+// One blocking round trip of the same argv the async client sends, so both
+// sides run identical commands. RedisBase::Set is not used, it sends a
+// separate EXPIRE and logs every call.
+bool SyncCommand(redisContext* redis_context, const vector<string>& args,
+                 int reply_type) {
+  vector<const char*> argv;
+  vector<size_t> argv_len;
+  for (auto& arg : args) {
+    argv.push_back(arg.c_str());
+    argv_len.push_back(arg.size());
+  }
+  redisReply* reply = static_cast<redisReply*>(redisCommandArgv(
+      redis_context, argv.size(), argv.data(), argv_len.data()));
+  if (!reply) {
+    return false;
+  }
+  bool success = reply->type == reply_type;
+  freeReplyObject(reply);
+  return success;
+}
+
+void BenchmarkSync() {
+  RedisLease redis_lease = Singleton<RedisConnectionPool>::get()->Borrow();
+  CHECK(redis_lease.ok()) << "borrow redis connection failed";
+  redisContext* redis_context = redis_lease->redis_context();
+  string expire_seconds = IntToString(FLAGS_benchmark_expire_seconds);
+  int success_cnt = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < FLAGS_benchmark_request_cnt; ++i) {
+    string key = FLAGS_benchmark_key_prefix + IntToString(i);
+    vector<string> args = {"SET", key, key, "EX", expire_seconds};
+    if (SyncCommand(redis_context, args, REDIS_REPLY_STATUS)) {
+      ++success_cnt;
+    }
+  }
+  Report("sync set", FLAGS_benchmark_request_cnt, success_cnt,
+         ElapsedMs(start));
+  success_cnt = 0;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < FLAGS_benchmark_request_cnt; ++i) {
+    string key = FLAGS_benchmark_key_prefix + IntToString(i);
+    vector<string> args = {"GET", key};
+    if (SyncCommand(redis_context, args, REDIS_REPLY_STRING)) {
+      ++success_cnt;
+    }
+  }
+  Report("sync get", FLAGS_benchmark_request_cnt, success_cnt,
+         ElapsedMs(start));
+}
+
+void BenchmarkAsync() {
+  RedisAsyncClient async_client;
+  async_client.Start();
+  std::atomic<int> success_cnt(0);
+  std::unique_ptr<mobvoi::CountDownLatch> latch(
+      new mobvoi::CountDownLatch(FLAGS_benchmark_request_cnt));
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < FLAGS_benchmark_request_cnt; ++i) {
+    string key = FLAGS_benchmark_key_prefix + IntToString(i);
+    async_client.Set(key, key, FLAGS_benchmark_expire_seconds,
+                     [&success_cnt, &latch](bool success) {
+      if (success) {
+        ++success_cnt;
+      }
+      latch->CountDown();
+    });
+  }
+  latch->Wait();
+  Report("async set", FLAGS_benchmark_request_cnt, success_cnt,
+         ElapsedMs(start));
+  success_cnt = 0;
+  latch.reset(new mobvoi::CountDownLatch(FLAGS_benchmark_request_cnt));
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < FLAGS_benchmark_request_cnt; ++i) {
+    string key = FLAGS_benchmark_key_prefix + IntToString(i);
+    async_client.Get(key, [&success_cnt, &latch](bool success,
+                                                 const string& value) {
+      if (success) {
+        ++success_cnt;
+      }
+      latch->CountDown();
+    });
+  }
+  latch->Wait();
+  Report("async get", FLAGS_benchmark_request_cnt, success_cnt,
+         ElapsedMs(start));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  base::AtExitManager at_exit;
+  google::ParseCommandLineFlags(&argc, &argv, false);
+  google::InitGoogleLogging(argv[0]);
+  BenchmarkSync();
+  BenchmarkAsync();
+  return 0;
+}
@@ -0,0 +1,408 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/util/redis_async_client.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/file/proto_util.h"
+#include "base/log.h"
+#include "base/string_util.h"
+#include "base/time.h"
+#include "third_party/gflags/gflags.h"
+
+DECLARE_int32(redis_max_sleep);
+DECLARE_string(redis_conf);
+
+namespace {
+
+static const int kPollTimeoutMs = 100;
+
+recommendation::RedisAsyncClient* GetClient(void* privdata) {
+  return static_cast<recommendation::RedisAsyncClient*>(privdata);
+}
+
+void AddReadEvent(void* privdata) {
+  GetClient(privdata)->AddRead();
+}
+
+void DelReadEvent(void* privdata) {
+  GetClient(privdata)->DelRead();
+}
+
+void AddWriteEvent(void* privdata) {
+  GetClient(privdata)->AddWrite();
+}
+
+void DelWriteEvent(void* privdata) {
+  GetClient(privdata)->DelWrite();
+}
+
+void CleanupEvent(void* privdata) {
+  GetClient(privdata)->CleanupEvents();
+}
+
+void OnConnectEvent(const redisAsyncContext* async_context, int status) {
+  GetClient(async_context->data)->OnConnect(status);
+}
+
+void OnDisconnectEvent(const redisAsyncContext* async_context, int status) {
+  GetClient(async_context->data)->OnDisconnect(status);
+}
+
+void OnReplyEvent(redisAsyncContext* async_context, void* reply,
+                  void* privdata) {
+  GetClient(async_context->data)->OnReply(
+      static_cast<redisReply*>(reply),
+      static_cast<recommendation::RedisAsyncClient::ReplyCallback*>(privdata));
+}
+
+void OnAuthEvent(redisAsyncContext* async_context, void* reply,
+                 void* privdata) {
+  redisReply* redis_reply = static_cast<redisReply*>(reply);
+  if (!redis_reply || redis_reply->type != REDIS_REPLY_STATUS) {
+    LOG(ERROR) << "async password auth failed";
+  } else {
+    LOG(INFO) << "async password auth success";
+  }
+}
+
+bool IsStatusOk(redisReply* reply) {
+  return reply && reply->type == REDIS_REPLY_STATUS &&
+         string(reply->str) == "OK";
+}
+
+}  // namespace
+
+namespace recommendation {
+
+RedisAsyncClient::RedisAsyncClient()
+  : Thread(true),
+    async_context_(nullptr),
+    reading_(false),
+    writing_(false),
+    reconnect_sleep_(0),
+    shut_down_(false),
+    in_flight_cnt_(0) {
+  CHECK(InitConf()) << "Init conf failed";
+  CHECK_EQ(pipe(wakeup_fds_), 0) << "create wakeup pipe failed";
+  for (int i = 0; i < 2; ++i) {
+    int flags = fcntl(wakeup_fds_[i], F_GETFL, 0);
+    fcntl(wakeup_fds_[i], F_SETFL, flags | O_NONBLOCK);
+  }
+  LOG(INFO) << "Construct RedisAsyncClient";
+}
+
+RedisAsyncClient::~RedisAsyncClient() {
+  this->ShutDown();
+  this->Join();
+  close(wakeup_fds_[0]);
+  close(wakeup_fds_[1]);
+}
+
+void RedisAsyncClient::Run() {
+  LOG(INFO) << "start thread RedisAsyncClient";
+  while (!shut_down_) {
+    if (!async_context_) {
+      if (reconnect_sleep_ > 0) {
+        mobvoi::Sleep(reconnect_sleep_);
+      }
+      if (!Connect()) {
+        // fail fast rather than holding callers while redis is away
+        FailPending();
+        reconnect_sleep_ = std::min(std::max(reconnect_sleep_ << 1, 1),
+                                    FLAGS_redis_max_sleep);
+        continue;
+      }
+    }
+    SubmitPending();
+    struct pollfd fds[2];
+    fds[0].fd = wakeup_fds_[0];
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    int nfds = 1;
+    if (async_context_ && (reading_ || writing_)) {
+      fds[1].fd = async_context_->c.fd;
+      fds[1].events = (reading_ ? POLLIN : 0) | (writing_ ? POLLOUT : 0);
+      fds[1].revents = 0;
+      nfds = 2;
+    }
+    int ret = poll(fds, nfds, kPollTimeoutMs);
+    if (ret < 0) {
+      if (errno != EINTR) {
+        LOG(ERROR) << "poll failed, errno:" << errno;
+      }
+      continue;
+    }
+    if (fds[0].revents & POLLIN) {
+      DrainWakeup();
+    }
+    if (nfds == 2 && async_context_ &&
+        (fds[1].revents & (POLLIN | POLLERR | POLLHUP))) {
+      redisAsyncHandleRead(async_context_);
+    }
+    if (nfds == 2 && async_context_ && (fds[1].revents & POLLOUT)) {
+      redisAsyncHandleWrite(async_context_);
+    }
+  }
+  if (async_context_) {
+    // in flight callbacks are invoked with nullptr reply
+    redisAsyncFree(async_context_);
+    async_context_ = nullptr;
+  }
+  FailPending();
+  LOG(INFO) << "shut down RedisAsyncClient, id:" << this->GetThreadId();
+}
+
+void RedisAsyncClient::ShutDown() {
+  shut_down_ = true;
+  Wakeup();
+}
+
+void RedisAsyncClient::Command(const vector<string>& args,
+                               const ReplyCallback& callback) {
+  ++in_flight_cnt_;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PendingCommand command;
+    command.args = args;
+    command.callback = callback;
+    pending_commands_.push_back(command);
+  }
+  Wakeup();
+}
+
+void RedisAsyncClient::Get(const string& key, const StringCallback& callback) {
+  vector<string> args = {"GET", key};
+  Command(args, [key, callback](redisReply* reply) {
+    if (!reply || reply->type != REDIS_REPLY_STRING) {
+      VLOG(1) << "async get failed, key:" << key;
+      callback(false, "");
+      return;
+    }
+    callback(true, string(reply->str, reply->len));
+  });
+}
+
+void RedisAsyncClient::Set(const string& key, const string& value,
+                           uint32_t expire_seconds,
+                           const StatusCallback& callback) {
+  vector<string> args = {"SET", key, value};
+  if (expire_seconds > 0) {
+    // unlike the sync client the expire is set in the same command
+    args.push_back("EX");
+    args.push_back(IntToString(expire_seconds));
+  }
+  Command(args, [key, callback](redisReply* reply) {
+    bool success = IsStatusOk(reply);
+    if (!success) {
+      LOG(ERROR) << "async set failed, key:" << key;
+    }
+    callback(success);
+  });
+}
+
+void RedisAsyncClient::Hgetall(const string& key,
+                               const MapCallback& callback) {
+  vector<string> args = {"HGETALL", key};
+  Command(args, [key, callback](redisReply* reply) {
+    map<string, string> result_map;
+    if (!reply || reply->type != REDIS_REPLY_ARRAY || reply->elements == 0) {
+      VLOG(1) << "async hgetall failed, key:" << key;
+      callback(false, result_map);
+      return;
+    }
+    for (size_t i = 0; i + 1 < reply->elements; i += 2) {
+      redisReply* field = reply->element[i];
+      redisReply* value = reply->element[i + 1];
+      result_map[string(field->str, field->len)] =
+          string(value->str, value->len);
+    }
+    callback(true, result_map);
+  });
+}
+
+void RedisAsyncClient::Hmset(const string& key,
+                             const map<string, string>& data_map,
+                             const StatusCallback& callback) {
+  vector<string> args = {"HMSET", key};
+  for (auto& field_value : data_map) {
+    args.push_back(field_value.first);
+    args.push_back(field_value.second);
+  }
+  Command(args, [key, callback](redisReply* reply) {
+    bool success = IsStatusOk(reply);
+    if (!success) {
+      LOG(ERROR) << "async hmset failed, key:" << key;
+    }
+    callback(success);
+  });
+}
+
+void RedisAsyncClient::Expire(const string& key, int expire_time,
+                              const StatusCallback& callback) {
+  vector<string> args = {"EXPIRE", key, IntToString(expire_time)};
+  Command(args, [key, callback](redisReply* reply) {
+    bool success = reply && reply->type == REDIS_REPLY_INTEGER &&
+                   reply->integer == 1;
+    if (!success) {
+      LOG(ERROR) << "async expire failed, key:" << key;
+    }
+    callback(success);
+  });
+}
+
+int RedisAsyncClient::in_flight_count() const {
+  return in_flight_cnt_;
+}
+
+void RedisAsyncClient::AddRead() {
+  reading_ = true;
+}
+
+void RedisAsyncClient::DelRead() {
+  reading_ = false;
+}
+
+void RedisAsyncClient::AddWrite() {
+  writing_ = true;
+}
+
+void RedisAsyncClient::DelWrite() {
+  writing_ = false;
+}
+
+void RedisAsyncClient::CleanupEvents() {
+  reading_ = false;
+  writing_ = false;
+}
+
+void RedisAsyncClient::OnConnect(int status) {
+  if (status != REDIS_OK) {
+    // hiredis frees the context after a failed connect
+    LOG(ERROR) << "async connect failed, status:" << status;
+    async_context_ = nullptr;
+    reconnect_sleep_ = std::min(std::max(reconnect_sleep_ << 1, 1),
+                                FLAGS_redis_max_sleep);
+    return;
+  }
+  reconnect_sleep_ = 0;
+  LOG(INFO) << "async connect success";
+}
+
+void RedisAsyncClient::OnDisconnect(int status) {
+  LOG(WARNING) << "async disconnected, status:" << status;
+  async_context_ = nullptr;
+  CleanupEvents();
+}
+
+void RedisAsyncClient::OnReply(redisReply* reply, ReplyCallback* callback) {
+  --in_flight_cnt_;
+  (*callback)(reply);
+  delete callback;
+}
+
+bool RedisAsyncClient::InitConf() {
+  redis_conf_.reset(new RedisConf());
+  if (!file::ReadProtoFromTextFile(FLAGS_redis_conf, redis_conf_.get())) {
+    LOG(ERROR) << "read redis conf failed";
+    return false;
+  }
+  LOG(INFO) << "redis init config success";
+  return true;
+}
+
+bool RedisAsyncClient::Connect() {
+  redisAsyncContext* async_context = redisAsyncConnect(
+      redis_conf_->host().c_str(), redis_conf_->port());
+  if (!async_context || async_context->err) {
+    LOG(ERROR) << "redis async connect socket failed";
+    if (async_context) {
+      redisAsyncFree(async_context);
+    }
+    return false;
+  }
+  async_context->data = this;
+  async_context->ev.data = this;
+  async_context->ev.addRead = AddReadEvent;
+  async_context->ev.delRead = DelReadEvent;
+  async_context->ev.addWrite = AddWriteEvent;
+  async_context->ev.delWrite = DelWriteEvent;
+  async_context->ev.cleanup = CleanupEvent;
+  redisAsyncSetConnectCallback(async_context, OnConnectEvent);
+  redisAsyncSetDisconnectCallback(async_context, OnDisconnectEvent);
+  async_context_ = async_context;
+  reading_ = false;
+  writing_ = false;
+  if (redis_conf_->is_use_password()) {
+    // queued first, so it is executed before any pending command
+    const string& password = redis_conf_->password();
+    const char* argv[] = {"AUTH", password.c_str()};
+    size_t argvlen[] = {4, password.size()};
+    redisAsyncCommandArgv(async_context_, OnAuthEvent, nullptr,
+                          2, argv, argvlen);
+  }
+  return true;
+}
+
+void RedisAsyncClient::Wakeup() {
+  char c = 0;
+  if (write(wakeup_fds_[1], &c, 1) < 0 && errno != EAGAIN) {
+    LOG(ERROR) << "write wakeup pipe failed, errno:" << errno;
+  }
+}
+
+void RedisAsyncClient::DrainWakeup() {
+  char buffer[256];
+  while (read(wakeup_fds_[0], buffer, sizeof(buffer)) > 0) {}
+}
+
+void RedisAsyncClient::SubmitPending() {
+  vector<PendingCommand> commands;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    commands.swap(pending_commands_);
+  }
+  for (auto& command : commands) {
+    if (!async_context_) {
+      // the connection was lost while submitting, fail the rest
+      --in_flight_cnt_;
+      command.callback(nullptr);
+      continue;
+    }
+    vector<const char*> argv;
+    vector<size_t> argvlen;
+    for (auto& arg : command.args) {
+      argv.push_back(arg.c_str());
+      argvlen.push_back(arg.size());
+    }
+    ReplyCallback* callback = new ReplyCallback(command.callback);
+    if (redisAsyncCommandArgv(async_context_, OnReplyEvent, callback,
+                              argv.size(), &(argv[0]),
+                              &(argvlen[0])) != REDIS_OK) {
+      LOG(ERROR) << "async command failed, command:" << command.args[0];
+      delete callback;
+      --in_flight_cnt_;
+      command.callback(nullptr);
+    }
+  }
+}
+
+void RedisAsyncClient::FailPending() {
+  vector<PendingCommand> commands;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    commands.swap(pending_commands_);
+  }
+  for (auto& command : commands) {
+    --in_flight_cnt_;
+    command.callback(nullptr);
+  }
+}
+
+}  // namespace recommendation
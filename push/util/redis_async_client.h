@@ -0,0 +1,88 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#ifndef PUSH_UTIL_REDIS_ASYNC_CLIENT_H_
+#define PUSH_UTIL_REDIS_ASYNC_CLIENT_H_
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+#include "base/basictypes.h"
+#include "base/compat.h"
+#include "base/thread.h"
+#include "third_party/redis_client/async.h"
+#include "third_party/redis_client/hiredis.h"
+#include "push/proto/redis_meta.pb.h"
+
+namespace recommendation {
+
+// Redis client driven by its own event loop thread. Commands can be issued
+// from any thread and are pipelined on one connection, callbacks are run
+// on the event loop thread so they should be short and must not block.
+class RedisAsyncClient : public mobvoi::Thread {
+ public:
+  // reply is nullptr if the connection is lost before the reply arrives
+  typedef std::function<void(redisReply* reply)> ReplyCallback;
+  typedef std::function<void(bool success)> StatusCallback;
+  typedef std::function<void(bool success, const string& value)>
+      StringCallback;
+  typedef std::function<void(bool success,
+                             const map<string, string>& result_map)>
+      MapCallback;
+
+  RedisAsyncClient();
+  virtual ~RedisAsyncClient();
+  virtual void Run();
+  void ShutDown();
+
+  void Command(const vector<string>& args, const ReplyCallback& callback);
+  void Get(const string& key, const StringCallback& callback);
+  void Set(const string& key, const string& value, uint32_t expire_seconds,
+           const StatusCallback& callback);
+  void Hgetall(const string& key, const MapCallback& callback);
+  void Hmset(const string& key, const map<string, string>& data_map,
+             const StatusCallback& callback);
+  void Expire(const string& key, int expire_time,
+              const StatusCallback& callback);
+  int in_flight_count() const;
+
+  // hiredis event adapter hooks, only called on the event loop thread
+  void AddRead();
+  void DelRead();
+  void AddWrite();
+  void DelWrite();
+  void CleanupEvents();
+  void OnConnect(int status);
+  void OnDisconnect(int status);
+  void OnReply(redisReply* reply, ReplyCallback* callback);
+
+ private:
+  struct PendingCommand {
+    vector<string> args;
+    ReplyCallback callback;
+  };
+
+  bool InitConf();
+  bool Connect();
+  void Wakeup();
+  void DrainWakeup();
+  void SubmitPending();
+  void FailPending();
+
+  std::unique_ptr<RedisConf> redis_conf_;
+  redisAsyncContext* async_context_;
+  bool reading_;
+  bool writing_;
+  int reconnect_sleep_;
+  std::atomic<bool> shut_down_;
+  std::atomic<int> in_flight_cnt_;
+  int wakeup_fds_[2];
+  std::mutex mutex_;
+  vector<PendingCommand> pending_commands_;
+  DISALLOW_COPY_AND_ASSIGN(RedisAsyncClient);
+};
+
+}  // namespace recommendation
+
+#endif  // PUSH_UTIL_REDIS_ASYNC_CLIENT_H_
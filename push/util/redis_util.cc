@@ -18,11 +18,13 @@ DECLARE_string(redis_sub_topic);
 
 namespace {
 static const int kTotalFieldCnt = 20;
+static const int kDefaultPoolSize = 8;
+static const int kHealthCheckIdleSeconds = 30;
 }
 
 namespace recommendation {
 
-RedisBase::RedisBase() : redis_context_(nullptr) {}
+RedisBase::RedisBase() : redis_context_(nullptr), pending_reply_cnt_(0) {}
 
 RedisBase::~RedisBase() {}
 
@@ -238,19 +240,25 @@ bool RedisBase::Subscribe(const std::string& topic) {
 }
 
 bool RedisBase::Publish(const std::string& topic,
-                               const std::string& message) {
-  string cmd = "PUBLISH " + topic + " " + message;
-  redisReply* reply = nullptr;
-  reply = static_cast<redisReply*>(
-      redisCommand(redis_context_, cmd.c_str()));
+                        const std::string& message) {
+  // binary safe, the message may hold spaces and '%'
+  redisReply* reply = static_cast<redisReply*>(
+      redisCommand(redis_context_, "PUBLISH %b %b",
+                   topic.data(), topic.size(),
+                   message.data(), message.size()));
   if (!reply) {
-    LOG(FATAL) << "publish failed, command:" << cmd;
+    LOG(ERROR) << "publish failed, topic:" << topic;
+    return false;
+  }
+  if (reply->type != REDIS_REPLY_INTEGER) {
+    LOG(ERROR) << "publish error reply type:" << reply->type
+               << ", topic:" << topic;
+    freeReplyObject(reply);
     return false;
   }
-  int subscriber_cnt = reply->integer;
-  LOG(INFO) << "subscriber count:" << subscriber_cnt;
+  VLOG(1) << "publish success, topic:" << topic
+          << ", subscriber count:" << reply->integer;
   freeReplyObject(reply);
-  LOG(INFO) << "publish success, command:" << cmd;
   return true;
 }
 
@@ -313,31 +321,144 @@ bool RedisBase::Get(const string& key, string* value) {
   return success;
 }
 
-bool RedisBase::Keys(const string& pattern, vector<string>* keys) {
-  string cmd = StringPrintf("KEYS %s", pattern.c_str());
-  redisReply* reply = nullptr;
-  reply = static_cast<redisReply*>(
-      redisCommand(redis_context_, cmd.c_str()));
+bool RedisBase::Scan(
+    const string& pattern, int count,
+    const std::function<bool(const vector<string>& keys)>& callback) {
+  string cursor = "0";
+  string count_str = IntToString(count);
+  vector<string> batch_keys;
+  do {
+    const char* argv[] = {"SCAN", cursor.c_str(), "MATCH", pattern.c_str(),
+                          "COUNT", count_str.c_str()};
+    size_t argvlen[] = {4, cursor.size(), 5, pattern.size(),
+                        5, count_str.size()};
+    redisReply* reply = static_cast<redisReply*>(
+        redisCommandArgv(redis_context_, 6, argv, argvlen));
+    if (!reply) {
+      LOG(ERROR) << "reply null, scan pattern:" << pattern;
+      return false;
+    }
+    if (reply->type != REDIS_REPLY_ARRAY || reply->elements != 2 ||
+        reply->element[1]->type != REDIS_REPLY_ARRAY) {
+      LOG(ERROR) << "scan error reply type:" << reply->type;
+      freeReplyObject(reply);
+      return false;
+    }
+    cursor = string(reply->element[0]->str, reply->element[0]->len);
+    redisReply* keys_reply = reply->element[1];
+    batch_keys.clear();
+    for (size_t i = 0; i < keys_reply->elements; ++i) {
+      redisReply* sub_reply = keys_reply->element[i];
+      batch_keys.push_back(string(sub_reply->str, sub_reply->len));
+    }
+    freeReplyObject(reply);
+    if (!batch_keys.empty() && !callback(batch_keys)) {
+      VLOG(1) << "scan stopped by callback, pattern:" << pattern;
+      break;
+    }
+  } while (cursor != "0");
+  return true;
+}
+
+bool RedisBase::Ping() {
+  redisReply* reply = static_cast<redisReply*>(
+      redisCommand(redis_context_, "PING"));
   if (!reply) {
-    LOG(FATAL) << "set failed, command:" << cmd;
+    LOG(ERROR) << "reply null";
+    return false;
+  }
+  bool success = (reply->type == REDIS_REPLY_STATUS &&
+                  string(reply->str) == "PONG");
+  if (!success) {
+    LOG(ERROR) << "ping failed, reply type:" << reply->type;
+  }
+  freeReplyObject(reply);
+  return success;
+}
+
+bool RedisBase::AppendCommandArgv(const vector<string>& args) {
+  if (!redis_context_ || args.empty()) {
+    LOG(ERROR) << "append command failed, invalid context or empty args";
+    return false;
+  }
+  vector<const char*> argv;
+  vector<size_t> argvlen;
+  for (auto& arg : args) {
+    argv.push_back(arg.c_str());
+    argvlen.push_back(arg.size());
+  }
+  if (redisAppendCommandArgv(redis_context_,
+                             argv.size(),
+                             &(argv[0]),
+                             &(argvlen[0])) != REDIS_OK) {
+    LOG(ERROR) << "append command failed, command:" << args[0];
+    return false;
+  }
+  ++pending_reply_cnt_;
+  return true;
+}
+
+bool RedisBase::GetPipelineReplies(vector<redisReply*>* replies) {
+  bool success = true;
+  while (pending_reply_cnt_ > 0) {
+    --pending_reply_cnt_;
+    void* reply = nullptr;
+    if (redisGetReply(redis_context_, &reply) != REDIS_OK || !reply) {
+      // the context is broken after a failed read, remaining replies lost
+      LOG(ERROR) << "get pipeline reply failed, err:"
+                 << redis_context_->errstr;
+      pending_reply_cnt_ = 0;
+      success = false;
+      break;
+    }
+    replies->push_back(static_cast<redisReply*>(reply));
+  }
+  if (!success) {
+    FreeReplies(replies);
+  }
+  VLOG(1) << "pipeline replies size:" << replies->size();
+  return success;
+}
+
+void RedisBase::FreeReplies(vector<redisReply*>* replies) {
+  for (auto reply : *replies) {
+    freeReplyObject(reply);
+  }
+  replies->clear();
+}
+
+bool RedisBase::ScriptLoad(const string& script, string* sha) {
+  auto it = script_sha_map_.find(script);
+  if (it != script_sha_map_.end()) {
+    *sha = it->second;
+    return true;
+  }
+  const char* argv[] = {"SCRIPT", "LOAD", script.c_str()};
+  size_t argvlen[] = {6, 4, script.size()};
+  redisReply* reply = static_cast<redisReply*>(
+      redisCommandArgv(redis_context_, 3, argv, argvlen));
+  if (!reply) {
+    LOG(ERROR) << "reply null";
     return false;
   }
   bool success = false;
-  if (reply->elements == 0) {
-    LOG(WARNING) << "reply array is empty";
-    success = false;
-  } else {
+  if (reply->type == REDIS_REPLY_STRING) {
+    *sha = string(reply->str, reply->len);
+    script_sha_map_[script] = *sha;
+    LOG(INFO) << "script load success, sha:" << *sha;
     success = true;
+  } else {
+    LOG(ERROR) << "script load failed, reply type:" << reply->type;
+    success = false;
   }
-  for (size_t i = 0 ; i < reply->elements; ++i) {
-    redisReply* sub_reply = reply->element[i];
-    keys->push_back(sub_reply->str);
-  }
-  VLOG(1) << "keys size:" << keys->size();
   freeReplyObject(reply);
   return success;
 }
 
+void RedisBase::ClearScriptCache() {
+  script_sha_map_.clear();
+}
+
 RedisClient::RedisClient() {
   bool ret = InitConf();
   CHECK_EQ(ret, true);
@@ -358,6 +479,7 @@ bool RedisClient::InitConf() {
 }
 
 bool RedisClient::InitConnection() {
+  pending_reply_cnt_ = 0;
   redis_context_ = redisConnect(redis_conf_->host().c_str(),
                                 redis_conf_->port());
   if (!redis_context_ || redis_context_->err) {
@@ -433,6 +555,7 @@ bool RedisReuseClient::Connect() {
 }
 
 void RedisReuseClient::Cleanup() {
+  pending_reply_cnt_ = 0;
   if (redis_context_) {
     redisFree(redis_context_);
     redis_context_ = nullptr;
@@ -440,6 +563,182 @@ void RedisReuseClient::Cleanup() {
   }
 }
 
+RedisPooledConnection::RedisPooledConnection(const RedisConf& redis_conf)
+  : last_used_time_(0) {
+  redis_conf_.reset(new RedisConf(redis_conf));
+}
+
+RedisPooledConnection::~RedisPooledConnection() {
+  Cleanup();
+}
+
+bool RedisPooledConnection::Connect() {
+  Cleanup();
+  redis_context_ = redisConnect(redis_conf_->host().c_str(),
+                                redis_conf_->port());
+  if (!redis_context_ || redis_context_->err) {
+    LOG(ERROR) << "redis connect socket failed";
+    return false;
+  }
+  if (redis_conf_->is_use_password()) {
+    if (!Auth(redis_conf_->password())) {
+      LOG(ERROR) << "password auth failed";
+      return false;
+    }
+  }
+  last_used_time_ = time(NULL);
+  LOG(INFO) << "Connect success";
+  return true;
+}
+
+bool RedisPooledConnection::CheckHealth() {
+  if (!redis_context_ || redis_context_->err) {
+    LOG(WARNING) << "pooled connection broken, reconnect";
+    return Connect();
+  }
+  if (time(NULL) - last_used_time_ >= kHealthCheckIdleSeconds && !Ping()) {
+    LOG(WARNING) << "pooled connection ping failed, reconnect";
+    return Connect();
+  }
+  return true;
+}
+
+void RedisPooledConnection::set_last_used_time(time_t last_used_time) {
+  last_used_time_ = last_used_time;
+}
+
+void RedisPooledConnection::Cleanup() {
+  pending_reply_cnt_ = 0;
+  if (redis_context_) {
+    redisFree(redis_context_);
+    redis_context_ = nullptr;
+  }
+}
+
+RedisLease::RedisLease(RedisConnectionPool* pool,
+                       RedisPooledConnection* connection)
+  : pool_(pool), connection_(connection) {}
+
+RedisLease::RedisLease(RedisLease&& other)
+  : pool_(other.pool_),
+    connection_(other.connection_) {
+  other.connection_ = nullptr;
+}
+
+RedisLease::~RedisLease() {
+  if (connection_) {
+    pool_->Release(connection_, false);
+  }
+}
+
+bool RedisLease::ok() const {
+  return connection_ != nullptr;
+}
+
+RedisBase* RedisLease::get() const {
+  return connection_;
+}
+
+RedisBase* RedisLease::operator->() const {
+  CHECK(connection_) << "lease without connection";
+  return connection_;
+}
+
+RedisConnectionPool::RedisConnectionPool()
+  : max_size_(kDefaultPoolSize), total_cnt_(0) {
+  CHECK(InitConf()) << "Init conf failed";
+  if (redis_conf_->conn_num() > 0) {
+    max_size_ = redis_conf_->conn_num();
+  }
+  LOG(INFO) << "Construct RedisConnectionPool, max_size:" << max_size_;
+}
+
+RedisConnectionPool::~RedisConnectionPool() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto connection : idle_connections_) {
+    delete connection;
+  }
+  idle_connections_.clear();
+}
+
+RedisLease RedisConnectionPool::Borrow() {
+  RedisPooledConnection* connection = nullptr;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] {
+      return !idle_connections_.empty() || total_cnt_ < max_size_;
+    });
+    if (!idle_connections_.empty()) {
+      // most recently used first, it is least likely to need a ping
+      connection = idle_connections_.back();
+      idle_connections_.pop_back();
+    } else {
+      ++total_cnt_;
+    }
+  }
+  if (!connection) {
+    connection = new RedisPooledConnection(*redis_conf_);
+    if (!ConnectWithBackoff(connection)) {
+      Release(connection, true);
+      return RedisLease(this, nullptr);
+    }
+  } else if (!connection->CheckHealth() && !ConnectWithBackoff(connection)) {
+    Release(connection, true);
+    return RedisLease(this, nullptr);
+  }
+  return RedisLease(this, connection);
+}
+
+int RedisConnectionPool::idle_count() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return idle_connections_.size();
+}
+
+int RedisConnectionPool::total_count() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return total_cnt_;
+}
+
+bool RedisConnectionPool::InitConf() {
+  redis_conf_.reset(new RedisConf());
+  if (!file::ReadProtoFromTextFile(FLAGS_redis_conf, redis_conf_.get())) {
+    LOG(ERROR) << "read redis conf failed";
+    return false;
+  }
+  LOG(INFO) << "redis init config success";
+  return true;
+}
+
+bool RedisConnectionPool::ConnectWithBackoff(
+    RedisPooledConnection* connection) {
+  // try to connect with exponential backoff
+  for (int sec = 1; sec <= FLAGS_redis_max_sleep; sec = sec << 1) {
+    if (connection->Connect()) {
+      return true;
+    }
+    if (sec <= FLAGS_redis_max_sleep / 2) {
+      Sleep(sec);
+    }
+  }
+  LOG(ERROR) << "pooled connection connect failed";
+  return false;
+}
+
+void RedisConnectionPool::Release(RedisPooledConnection* connection,
+                                  bool discard) {
+  redisContext* redis_context = connection->redis_context();
+  if (!discard && redis_context && !redis_context->err) {
+    connection->set_last_used_time(time(NULL));
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_connections_.push_back(connection);
+  } else {
+    delete connection;
+    std::lock_guard<std::mutex> lock(mutex_);
+    --total_cnt_;
+  }
+  cond_.notify_one();
+}
+
 RedisSubThread::RedisSubThread(
     std::shared_ptr<ConcurrentQueue<string>> message_queue,
     const std::string& topic)
@@ -457,36 +756,29 @@ RedisSubThread::~RedisSubThread() {
 }
 
 void RedisSubThread::Run() {
-  redisContext* redis_context = redis_client_->redis_context();
-  if (!redis_context || redis_context->err) {
-    LOG(FATAL) << "Init subscribe socket fatal failed";
-    abort();
-  }
-  if (!redis_client_->Subscribe(topic_)) {
-    LOG(FATAL) << "Init subscribe command fatal failed";
-    abort();
-  }
-  while (true) {
-    if (shut_down_) {
-      LOG(INFO) << "shut down redis sub thread, id:" << this->GetThreadId();
-      break;
+  while (!shut_down_) {
+    if (!redis_client_->Subscribe(topic_)) {
+      LOG(FATAL) << "Subscribe fatal failed";
+      abort();
     }
-    if (!redis_context->err) {
+    redisContext* redis_context = redis_client_->redis_context();
+    while (!shut_down_ && !redis_context->err) {
       void* reply = nullptr;
       if (redisGetReply(redis_context, &reply) == REDIS_OK) {
         LOG(INFO) << "Sub a new message";
         ProcessMessage(reply);
         freeReplyObject(reply);
       }
-    } else {
-      if (!redis_client_->ReConnect() || !redis_client_->Subscribe(topic_)) {
+    }
+    if (!shut_down_) {
+      LOG(WARNING) << "subscribe socket broken, resubscribe";
+      if (!redis_client_->ReConnect()) {
         LOG(FATAL) << "Resubscribe fatal failed";
         abort();
-      } else {
-        LOG(INFO) << "Resubscribe success";
       }
     }
   }
+  LOG(INFO) << "shut down redis sub thread, id:" << this->GetThreadId();
 }
 
 bool RedisSubThread::ProcessMessage(void* reply) {
@@ -4,12 +4,16 @@
 #ifndef PUSH_UTIL_REDIS_UTIL_H_
 #define PUSH_UTIL_REDIS_UTIL_H_
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <mutex>
 
 #include "base/basictypes.h"
 #include "base/compat.h"
 #include "base/concurrent_queue.h"
 #include "base/log.h"
+#include "base/singleton.h"
 #include "base/thread.h"
 #include "third_party/redis_client/async.h"
 #include "third_party/redis_client/hiredis.h"
@@ -35,12 +39,33 @@ class RedisBase {
   bool Publish(const std::string& topic, const std::string& message);
   bool Set(const string& key, const string& value, uint32_t expire_seconds);
   bool Get(const string& key, string* value);
-  bool Keys(const string& pattern, vector<string>* keys);
+  // Walks the keyspace with SCAN, count is the batch hint for the server.
+  // Every batch is passed to the callback, return false to stop early.
+  // Keys may be reported more than once if they change during the scan.
+  bool Scan(const string& pattern, int count,
+            const std::function<bool(const vector<string>& keys)>& callback);
+  bool Ping();
+
+  // Pipelined commands: append N commands to the output buffer, then
+  // flush them and read all N replies in one round trip. The caller owns
+  // the returned replies and releases them with FreeReplies.
+  bool AppendCommandArgv(const vector<string>& args);
+  bool GetPipelineReplies(vector<redisReply*>* replies);
+  static void FreeReplies(vector<redisReply*>* replies);
+
+  // Loads a lua script into the server script cache, the sha is cached
+  // locally so that EVALSHA can be appended into a pipeline directly.
+  bool ScriptLoad(const string& script, string* sha);
+  void ClearScriptCache();
 
   std::unique_ptr<RedisConf> redis_conf_;
   redisContext* redis_context_;
 
+ protected:
+  int pending_reply_cnt_;
+
  private:
+  map<string, string> script_sha_map_;
   DISALLOW_COPY_AND_ASSIGN(RedisBase);
 };
 
@@ -70,6 +95,68 @@ class RedisReuseClient : public RedisBase {
   DISALLOW_COPY_AND_ASSIGN(RedisReuseClient);
 };
 
+class RedisPooledConnection : public RedisBase {
+ public:
+  explicit RedisPooledConnection(const RedisConf& redis_conf);
+  virtual ~RedisPooledConnection();
+  bool Connect();
+  // Broken sockets are reconnected, sockets idle for a while are pinged.
+  bool CheckHealth();
+  void set_last_used_time(time_t last_used_time);
+
+ private:
+  void Cleanup();
+
+  time_t last_used_time_;
+  DISALLOW_COPY_AND_ASSIGN(RedisPooledConnection);
+};
+
+class RedisConnectionPool;
+
+// RAII lease of a pooled connection, returned to the pool on destruction.
+class RedisLease {
+ public:
+  RedisLease(RedisConnectionPool* pool, RedisPooledConnection* connection);
+  RedisLease(RedisLease&& other);
+  ~RedisLease();
+  bool ok() const;
+  RedisBase* get() const;
+  RedisBase* operator->() const;
+
+ private:
+  RedisConnectionPool* pool_;
+  RedisPooledConnection* connection_;
+  DISALLOW_COPY_AND_ASSIGN(RedisLease);
+};
+
+// Thread safe bounded pool of redis connections configured by
+// --redis_conf, conn_num in the config is the pool size.
+class RedisConnectionPool {
+ public:
+  ~RedisConnectionPool();
+  // Blocks while all connections are leased, the returned lease is not ok
+  // if connecting failed after the --redis_max_sleep backoff.
+  RedisLease Borrow();
+  int idle_count();
+  int total_count();
+
+ private:
+  friend struct DefaultSingletonTraits<RedisConnectionPool>;
+  friend class RedisLease;
+  RedisConnectionPool();
+  bool InitConf();
+  bool ConnectWithBackoff(RedisPooledConnection* connection);
+  void Release(RedisPooledConnection* connection, bool discard);
+
+  std::unique_ptr<RedisConf> redis_conf_;
+  int max_size_;
+  int total_cnt_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<RedisPooledConnection*> idle_connections_;
+  DISALLOW_COPY_AND_ASSIGN(RedisConnectionPool);
+};
+
 class RedisSubThread : public Thread {
  public:
   RedisSubThread(std::shared_ptr<ConcurrentQueue<string>> message_queue,
@@ -82,6 +169,8 @@ class RedisSubThread : public Thread {
  private:
   bool shut_down_;
   std::string topic_;
+  // a subscribed socket can not serve other commands, so it is kept out
+  // of RedisConnectionPool instead of holding one of its slots forever
   std::unique_ptr<RedisReuseClient> redis_client_;
   std::shared_ptr<ConcurrentQueue<string>> message_queue_;
   DISALLOW_COPY_AND_ASSIGN(RedisSubThread);
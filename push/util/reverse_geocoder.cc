@@ -0,0 +1,174 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/util/reverse_geocoder.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "base/file/simple_line_reader.h"
+#include "base/log.h"
+#include "base/string_util.h"
+
+namespace {
+
+static const char kGeohashBase32[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+
+}
+
+namespace recommendation {
+
+ReverseGeocoder::ReverseGeocoder(double cell_degrees)
+  : cell_degrees_(cell_degrees) {
+  CHECK_GT(cell_degrees_, 0);
+}
+
+ReverseGeocoder::~ReverseGeocoder() {}
+
+bool ReverseGeocoder::LoadFromFile(const string& file_path) {
+  vector<string> lines;
+  file::SimpleLineReader reader(file_path);
+  if (!reader.ReadLines(&lines)) {
+    LOG(ERROR) << "read city boundary file failed:" << file_path;
+    return false;
+  }
+  int bad_cnt = 0;
+  for (auto& line : lines) {
+    if (!AddCity(line)) {
+      ++bad_cnt;
+    }
+  }
+  LOG(INFO) << "loaded city boundaries:" << cities_.size()
+            << ", bad lines:" << bad_cnt << ", cells:" << cells_.size();
+  return !cities_.empty();
+}
+
+bool ReverseGeocoder::AddCity(const string& line) {
+  vector<string> columns;
+  SplitString(line, '\t', &columns);
+  if (columns.size() != 5) {
+    return false;
+  }
+  City city;
+  city.country = columns[0];
+  city.province = columns[1];
+  city.city = columns[2];
+  city.adcode = columns[3];
+  vector<string> points;
+  SplitString(columns[4], ';', &points);
+  for (auto& point_string : points) {
+    vector<string> lng_lat;
+    SplitString(point_string, ',', &lng_lat);
+    if (lng_lat.size() != 2) {
+      return false;
+    }
+    Point point;
+    point.lng = StringToDouble(lng_lat[0]);
+    point.lat = StringToDouble(lng_lat[1]);
+    if (city.boundary.empty()) {
+      city.min_lat = city.max_lat = point.lat;
+      city.min_lng = city.max_lng = point.lng;
+    } else {
+      city.min_lat = std::min(city.min_lat, point.lat);
+      city.max_lat = std::max(city.max_lat, point.lat);
+      city.min_lng = std::min(city.min_lng, point.lng);
+      city.max_lng = std::max(city.max_lng, point.lng);
+    }
+    city.boundary.push_back(point);
+  }
+  if (city.boundary.size() < 3) {
+    return false;
+  }
+  int city_index = static_cast<int>(cities_.size());
+  for (int lat_index = CellIndex(city.min_lat);
+       lat_index <= CellIndex(city.max_lat); ++lat_index) {
+    for (int lng_index = CellIndex(city.min_lng);
+         lng_index <= CellIndex(city.max_lng); ++lng_index) {
+      cells_[CellKey(lat_index, lng_index)].push_back(city_index);
+    }
+  }
+  cities_.push_back(city);
+  return true;
+}
+
+bool ReverseGeocoder::Lookup(double lat, double lng,
+                             LocationInfo* location_info) const {
+  auto it = cells_.find(CellKey(CellIndex(lat), CellIndex(lng)));
+  if (it == cells_.end()) {
+    return false;
+  }
+  for (int city_index : it->second) {
+    const City& city = cities_[city_index];
+    if (!Contains(city, lat, lng)) {
+      continue;
+    }
+    location_info->set_country(city.country);
+    location_info->set_province(city.province);
+    location_info->set_city(city.city);
+    location_info->set_adcode(city.adcode);
+    location_info->set_lat(lat);
+    location_info->set_lng(lng);
+    return true;
+  }
+  return false;
+}
+
+int64 ReverseGeocoder::CellKey(int lat_index, int lng_index) const {
+  return (static_cast<int64>(lat_index) << 32) |
+         static_cast<uint32>(lng_index);
+}
+
+int ReverseGeocoder::CellIndex(double degrees) const {
+  return static_cast<int>(floor(degrees / cell_degrees_));
+}
+
+bool ReverseGeocoder::Contains(const City& city, double lat, double lng) {
+  if (lat < city.min_lat || lat > city.max_lat ||
+      lng < city.min_lng || lng > city.max_lng) {
+    return false;
+  }
+  // ray casting towards increasing lng
+  bool is_inside = false;
+  const vector<Point>& boundary = city.boundary;
+  for (size_t i = 0, j = boundary.size() - 1; i < boundary.size(); j = i++) {
+    if ((boundary[i].lat > lat) != (boundary[j].lat > lat) &&
+        lng < (boundary[j].lng - boundary[i].lng) *
+              (lat - boundary[i].lat) /
+              (boundary[j].lat - boundary[i].lat) + boundary[i].lng) {
+      is_inside = !is_inside;
+    }
+  }
+  return is_inside;
+}
+
+string EncodeGeohash(double lat, double lng, int precision) {
+  double lat_range[2] = {-90.0, 90.0};
+  double lng_range[2] = {-180.0, 180.0};
+  string geohash;
+  geohash.reserve(precision);
+  bool is_lng = true;
+  int bit_cnt = 0;
+  int index = 0;
+  while (static_cast<int>(geohash.size()) < precision) {
+    double* range = is_lng ? lng_range : lat_range;
+    double value = is_lng ? lng : lat;
+    double mid = (range[0] + range[1]) / 2;
+    index <<= 1;
+    if (value >= mid) {
+      index |= 1;
+      range[0] = mid;
+    } else {
+      range[1] = mid;
+    }
+    is_lng = !is_lng;
+    if (++bit_cnt == 5) {
+      geohash.push_back(kGeohashBase32[index]);
+      bit_cnt = 0;
+      index = 0;
+    }
+  }
+  return geohash;
+}
+
+}  // namespace recommendation
@@ -0,0 +1,67 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#ifndef PUSH_UTIL_REVERSE_GEOCODER_H_
+#define PUSH_UTIL_REVERSE_GEOCODER_H_
+
+#include <unordered_map>
+
+#include "base/basictypes.h"
+#include "base/compat.h"
+
+#include "push/proto/user_device_meta.pb.h"
+
+namespace recommendation {
+
+// City level reverse geocoding from the city boundaries of an offline
+// file. The boundaries are bucketed into a grid of cell_degrees cells, a
+// lookup only tests the few boundaries overlapping the cell of the point.
+class ReverseGeocoder {
+ public:
+  explicit ReverseGeocoder(double cell_degrees);
+  ~ReverseGeocoder();
+  // Lines of "country\tprovince\tcity\tadcode\tlng,lat;lng,lat;...", a
+  // city with several parts has one line per part.
+  bool LoadFromFile(const string& file_path);
+  bool AddCity(const string& line);
+  // Fills country, province, city, adcode, lat and lng, returns false if
+  // no boundary holds the point.
+  bool Lookup(double lat, double lng, LocationInfo* location_info) const;
+  size_t city_size() const {
+    return cities_.size();
+  }
+
+ private:
+  struct Point {
+    double lat;
+    double lng;
+  };
+  struct City {
+    string country;
+    string province;
+    string city;
+    string adcode;
+    vector<Point> boundary;
+    double min_lat;
+    double max_lat;
+    double min_lng;
+    double max_lng;
+  };
+
+  int64 CellKey(int lat_index, int lng_index) const;
+  int CellIndex(double degrees) const;
+  static bool Contains(const City& city, double lat, double lng);
+
+  double cell_degrees_;
+  vector<City> cities_;
+  // cell key to the cities whose bounding box overlaps the cell
+  std::unordered_map<int64, vector<int>> cells_;
+  DISALLOW_COPY_AND_ASSIGN(ReverseGeocoder);
+};
+
+// Standard base32 geohash of the point.
+string EncodeGeohash(double lat, double lng, int precision);
+
+}  // namespace recommendation
+
+#endif  // PUSH_UTIL_REVERSE_GEOCODER_H_
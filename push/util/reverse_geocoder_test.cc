@@ -0,0 +1,38 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "push/util/reverse_geocoder.h"
+
+#include "third_party/gtest/gtest.h"
+
+using namespace recommendation;
+
+TEST(ReverseGeocoder, Lookup) {
+  ReverseGeocoder reverse_geocoder(0.5);
+  // a square around Beijing and a triangle east of it
+  EXPECT_TRUE(reverse_geocoder.AddCity(
+      u8"中国\t北京市\t北京市\t110000\t"
+      "115.4,39.4;117.5,39.4;117.5,41.1;115.4,41.1"));
+  EXPECT_TRUE(reverse_geocoder.AddCity(
+      u8"中国\t天津市\t天津市\t120000\t117.5,38.5;118.5,38.5;117.5,40.0"));
+  EXPECT_FALSE(reverse_geocoder.AddCity(u8"中国\t北京市\t北京市\t110000"));
+  EXPECT_FALSE(reverse_geocoder.AddCity(
+      u8"中国\t北京市\t北京市\t110000\t115.4,39.4;117.5,39.4"));
+  EXPECT_EQ(2u, reverse_geocoder.city_size());
+
+  LocationInfo location_info;
+  EXPECT_TRUE(reverse_geocoder.Lookup(39.9, 116.4, &location_info));
+  EXPECT_EQ(u8"北京市", location_info.city());
+  EXPECT_EQ("110000", location_info.adcode());
+  EXPECT_TRUE(reverse_geocoder.Lookup(38.8, 117.8, &location_info));
+  EXPECT_EQ(u8"天津市", location_info.city());
+  // inside the bounding box of the triangle only
+  EXPECT_FALSE(reverse_geocoder.Lookup(39.8, 118.4, &location_info));
+  EXPECT_FALSE(reverse_geocoder.Lookup(31.2, 121.5, &location_info));
+}
+
+TEST(ReverseGeocoder, EncodeGeohash) {
+  EXPECT_EQ("u4pruydqqvj", EncodeGeohash(57.64911, 10.40744, 11));
+  EXPECT_EQ("wx4g0", EncodeGeohash(39.92324, 116.3906, 5));
+  EXPECT_EQ("", EncodeGeohash(39.92324, 116.3906, 0));
+}
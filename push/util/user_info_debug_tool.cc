@@ -12,6 +12,8 @@ using namespace recommendation;
 
 DEFINE_bool(enable_load_devices, true, "");
 DEFINE_int32(mysql_page_size, 10000, "");
+DEFINE_int32(device_cache_seconds, 600, "");
+DEFINE_int32(device_cache_size, 200000, "");
 DEFINE_string(mysql_config,
     "config/recommendation/news/recommender/mysql.conf", "");
 
@@ -3,6 +3,8 @@
 
 #include "push/util/user_info_helper.h"
 
+#include <algorithm>
+
 #include "base/hash.h"
 #include "base/log.h"
 #include "base/string_util.h"
@@ -11,10 +13,16 @@
 #include "push/util/common_util.h"
 
 DECLARE_int32(mysql_page_size);
+DECLARE_int32(device_cache_seconds);
+DECLARE_int32(device_cache_size);
 DECLARE_string(mysql_config);
 
 namespace {
 
+static const size_t kDeviceCacheShardNum = 32;
+// a device registered meanwhile is found at most this late
+static const int kDeviceNegativeCacheSeconds = 30;
+
 static const char kQueryAllDeviceSQL[] =
     "SELECT id, device_type, bluetooth_match_id, updated, wear_model, "
     "wear_version, wear_version_channel, wear_os, phone_model, "
@@ -38,7 +46,12 @@ static const char kQueryDeviceByUserSQL[] =
 
 namespace recommendation {
 
-DeviceInfoHelper::DeviceInfoHelper() {}
+DeviceInfoHelper::DeviceInfoHelper() : device_query_cnt_(0) {
+  if (FLAGS_device_cache_seconds > 0) {
+    device_cache_.reset(new ShardedLruCache<DeviceInfo>(
+        static_cast<size_t>(FLAGS_device_cache_size), kDeviceCacheShardNum));
+  }
+}
 
 DeviceInfoHelper::~DeviceInfoHelper() {}
 
@@ -53,8 +66,57 @@ bool DeviceInfoHelper::GetDeviceCoordinate(const string& device,
   return true;
 }
 
-bool DeviceInfoHelper::GetDeviceInfo(const string& device_id, 
+bool DeviceInfoHelper::GetDeviceInfo(const string& device_id,
                                      DeviceInfo* device_info) {
+  if (!device_cache_) {
+    return QueryDeviceInfo(device_id, device_info) &&
+           !device_info->id().empty();
+  }
+  if (device_cache_->Get(device_id, device_info)) {
+    // an unknown device is cached without id
+    return !device_info->id().empty();
+  }
+  if (!QueryDeviceInfo(device_id, device_info)) {
+    // a db error says nothing about the device, the next call asks again
+    return false;
+  }
+  if (device_info->id().empty()) {
+    device_cache_->Put(device_id, DeviceInfo(),
+                       std::min(kDeviceNegativeCacheSeconds,
+                                FLAGS_device_cache_seconds));
+    return false;
+  }
+  device_cache_->Put(device_id, *device_info, FLAGS_device_cache_seconds);
+  return true;
+}
+
+void DeviceInfoHelper::InvalidateDevice(const string& device_id) {
+  if (device_cache_) {
+    device_cache_->Erase(device_id);
+  }
+}
+
+void DeviceInfoHelper::GetDeviceCacheStats(Json::Value* stats) {
+  uint64 query_cnt = device_query_cnt_;
+  (*stats)["query_cnt"] = static_cast<Json::UInt64>(query_cnt);
+  if (!device_cache_) {
+    return;
+  }
+  uint64 hit_cnt = device_cache_->hit_count();
+  uint64 miss_cnt = device_cache_->miss_count();
+  uint64 total_cnt = hit_cnt + miss_cnt;
+  (*stats)["size"] = static_cast<Json::UInt64>(device_cache_->size());
+  (*stats)["hit_cnt"] = static_cast<Json::UInt64>(hit_cnt);
+  (*stats)["miss_cnt"] = static_cast<Json::UInt64>(miss_cnt);
+  (*stats)["hit_ratio"] = total_cnt > 0 ?
+      static_cast<double>(hit_cnt) / total_cnt : 0.0;
+  (*stats)["db_fallthrough_ratio"] = total_cnt > 0 ?
+      static_cast<double>(query_cnt) / total_cnt : 0.0;
+}
+
+bool DeviceInfoHelper::QueryDeviceInfo(const string& device_id,
+                                       DeviceInfo* device_info) {
+  ++device_query_cnt_;
   string command = StringPrintf(kQueryDeviceSQL, device_id.c_str());
   VLOG(2) << "Command:" << command;
   Json::Value data;
@@ -4,6 +4,8 @@
 #ifndef PUSH_UTIL_USER_INFO_HELPER_H_
 #define PUSH_UTIL_USER_INFO_HELPER_H_
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 
 #include "base/basictypes.h"
@@ -13,6 +15,7 @@
 #include "third_party/jsoncpp/json.h"
 
 #include "push/proto/user_device_meta.pb.h"
+#include "push/util/cache_util.h"
 
 namespace recommendation {
 
@@ -21,7 +24,12 @@ class DeviceInfoHelper {
   ~DeviceInfoHelper();
   bool GetDeviceCoordinate(const string& device_id,
                            string* latitude, string* longitude);
+  // Read through a cache of --device_cache_seconds, 0 disables it. Unknown
+  // devices are cached too, for a shorter time, db errors are not cached.
   bool GetDeviceInfo(const string& device, DeviceInfo* device_info);
+  // Drops the cached info of a device whose row changed.
+  void InvalidateDevice(const string& device_id);
+  void GetDeviceCacheStats(Json::Value* stats);
   bool GetDeviceByUser(const string& user_id, string* device_id);
   void GetClusterDeviceId(uint32 node_pos, uint32 node_cnt,
                           vector<string>* devices);
@@ -37,7 +45,11 @@ class DeviceInfoHelper {
   DeviceInfoHelper();
   void QueryAllInternal(const char* query_sql_format,
                         int32 page_size, Json::Value* result);
+  // Returns false on a db error only, an unknown device has no id.
+  bool QueryDeviceInfo(const string& device, DeviceInfo* device_info);
 
+  std::unique_ptr<ShardedLruCache<DeviceInfo>> device_cache_;
+  std::atomic<uint64> device_query_cnt_;
   DISALLOW_COPY_AND_ASSIGN(DeviceInfoHelper);
 };
 
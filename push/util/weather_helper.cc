@@ -5,12 +5,23 @@
 
 #include "base/log.h"
 #include "base/string_util.h"
+#include "base/time.h"
 #include "third_party/gflags/gflags.h"
 #include "util/net/http_client/http_client.h"
 
 #include "push/util/common_util.h"
 
 DECLARE_string(weather_service);
+DECLARE_int32(weather_cache_update_seconds);
+DECLARE_int32(weather_warmup_hour);
+DECLARE_int32(weather_warmup_lead_seconds);
+
+namespace {
+
+static const size_t kWeatherCacheSize = 10000;
+static const int kCityRetentionSeconds = 24 * 3600;
+
+}
 
 namespace push_controller {
 
@@ -20,6 +31,14 @@ WeatherHelper::~WeatherHelper() {}
 
 bool WeatherHelper::FetchWeather(const string& city,
                                   WeatherInfo* weather_info) {
+  if (FLAGS_weather_cache_update_seconds <= 0) {
+    return FetchWeatherUncached(city, weather_info);
+  }
+  return Singleton<WeatherCache>::get()->Get(city, weather_info);
+}
+
+bool WeatherHelper::FetchWeatherUncached(const string& city,
+                                          WeatherInfo* weather_info) {
   Json::Value response;
   if (!FetchWeather(city, &response)) {
     return false;
@@ -225,4 +244,125 @@ void WeatherHelper::SetPageData(const Json::Value& page_data,
   }
 }
 
+WeatherCache::WeatherCache()
+  : cache_(kWeatherCacheSize),
+    upstream_cnt_(0),
+    upstream_fail_cnt_(0),
+    warmup_cnt_(0) {}
+
+WeatherCache::~WeatherCache() {}
+
+bool WeatherCache::Get(const string& city, WeatherInfo* weather_info) {
+  time_t now = time(NULL);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cities_[city] = now;
+  }
+  if (cache_.Get(city, weather_info)) {
+    return true;
+  }
+  auto loader = [this, &city](WeatherInfo* loaded_info) {
+    return Fetch(city, loaded_info);
+  };
+  if (!single_flight_.Do(city, loader, weather_info)) {
+    return false;
+  }
+  cache_.Put(city, *weather_info,
+             CacheSeconds(now, FLAGS_weather_cache_update_seconds));
+  return true;
+}
+
+void WeatherCache::Warmup(int lead_seconds) {
+  time_t now = time(NULL);
+  vector<string> cities;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = cities_.begin(); it != cities_.end();) {
+      if (it->second + kCityRetentionSeconds <= now) {
+        it = cities_.erase(it);
+        continue;
+      }
+      cities.push_back(it->first);
+      ++it;
+    }
+  }
+  int ttl = lead_seconds + CacheSeconds(now + lead_seconds,
+                                        FLAGS_weather_cache_update_seconds);
+  int success_cnt = 0;
+  for (auto& city : cities) {
+    WeatherInfo weather_info;
+    if (!Fetch(city, &weather_info)) {
+      continue;
+    }
+    cache_.Put(city, weather_info, ttl);
+    ++success_cnt;
+  }
+  ++warmup_cnt_;
+  LOG(INFO) << "weather cache warmed up, cities:" << cities.size()
+            << ", success:" << success_cnt << ", ttl:" << ttl;
+}
+
+void WeatherCache::GetStats(Json::Value* stats) {
+  uint64 hit_cnt = cache_.hit_count();
+  uint64 miss_cnt = cache_.miss_count();
+  (*stats)["size"] = static_cast<Json::UInt64>(cache_.size());
+  (*stats)["hit_cnt"] = static_cast<Json::UInt64>(hit_cnt);
+  (*stats)["miss_cnt"] = static_cast<Json::UInt64>(miss_cnt);
+  (*stats)["hit_ratio"] = hit_cnt + miss_cnt > 0 ?
+      static_cast<double>(hit_cnt) / (hit_cnt + miss_cnt) : 0.0;
+  (*stats)["shared_cnt"] =
+      static_cast<Json::UInt64>(single_flight_.shared_count());
+  (*stats)["upstream_cnt"] = static_cast<Json::UInt64>(upstream_cnt_);
+  (*stats)["upstream_fail_cnt"] =
+      static_cast<Json::UInt64>(upstream_fail_cnt_);
+  (*stats)["warmup_cnt"] = static_cast<Json::UInt64>(warmup_cnt_);
+}
+
+int WeatherCache::CacheSeconds(time_t now, int update_seconds) {
+  if (update_seconds <= 0) {
+    return 0;
+  }
+  return update_seconds - static_cast<int>(now % update_seconds);
+}
+
+bool WeatherCache::Fetch(const string& city, WeatherInfo* weather_info) {
+  ++upstream_cnt_;
+  WeatherHelper weather_helper;
+  if (!weather_helper.FetchWeatherUncached(city, weather_info)) {
+    ++upstream_fail_cnt_;
+    return false;
+  }
+  return true;
+}
+
+WeatherWarmupThread::WeatherWarmupThread() {}
+
+WeatherWarmupThread::~WeatherWarmupThread() {}
+
+void WeatherWarmupThread::Run() {
+  LOG(INFO) << "WeatherWarmupThread::Run() ...";
+  while (true) {
+    int wait_seconds = NextWarmupSeconds(time(NULL),
+                                         FLAGS_weather_warmup_hour,
+                                         FLAGS_weather_warmup_lead_seconds);
+    VLOG(1) << "next weather warmup in " << wait_seconds << " seconds";
+    mobvoi::Sleep(wait_seconds);
+    Singleton<WeatherCache>::get()->Warmup(FLAGS_weather_warmup_lead_seconds);
+  }
+}
+
+int WeatherWarmupThread::NextWarmupSeconds(time_t now, int hour,
+                                           int lead_seconds) {
+  struct tm local_tm;
+  localtime_r(&now, &local_tm);
+  local_tm.tm_hour = hour;
+  local_tm.tm_min = 0;
+  local_tm.tm_sec = 0;
+  time_t warmup_time = mktime(&local_tm) - lead_seconds;
+  while (warmup_time <= now) {
+    warmup_time += 24 * 3600;
+  }
+  return static_cast<int>(warmup_time - now);
+}
+
 }  // namespace push_controller
@@ -4,11 +4,21 @@
 #ifndef PUSH_PUSH_CONTROLLER_WEATHER_HELPER_H_
 #define PUSH_PUSH_CONTROLLER_WEATHER_HELPER_H_
 
+#include <time.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
 #include "base/basictypes.h"
 #include "base/compat.h"
+#include "base/singleton.h"
+#include "base/thread.h"
 #include "third_party/jsoncpp/json.h"
 
 #include "push/proto/weather_meta.pb.h"
+#include "push/util/cache_util.h"
 
 namespace push_controller {
 
@@ -16,8 +26,12 @@ class WeatherHelper {
  public:
   WeatherHelper();
   ~WeatherHelper();
+  // Served by WeatherCache unless --weather_cache_update_seconds is 0.
   bool FetchWeather(const string& city,
                     WeatherInfo* weather_info);
+  // Always calls --weather_service.
+  bool FetchWeatherUncached(const string& city,
+                            WeatherInfo* weather_info);
   bool FetchWeather(const string& city,
                     Json::Value* weather_response);
   void TomorrowWeather(const WeatherInfo& weather_info,
@@ -31,6 +45,51 @@ class WeatherHelper {
   DISALLOW_COPY_AND_ASSIGN(WeatherHelper);
 };
 
+// Process wide cache of the parsed weather by city, shared by the push
+// processors. The forecast is updated every --weather_cache_update_seconds,
+// so the entries expire at the next update.
+class WeatherCache {
+ public:
+  ~WeatherCache();
+  // Concurrent misses of a city share one upstream call.
+  bool Get(const string& city, WeatherInfo* weather_info);
+  // Refetches the cities requested during the last day, the entries are
+  // kept until the first update after now + lead_seconds.
+  void Warmup(int lead_seconds);
+  void GetStats(Json::Value* stats);
+  // Seconds from now to the next multiple of update_seconds.
+  static int CacheSeconds(time_t now, int update_seconds);
+
+ private:
+  friend struct DefaultSingletonTraits<WeatherCache>;
+  WeatherCache();
+  bool Fetch(const string& city, WeatherInfo* weather_info);
+
+  recommendation::ExpiringCache<WeatherInfo> cache_;
+  recommendation::SingleFlight<WeatherInfo> single_flight_;
+  std::mutex mutex_;
+  // city to the last time it was requested
+  std::unordered_map<string, time_t> cities_;
+  std::atomic<uint64> upstream_cnt_;
+  std::atomic<uint64> upstream_fail_cnt_;
+  std::atomic<uint64> warmup_cnt_;
+  DISALLOW_COPY_AND_ASSIGN(WeatherCache);
+};
+
+// Warms WeatherCache every day before --weather_warmup_hour, when the
+// morning reminders are pushed.
+class WeatherWarmupThread : public mobvoi::Thread {
+ public:
+  WeatherWarmupThread();
+  virtual ~WeatherWarmupThread();
+  virtual void Run();
+  // Seconds from now to the next warmup time.
+  static int NextWarmupSeconds(time_t now, int hour, int lead_seconds);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(WeatherWarmupThread);
+};
+
 }  // namespace push_controller
 
 #endif  // PUSH_PUSH_CONTROLLER_WEATHER_HELPER_H_
@@ -7,6 +7,9 @@
 
 DEFINE_string(weather_service,
     "https://m.mobvoi.com/search/pc", "weather server addr");
+DEFINE_int32(weather_cache_update_seconds, 3600, "");
+DEFINE_int32(weather_warmup_hour, 7, "");
+DEFINE_int32(weather_warmup_lead_seconds, 600, "");
 
 using namespace push_controller;
 
@@ -16,3 +19,25 @@ TEST(WeatherHelper, FetchWeather) {
   WeatherInfo weather_info;
   EXPECT_TRUE(weather_helper.FetchWeather(city, &weather_info));
 }
+
+TEST(WeatherCache, CacheSeconds) {
+  EXPECT_EQ(3600, WeatherCache::CacheSeconds(7200, 3600));
+  EXPECT_EQ(3500, WeatherCache::CacheSeconds(7300, 3600));
+  EXPECT_EQ(1, WeatherCache::CacheSeconds(10799, 3600));
+  EXPECT_EQ(0, WeatherCache::CacheSeconds(7300, 0));
+}
+
+TEST(WeatherWarmupThread, NextWarmupSeconds) {
+  time_t now = time(NULL);
+  struct tm local_tm;
+  localtime_r(&now, &local_tm);
+  local_tm.tm_hour = 6;
+  local_tm.tm_min = 0;
+  local_tm.tm_sec = 0;
+  time_t six = mktime(&local_tm);
+  // 10 minutes before 7am
+  EXPECT_EQ(3000, WeatherWarmupThread::NextWarmupSeconds(six, 7, 600));
+  // already past, warm up tomorrow
+  EXPECT_EQ(24 * 3600 - 1200,
+            WeatherWarmupThread::NextWarmupSeconds(six + 3600, 7, 1200));
+}
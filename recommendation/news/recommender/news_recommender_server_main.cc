@@ -17,6 +17,13 @@ DEFINE_bool(enable_load_devices, true, "");
 DEFINE_int32(listen_port, 9167, "");
 DEFINE_int32(http_server_thread_num, 8, "");
 DEFINE_int32(mysql_page_size, 10000, "");
+DEFINE_int32(max_batch_recommend_users, 1000,
+             "max user_ids of one batch recommendation request");
+DEFINE_int32(news_snapshot_seconds, 60,
+             "seconds before the news candidates are fetched again");
+DEFINE_int32(device_cache_seconds, 600,
+             "seconds to cache the info of a device, 0 disables the cache");
+DEFINE_int32(device_cache_size, 200000, "max devices in the device cache");
 
 DEFINE_string(mysql_config,
     "config/recommendation/news/recommender/mysql_test.conf", "");
@@ -24,6 +31,14 @@ DEFINE_string(category_file,
     "config/recommendation/news/recommender/toutiao_category.txt", "");
 DEFINE_string(location_service,
     "http://location-service/geodecoder?lat=%s&lng=%s&high_precision=true", "");
+DEFINE_string(city_boundary_file,
+    "config/recommendation/news/recommender/city_boundary.txt",
+    "city boundaries for local reverse geocoding, empty disables it");
+DEFINE_double(city_grid_degrees, 0.5, "cell size of the city boundary grid");
+DEFINE_int32(location_geohash_precision, 5,
+             "geohash length the location service answers are cached by");
+DEFINE_int32(location_cache_seconds, 86400,
+             "seconds to cache a location service answer");
 
 int main(int argc, char** argv) {
   base::AtExitManager at_exit;
@@ -44,10 +59,17 @@ int main(int argc, char** argv) {
       &RecommendationHandler::HandleRequest, &recommendation_handler,
       std::placeholders::_1, std::placeholders::_2);
   util::DefaultHttpHandler status_http_handler(status_callback);
+  auto batch_recommendation_callback = std::bind(
+      &RecommendationHandler::HandleBatchRequest, &recommendation_handler,
+      std::placeholders::_1, std::placeholders::_2);
   util::DefaultHttpHandler recommendation_http_handler(recommendation_callback);
+  util::DefaultHttpHandler batch_recommendation_http_handler(
+      batch_recommendation_callback);
   http_server.RegisterHttpHandler("/news/recommender/status", &status_http_handler);
   http_server.RegisterHttpHandler("/news/recommender/recommendation",
                                   &recommendation_http_handler);
+  http_server.RegisterHttpHandler("/news/recommender/batch_recommendation",
+                                  &batch_recommendation_http_handler);
   LOG(INFO) << "News recommender server is started";
   http_server.Serv();
   return 0;
@@ -0,0 +1,80 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "recommendation/news/recommender/news_response.h"
+
+#include "third_party/jsoncpp/json.h"
+#include "util/protobuf/proto_json_format.h"
+
+#include "push/util/common_util.h"
+
+namespace {
+
+static const char kResponseBegin[] = "{\"data\":[";
+static const char kResponseEnd[] = "],\"status\":\"success\"}";
+static const char kBatchResponseBegin[] = "{\"results\":{";
+static const char kBatchResponseEnd[] = "},\"status\":\"success\"}";
+
+}
+
+namespace recommendation {
+
+void RenderStoryFragment(const StoryDetail& story, string* fragment) {
+  Json::Value value;
+  util::ProtoJsonFormat::WriteToValue(story, &value);
+  *fragment = push_controller::JsonToString(value);
+  // FastWriter ends the document with a newline
+  if (!fragment->empty() && (*fragment)[fragment->size() - 1] == '\n') {
+    fragment->resize(fragment->size() - 1);
+  }
+}
+
+void AppendNewsResponse(const vector<const string*>& fragments,
+                        string* buffer) {
+  buffer->clear();
+  buffer->append(kResponseBegin, sizeof(kResponseBegin) - 1);
+  for (size_t i = 0; i < fragments.size(); ++i) {
+    if (i > 0) {
+      buffer->push_back(',');
+    }
+    buffer->append(*fragments[i]);
+  }
+  buffer->append(kResponseEnd, sizeof(kResponseEnd) - 1);
+}
+
+void AppendBatchNewsResponse(
+    const vector<std::pair<string, string>>& user_responses,
+    string* buffer) {
+  buffer->clear();
+  buffer->append(kBatchResponseBegin, sizeof(kBatchResponseBegin) - 1);
+  for (size_t i = 0; i < user_responses.size(); ++i) {
+    if (i > 0) {
+      buffer->push_back(',');
+    }
+    buffer->append(Json::valueToQuotedString(
+        user_responses[i].first.c_str()));
+    buffer->push_back(':');
+    buffer->append(user_responses[i].second);
+  }
+  buffer->append(kBatchResponseEnd, sizeof(kBatchResponseEnd) - 1);
+}
+
+bool ParseBatchNewsResponse(const string& body,
+                            const vector<string>& user_ids,
+                            map<string, Json::Value>* results_map) {
+  Json::Value response;
+  Json::Reader reader;
+  if (!reader.parse(body, response) || !response.isObject() ||
+      response["status"] != "success" || !response["results"].isObject()) {
+    return false;
+  }
+  const Json::Value& results = response["results"];
+  for (auto& user_id : user_ids) {
+    if (results.isMember(user_id)) {
+      (*results_map)[user_id] = results[user_id];
+    }
+  }
+  return true;
+}
+
+}  // namespace recommendation
@@ -0,0 +1,38 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#ifndef RECOMMENDATION_NEWS_RECOMMENDER_NEWS_RESPONSE_H_
+#define RECOMMENDATION_NEWS_RECOMMENDER_NEWS_RESPONSE_H_
+
+#include "base/basictypes.h"
+#include "base/compat.h"
+#include "third_party/jsoncpp/json.h"
+
+#include "recommendation/news/proto/news_meta.pb.h"
+
+namespace recommendation {
+
+// Compact JSON of the story, the same fields ProtoJsonFormat writes.
+void RenderStoryFragment(const StoryDetail& story, string* fragment);
+
+// Writes {"data":[...],"status":"success"} of the rendered stories into
+// buffer, which is cleared first and may be reused across responses.
+void AppendNewsResponse(const vector<const string*>& fragments,
+                        string* buffer);
+
+// Writes {"results":{user_id:response,...},"status":"success"} into
+// buffer, every response is a complete JSON document.
+void AppendBatchNewsResponse(
+    const vector<std::pair<string, string>>& user_responses,
+    string* buffer);
+
+// Reads a response of AppendBatchNewsResponse, the response of each of
+// user_ids found in it is put into results_map, failed ones included.
+// Returns false if body is not a successful batch response.
+bool ParseBatchNewsResponse(const string& body,
+                            const vector<string>& user_ids,
+                            map<string, Json::Value>* results_map);
+
+}  // namespace recommendation
+
+#endif  // RECOMMENDATION_NEWS_RECOMMENDER_NEWS_RESPONSE_H_
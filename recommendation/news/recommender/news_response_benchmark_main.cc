@@ -0,0 +1,104 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include <chrono>
+
+#include "base/at_exit.h"
+#include "base/log.h"
+#include "base/string_util.h"
+#include "third_party/gflags/gflags.h"
+#include "third_party/jsoncpp/json.h"
+#include "util/protobuf/proto_json_format.h"
+
+#include "recommendation/news/recommender/news_response.h"
+
+DEFINE_int32(benchmark_response_cnt, 100000, "responses to build per path");
+DEFINE_int32(benchmark_story_cnt, 5, "stories per response");
+
+using namespace recommendation;
+
+namespace {
+
+// A story of the size the portal news have.
+void MakeStory(int index, StoryDetail* story) {
+  story->set_app_url(StringPrintf("http://news.example.com/a/%d.html", index));
+  story->set_background_url("http://img.example.com/news/cover.jpg");
+  story->set_browser_url(story->app_url());
+  story->set_cid(3);
+  story->set_publish_time("06-01");
+  story->set_source("新华网");
+  story->set_summary("国务院常务会议部署进一步扩大和升级信息消费，"
+                     "持续释放内需潜力，推动新兴产业发展。");
+  story->set_tip("0");
+  story->set_title("国务院部署扩大和升级信息消费");
+  story->set_type("news");
+  story->set_id(StringPrintf("%d", 1000000 + index));
+  story->set_keywords("国务院,信息消费,内需");
+  story->set_hot_score(0.87);
+  story->add_hit_hot_terms("国务院");
+  story->add_hit_hot_terms("信息消费");
+}
+
+double MicrosPerResponse(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - start).count() /
+      FLAGS_benchmark_response_cnt;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  base::AtExitManager at_exit;
+  google::ParseCommandLineFlags(&argc, &argv, false);
+  google::InitGoogleLogging(argv[0]);
+  CHECK(FLAGS_benchmark_response_cnt > 0);
+  vector<StoryDetail> stories(FLAGS_benchmark_story_cnt);
+  for (size_t i = 0; i < stories.size(); ++i) {
+    MakeStory(static_cast<int>(i), &stories[i]);
+  }
+
+  // what the handler did for every request before the snapshot fragments
+  string styled;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < FLAGS_benchmark_response_cnt; ++i) {
+    Json::Value result;
+    Json::Value data;
+    result["status"] = "success";
+    for (auto& story : stories) {
+      Json::Value value;
+      util::ProtoJsonFormat::WriteToValue(story, &value);
+      data.append(value);
+    }
+    result["data"] = data;
+    styled = result.toStyledString();
+  }
+  double styled_us = MicrosPerResponse(start);
+
+  // rendered once per snapshot
+  vector<string> rendered(stories.size());
+  vector<const string*> fragments;
+  for (size_t i = 0; i < stories.size(); ++i) {
+    RenderStoryFragment(stories[i], &rendered[i]);
+    fragments.push_back(&rendered[i]);
+  }
+  string buffer;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < FLAGS_benchmark_response_cnt; ++i) {
+    AppendNewsResponse(fragments, &buffer);
+  }
+  double fragment_us = MicrosPerResponse(start);
+
+  Json::Value styled_value, fragment_value;
+  Json::Reader reader;
+  CHECK(reader.parse(styled, styled_value));
+  CHECK(reader.parse(buffer, fragment_value));
+  CHECK(styled_value == fragment_value) << "responses differ";
+  LOG(INFO) << "responses=" << FLAGS_benchmark_response_cnt
+            << ", stories=" << stories.size()
+            << ", styled_bytes=" << styled.size()
+            << ", fragment_bytes=" << buffer.size()
+            << ", styled_us_per_response=" << styled_us
+            << ", fragment_us_per_response=" << fragment_us
+            << ", speedup=" << styled_us / fragment_us;
+  return 0;
+}
@@ -0,0 +1,73 @@
+// Copyright 2017 Mobvoi Inc. All Rights Reserved.
+// Author: xjliu@mobvoi.com (Xiaojia Liu)
+
+#include "recommendation/news/recommender/news_response.h"
+
+#include "third_party/gtest/gtest.h"
+#include "third_party/jsoncpp/json.h"
+
+using namespace recommendation;
+
+TEST(NewsResponse, AppendNewsResponse) {
+  string first = "{\"id\":\"1\",\"title\":\"a\"}";
+  string second = "{\"id\":\"2\",\"title\":\"b\"}";
+  vector<const string*> fragments;
+  fragments.push_back(&first);
+  fragments.push_back(&second);
+  string buffer = "left over";
+  AppendNewsResponse(fragments, &buffer);
+  Json::Value response;
+  Json::Reader reader;
+  ASSERT_TRUE(reader.parse(buffer, response));
+  EXPECT_EQ("success", response["status"].asString());
+  ASSERT_EQ(2u, response["data"].size());
+  EXPECT_EQ("2", response["data"][1]["id"].asString());
+
+  fragments.clear();
+  AppendNewsResponse(fragments, &buffer);
+  EXPECT_EQ("{\"data\":[],\"status\":\"success\"}", buffer);
+}
+
+TEST(NewsResponse, AppendBatchNewsResponse) {
+  vector<std::pair<string, string>> user_responses;
+  user_responses.push_back(std::make_pair(
+      "user\"1", "{\"data\":[],\"status\":\"success\"}"));
+  user_responses.push_back(std::make_pair(
+      "user2", "{\"err_msg\":\"Candidates empty\",\"status\":\"error\"}"));
+  string buffer;
+  AppendBatchNewsResponse(user_responses, &buffer);
+  Json::Value response;
+  Json::Reader reader;
+  ASSERT_TRUE(reader.parse(buffer, response));
+  EXPECT_EQ("success", response["status"].asString());
+  EXPECT_EQ("success", response["results"]["user\"1"]["status"].asString());
+  EXPECT_EQ("error", response["results"]["user2"]["status"].asString());
+}
+
+TEST(NewsResponse, ParseBatchNewsResponse) {
+  vector<std::pair<string, string>> user_responses;
+  user_responses.push_back(std::make_pair(
+      "known", "{\"data\":[],\"status\":\"success\"}"));
+  user_responses.push_back(std::make_pair(
+      "unknown",
+      "{\"err_msg\":\"Get lat and lng failed\",\"status\":\"error\"}"));
+  string buffer;
+  AppendBatchNewsResponse(user_responses, &buffer);
+  vector<string> user_ids = {"known", "unknown", "missing"};
+  map<string, Json::Value> results_map;
+  ASSERT_TRUE(ParseBatchNewsResponse(buffer, user_ids, &results_map));
+  EXPECT_EQ(2u, results_map.size());
+  EXPECT_EQ("success", results_map["known"]["status"].asString());
+  // an unknown user is answered with an error, not a recommendation
+  EXPECT_EQ("error", results_map["unknown"]["status"].asString());
+  EXPECT_EQ("Get lat and lng failed",
+            results_map["unknown"]["err_msg"].asString());
+  EXPECT_EQ(0u, results_map.count("missing"));
+
+  results_map.clear();
+  EXPECT_FALSE(ParseBatchNewsResponse(
+      "{\"err_msg\":\"At most 1000 user_ids\",\"status\":\"error\"}",
+      user_ids, &results_map));
+  EXPECT_FALSE(ParseBatchNewsResponse("not json", user_ids, &results_map));
+  EXPECT_TRUE(results_map.empty());
+}
@@ -16,7 +16,10 @@
 #include "third_party/mysql_client_cpp/include/cppconn/statement.h"
 #include "util/protobuf/proto_json_format.h"
 
+#include "recommendation/news/recommender/news_response.h"
+
 DECLARE_string(mysql_config);
+DECLARE_int32(news_snapshot_seconds);
 
 namespace {
 
@@ -59,28 +62,91 @@ NewsTrigger::NewsTrigger() {
 NewsTrigger::~NewsTrigger() {}
 
 bool NewsTrigger::Trigger(int64 category, vector<StoryDetail>* result_vec) {
-  map<int64, vector<StoryDetail>> category_result_map;
+  return Trigger(category, result_vec, NULL);
+}
+
+bool NewsTrigger::Trigger(int64 category, vector<StoryDetail>* result_vec,
+                          std::shared_ptr<const NewsSnapshot>* snapshot) {
   result_vec->clear();
-  vector<NewsInfo> news_info_vec;
-  if (!FetchDoc(&news_info_vec)) {
+  std::shared_ptr<const NewsSnapshot> current;
+  if (!GetSnapshot(&current)) {
     return false;
   }
-  TransformDoc(news_info_vec, result_vec, &category_result_map);
+  Rank(*current, category, result_vec);
+  if (snapshot != NULL) {
+    *snapshot = current;
+  }
+  return true;
+}
+
+void NewsTrigger::Rank(const NewsSnapshot& snapshot, int64 category,
+                       vector<StoryDetail>* result_vec) {
   bool using_sort = true;
   int64 default_category = 0;
+  auto it = snapshot.category_stories.find(category);
+  if (category != default_category &&
+      it != snapshot.category_stories.end()) {
+    *result_vec = it->second;
+  } else {
+    *result_vec = snapshot.stories;
+  }
   if (using_sort) {
-    if (category != default_category) {
-      if (category_result_map.find(category) != category_result_map.end()) {
-        result_vec->clear();
-        result_vec->insert(result_vec->end(), 
-            category_result_map[category].begin(), 
-            category_result_map[category].end());
-      }
-    }
     Sort(result_vec);
-  } else { 
+  } else {
     RandomShuffle(result_vec);
   }
+}
+
+bool NewsTrigger::GetSnapshot(std::shared_ptr<const NewsSnapshot>* snapshot) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    *snapshot = snapshot_;
+  }
+  if (*snapshot &&
+      time(NULL) - (*snapshot)->build_time < FLAGS_news_snapshot_seconds) {
+    return true;
+  }
+  std::unique_lock<std::mutex> build_lock(build_mutex_, std::try_to_lock);
+  if (!build_lock.owns_lock()) {
+    if (*snapshot) {
+      return true;
+    }
+    // nothing to serve yet, wait for the first build
+    build_lock.lock();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    *snapshot = snapshot_;
+  }
+  if (*snapshot &&
+      time(NULL) - (*snapshot)->build_time < FLAGS_news_snapshot_seconds) {
+    return true;
+  }
+  std::shared_ptr<NewsSnapshot> built = std::make_shared<NewsSnapshot>();
+  if (!BuildSnapshot(built.get())) {
+    // a stale snapshot beats no news
+    return *snapshot != nullptr;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    snapshot_ = built;
+  }
+  *snapshot = built;
+  return true;
+}
+
+bool NewsTrigger::BuildSnapshot(NewsSnapshot* snapshot) {
+  vector<NewsInfo> news_info_vec;
+  if (!FetchDoc(&news_info_vec)) {
+    return false;
+  }
+  TransformDoc(news_info_vec, &snapshot->stories,
+               &snapshot->category_stories);
+  for (auto& story : snapshot->stories) {
+    RenderStoryFragment(story, &snapshot->fragments[story.id()]);
+  }
+  snapshot->build_time = time(NULL);
+  LOG(INFO) << "news snapshot built, stories:" << snapshot->stories.size();
   return true;
 }
 
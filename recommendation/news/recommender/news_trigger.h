@@ -4,6 +4,12 @@
 #ifndef RECOMMENDATION_NEWS_RECOMMENDER_NEWS_TRIGGER_H_
 #define RECOMMENDATION_NEWS_RECOMMENDER_NEWS_TRIGGER_H_
 
+#include <time.h>
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
 #include "base/basictypes.h"
 #include "base/compat.h"
 #include "base/singleton.h"
@@ -13,14 +19,33 @@
 
 namespace recommendation {
 
+// The candidates of one fetch, rebuilt every --news_snapshot_seconds. The
+// response fragment of a story is rendered once here, not per request.
+struct NewsSnapshot {
+  vector<StoryDetail> stories;
+  map<int64, vector<StoryDetail>> category_stories;
+  // story id to its compact JSON, see RenderStoryFragment
+  std::unordered_map<string, string> fragments;
+  time_t build_time;
+};
+
 class NewsTrigger {
  public:
   ~NewsTrigger();
   bool Trigger(int64 category, vector<StoryDetail>* result_vec);
+  // Also returns the snapshot the results come from.
+  bool Trigger(int64 category, vector<StoryDetail>* result_vec,
+               std::shared_ptr<const NewsSnapshot>* snapshot);
+  // Only one caller rebuilds a stale snapshot, the others keep using it.
+  bool GetSnapshot(std::shared_ptr<const NewsSnapshot>* snapshot);
+  // Picks the results of one user from the candidates of the snapshot.
+  void Rank(const NewsSnapshot& snapshot, int64 category,
+            vector<StoryDetail>* result_vec);
 
  private:
   friend struct DefaultSingletonTraits<NewsTrigger>;
   NewsTrigger();
+  bool BuildSnapshot(NewsSnapshot* snapshot);
   bool FetchDoc(vector<NewsInfo>* news_info_vec);
   void TransformDoc(const vector<NewsInfo>& news_info_vec,
                     vector<StoryDetail>* result_vec);
@@ -32,6 +57,10 @@ class NewsTrigger {
   
   std::vector<NewsInfo> doc_vec_cache_;
   std::unique_ptr<MysqlServer> mysql_config_;
+  // guards snapshot_
+  std::mutex mutex_;
+  std::mutex build_mutex_;
+  std::shared_ptr<const NewsSnapshot> snapshot_;
   DISALLOW_COPY_AND_ASSIGN(NewsTrigger);
 };
 
@@ -3,12 +3,20 @@
 
 #include "recommendation/news/recommender/recommendation_handler.h"
 
+#include <set>
+
 #include "base/log.h"
+#include "base/string_util.h"
 #include "push/util/common_util.h"
+#include "third_party/gflags/gflags.h"
 #include "util/net/util.h"
 #include "util/protobuf/proto_json_format.h"
 #include "util/url/parser/url_parser.h"
 
+#include "recommendation/news/recommender/news_response.h"
+
+DECLARE_int32(max_batch_recommend_users);
+
 namespace recommendation {
 
 StatusHandler::StatusHandler() {}
@@ -23,6 +31,9 @@ bool StatusHandler::HandleRequest(util::HttpRequest* request,
   result["status"] = "ok";
   result["host"] = util::GetLocalHostName();
   result["service"] = "news personalization service";
+  Singleton<LocationHelper>::get()->GetStats(&result["location"]);
+  Singleton<DeviceInfoHelper>::get()->GetDeviceCacheStats(
+      &result["device_cache"]);
   response->AppendBuffer(result.toStyledString());
   return true;
 }
@@ -60,26 +71,132 @@ bool RecommendationHandler::HandleRequest(util::HttpRequest* request,
   }
   VLOG(2) << "user_id:" << user_id << ", lat:" << latitude
           << ", lng:" << longitude;
-  LocationInfo location_info;
-  if (!location_helper_->GetLocationInfo(latitude, longitude, &location_info)) {
-    response->AppendBuffer(GetErrorResponse("Get location info failed"));
-    return false;
-  }
   vector<StoryDetail> news_details;
   int64 default_category = 0;
-  if (!news_trigger_->Trigger(default_category, &news_details) ||
+  std::shared_ptr<const NewsSnapshot> snapshot;
+  if (!news_trigger_->Trigger(default_category, &news_details, &snapshot) ||
       news_details.empty()) {
     LOG(WARNING) << "Fetch news from portal failed, using toutiao instead";
+    snapshot.reset();
+    // only the local news of toutiao need the city
+    LocationInfo location_info;
+    if (!location_helper_->GetLocationInfo(latitude, longitude,
+                                           &location_info)) {
+      response->AppendBuffer(GetErrorResponse("Get location info failed"));
+      return false;
+    }
     toutiao_trigger_->Fetch(location_info.city(), &news_details);
   }
   if (news_details.empty()) {
     response->AppendBuffer(GetErrorResponse("Candidates empty"));
     return false;
   }
-  response->AppendBuffer(GetDefaultResponse(user_id, news_details));
+  // reused by the requests of the server thread
+  static thread_local string response_buffer;
+  GetDefaultResponse(user_id, news_details, snapshot.get(), &response_buffer);
+  response->AppendBuffer(response_buffer);
   return true;
 }
 
+bool RecommendationHandler::HandleBatchRequest(util::HttpRequest* request,
+                                               util::HttpResponse* response) {
+  response->SetJsonContentType();
+  string request_data = request->GetRequestData();
+  Json::Value root;
+  Json::Reader reader;
+  if (!reader.parse(request_data, root) || !root["user_ids"].isArray()) {
+    response->AppendBuffer(GetErrorResponse("Data must contain user_ids"));
+    return false;
+  }
+  const Json::Value& user_ids = root["user_ids"];
+  if (user_ids.size() > static_cast<Json::ArrayIndex>(
+          FLAGS_max_batch_recommend_users)) {
+    response->AppendBuffer(GetErrorResponse(StringPrintf(
+        "At most %d user_ids", FLAGS_max_batch_recommend_users)));
+    return false;
+  }
+  LOG(INFO) << "Receive batch RecommendationHandler request, users:"
+            << user_ids.size();
+  // one candidate computation for the whole batch
+  std::shared_ptr<const NewsSnapshot> snapshot;
+  if (!news_trigger_->GetSnapshot(&snapshot) || snapshot->stories.empty()) {
+    LOG(WARNING) << "Fetch news from portal failed, using toutiao instead";
+    snapshot.reset();
+  }
+  int64 default_category = 0;
+  std::set<string> user_set;
+  map<string, string> city_map;
+  map<string, vector<StoryDetail>> toutiao_map;
+  vector<std::pair<string, string>> user_responses;
+  string user_buffer;
+  for (Json::ArrayIndex i = 0; i < user_ids.size(); ++i) {
+    string user_id = user_ids[i].asString();
+    // the results are keyed by user, a repeated one is answered once
+    if (!user_set.insert(user_id).second) {
+      continue;
+    }
+    // unknown users fail like in HandleRequest, snapshot or not
+    string latitude, longitude;
+    if (!device_info_helper_->GetDeviceCoordinate(user_id, &latitude,
+                                                  &longitude)) {
+      user_responses.push_back(std::make_pair(
+          user_id, GetCompactErrorResponse("Get lat and lng failed")));
+      continue;
+    }
+    vector<StoryDetail> news_details;
+    if (snapshot) {
+      news_trigger_->Rank(*snapshot, default_category, &news_details);
+    } else {
+      // only the local news of toutiao need the city, fetched once a city
+      string city;
+      if (!GetCity(latitude, longitude, &city_map, &city)) {
+        user_responses.push_back(std::make_pair(
+            user_id, GetCompactErrorResponse("Get location info failed")));
+        continue;
+      }
+      auto it = toutiao_map.find(city);
+      if (it == toutiao_map.end()) {
+        it = toutiao_map.insert(
+            std::make_pair(city, vector<StoryDetail>())).first;
+        toutiao_trigger_->Fetch(city, &it->second);
+      }
+      news_details = it->second;
+    }
+    if (news_details.empty()) {
+      user_responses.push_back(std::make_pair(
+          user_id, GetCompactErrorResponse("Candidates empty")));
+      continue;
+    }
+    GetDefaultResponse(user_id, news_details, snapshot.get(), &user_buffer);
+    user_responses.push_back(std::make_pair(user_id, user_buffer));
+  }
+  // reused by the requests of the server thread
+  static thread_local string response_buffer;
+  AppendBatchNewsResponse(user_responses, &response_buffer);
+  response->AppendBuffer(response_buffer);
+  return true;
+}
+
+bool RecommendationHandler::GetCity(const string& latitude,
+                                    const string& longitude,
+                                    map<string, string>* city_map,
+                                    string* city) {
+  string key = latitude + "," + longitude;
+  auto it = city_map->find(key);
+  if (it == city_map->end()) {
+    LocationInfo location_info;
+    string resolved;
+    if (location_helper_->GetLocationInfo(latitude, longitude,
+                                          &location_info)) {
+      resolved = location_info.city();
+    }
+    // the failed lookups are remembered too, as an empty city
+    it = city_map->insert(std::make_pair(key, resolved)).first;
+  }
+  *city = it->second;
+  return !city->empty();
+}
+
 bool RecommendationHandler::ParseQuery(const std::string& url,
                                        map<string, string>* params) {
   string::size_type index = url.find('?');
@@ -91,20 +208,33 @@ bool RecommendationHandler::ParseQuery(const std::string& url,
   return true;
 }
 
-string RecommendationHandler::GetDefaultResponse(
-    const string& user_id, const vector<StoryDetail>& doc_vec) {
-  Json::Value result;
-  Json::Value data;
-  result["status"] = "success";
+void RecommendationHandler::GetDefaultResponse(
+    const string& user_id, const vector<StoryDetail>& doc_vec,
+    const NewsSnapshot* snapshot, string* buffer) {
+  vector<const string*> fragments;
+  vector<string> rendered;
+  // fragments point into rendered, it must not reallocate
+  rendered.reserve(doc_vec.size());
+  string doc_ids;
   for (auto& doc : doc_vec) {
-    Json::Value result;
-    util::ProtoJsonFormat::WriteToValue(doc, &result);
-    LOG(INFO) << "Recommed Candidate for user:" << user_id << ", doc:" 
-            << push_controller::JsonToString(result);
-    data.append(result);
+    const string* fragment = NULL;
+    if (snapshot != NULL) {
+      auto it = snapshot->fragments.find(doc.id());
+      if (it != snapshot->fragments.end()) {
+        fragment = &it->second;
+      }
+    }
+    if (fragment == NULL) {
+      rendered.push_back("");
+      RenderStoryFragment(doc, &rendered.back());
+      fragment = &rendered.back();
+    }
+    fragments.push_back(fragment);
+    doc_ids.append(doc_ids.empty() ? "" : ",").append(doc.id());
   }
-  result["data"] = data;
-  return result.toStyledString();
+  AppendNewsResponse(fragments, buffer);
+  LOG(INFO) << "Recommend candidates for user:" << user_id
+            << ", ids:" << doc_ids;
 }
 
 string RecommendationHandler::GetErrorResponse(const std::string& err_msg) {
@@ -114,4 +244,17 @@ string RecommendationHandler::GetErrorResponse(const std::string& err_msg) {
   return result.toStyledString();
 }
 
+string RecommendationHandler::GetCompactErrorResponse(
+    const std::string& err_msg) {
+  Json::Value result;
+  result["status"] = "error";
+  result["err_msg"] = err_msg;
+  string response = push_controller::JsonToString(result);
+  // the ending newline of FastWriter
+  if (!response.empty()) {
+    response.resize(response.size() - 1);
+  }
+  return response;
+}
+
 }  // namespace recommendation
@@ -35,12 +35,26 @@ class RecommendationHandler : public serving::HttpRequestHandler {
   virtual ~RecommendationHandler();
   virtual bool HandleRequest(util::HttpRequest* request,
                              util::HttpResponse* response);
+  // POST {"user_ids":[...]}, answers the response of HandleRequest for
+  // every distinct user. The candidates are computed once for the batch.
+  bool HandleBatchRequest(util::HttpRequest* request,
+                          util::HttpResponse* response);
 
  private:
+  // The cities of the coordinates already resolved in the batch are taken
+  // from city_map.
+  bool GetCity(const string& latitude, const string& longitude,
+               map<string, string>* city_map, string* city);
   bool ParseQuery(const std::string& url, map<string, string>* params);
-  string GetDefaultResponse(const string& user_id,
-                            const vector<StoryDetail>& doc_vec);
+  // Concatenates the fragments of the snapshot, the stories not in it are
+  // rendered on the spot.
+  void GetDefaultResponse(const string& user_id,
+                          const vector<StoryDetail>& doc_vec,
+                          const NewsSnapshot* snapshot,
+                          string* buffer);
   string GetErrorResponse(const std::string& err_msg);
+  // Without the indentation, for the responses embedded in a batch.
+  string GetCompactErrorResponse(const std::string& err_msg);
 
   ToutiaoTrigger* toutiao_trigger_;
   NewsTrigger* news_trigger_;